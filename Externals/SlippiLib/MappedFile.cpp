@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <codecvt>
+#include <locale>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Slippi {
+  MappedFile::~MappedFile() {
+    unmap();
+
+#ifdef _WIN32
+    if (fileHandle) {
+      CloseHandle(fileHandle);
+    }
+#else
+    if (fd >= 0) {
+      close(fd);
+    }
+#endif
+  }
+
+  bool MappedFile::Open(const std::string& path) {
+#ifdef _WIN32
+    // On Windows, we need to convert paths to std::wstring to deal with UTF-8
+    std::wstring convertedPath = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(path);
+
+    // The replay may still be open for writing when mirroring
+    HANDLE handle = CreateFileW(convertedPath.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+
+    fileHandle = handle;
+#else
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+#endif
+
+    Refresh();
+    return true;
+  }
+
+  void MappedFile::Refresh() {
+#ifdef _WIN32
+    LARGE_INTEGER fileSize;
+    if (!fileHandle || !GetFileSizeEx(fileHandle, &fileSize)) {
+      return;
+    }
+
+    size_t newSize = (size_t)fileSize.QuadPart;
+    if (newSize <= size) {
+      return;
+    }
+
+    HANDLE mapping = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+      return;
+    }
+
+    // The view keeps the mapping alive after its handle is closed
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view) {
+      return;
+    }
+#else
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      return;
+    }
+
+    size_t newSize = (size_t)st.st_size;
+    if (newSize <= size) {
+      return;
+    }
+
+    void* view = mmap(nullptr, newSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+      return;
+    }
+#endif
+
+    unmap();
+    mapped = (uint8_t*)view;
+    size = newSize;
+  }
+
+  void MappedFile::unmap() {
+    if (!mapped) {
+      return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(mapped);
+#else
+    munmap(mapped, size);
+#endif
+
+    mapped = nullptr;
+    size = 0;
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Slippi {
+  // Read only memory mapping of a file that may still be growing, such as a
+  // replay that is being mirrored while it is written
+  class MappedFile
+  {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+
+    // Remaps the file if it has grown since the last call. Data() may move
+    void Refresh();
+
+    const uint8_t* Data() const { return mapped; }
+    size_t Size() const { return size; }
+  private:
+    void unmap();
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+#else
+    int fd = -1;
+#endif
+    uint8_t* mapped = nullptr;
+    size_t size = 0;
+  };
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "SlippiColumns.h"
+
+namespace Slippi {
+  void PlayerColumns::Append(const PlayerFrameData& p) {
+    locationX.push_back(p.locationX);
+    locationY.push_back(p.locationY);
+    facingDirection.push_back(p.facingDirection);
+    percent.push_back(p.percent);
+    animation.push_back(p.animation);
+    joystickX.push_back(p.joystickX);
+    joystickY.push_back(p.joystickY);
+    cstickX.push_back(p.cstickX);
+    cstickY.push_back(p.cstickY);
+    trigger.push_back(p.trigger);
+    buttons.push_back(p.buttons);
+    physicalButtons.push_back(p.physicalButtons);
+  }
+
+  template <typename T>
+  void appendValue(std::vector<uint8_t>& out, T value) {
+    const uint8_t* bytes = (const uint8_t*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+  }
+
+  template <typename T>
+  void appendColumn(std::vector<uint8_t>& out, const std::vector<T>& column) {
+    const uint8_t* bytes = (const uint8_t*)column.data();
+    out.insert(out.end(), bytes, bytes + column.size() * sizeof(T));
+  }
+
+  bool buildRecord(const std::string& path, std::vector<uint8_t>& out) {
+    auto game = SlippiGame::FromFile(path);
+    if (!game) {
+      return false;
+    }
+
+    // Processes the whole file
+    int32_t lastFrame = game->GetLatestIndex();
+    if (!game->DoesFrameExist(GAME_FIRST_FRAME) || lastFrame < GAME_FIRST_FRAME) {
+      return false;
+    }
+
+    GameSettings* settings = game->GetSettings();
+    uint32_t frameCount = (uint32_t)(lastFrame - GAME_FIRST_FRAME + 1);
+
+    uint8_t portMask = 0;
+    std::array<uint8_t, PORT_COUNT> characterIds{};
+    for (uint8_t port = 0; port < PORT_COUNT; port++) {
+      auto it = settings->players.find(port);
+      if (it == settings->players.end()) {
+        continue;
+      }
+
+      portMask |= 1 << port;
+      characterIds[port] = it->second.characterId;
+    }
+
+    // Frames a player is missing from, and frames lost from the replay, are zero filled
+    std::array<PlayerColumns, PORT_COUNT> columns;
+    PlayerFrameData empty{};
+    for (int32_t frame = GAME_FIRST_FRAME; frame <= lastFrame; frame++) {
+      // After a rollback this is the copy of the frame that was kept
+      FrameData* frameData = game->GetFrame(frame);
+      for (uint8_t port = 0; port < PORT_COUNT; port++) {
+        if (!(portMask & (1 << port))) {
+          continue;
+        }
+
+        bool exists = frameData && frameData->HasPlayer(port, false);
+        columns[port].Append(exists ? frameData->players[port] : empty);
+      }
+    }
+
+    out.clear();
+    appendValue<uint32_t>(out, (uint32_t)path.size());
+    out.insert(out.end(), path.begin(), path.end());
+    appendValue<uint16_t>(out, settings->stage);
+    appendValue<uint8_t>(out, portMask);
+    out.insert(out.end(), characterIds.begin(), characterIds.end());
+    appendValue<int32_t>(out, GAME_FIRST_FRAME);
+    appendValue<uint32_t>(out, frameCount);
+
+    for (uint8_t port = 0; port < PORT_COUNT; port++) {
+      if (!(portMask & (1 << port))) {
+        continue;
+      }
+
+      const PlayerColumns& c = columns[port];
+      appendColumn(out, c.locationX);
+      appendColumn(out, c.locationY);
+      appendColumn(out, c.facingDirection);
+      appendColumn(out, c.percent);
+      appendColumn(out, c.animation);
+      appendColumn(out, c.joystickX);
+      appendColumn(out, c.joystickY);
+      appendColumn(out, c.cstickX);
+      appendColumn(out, c.cstickY);
+      appendColumn(out, c.trigger);
+      appendColumn(out, c.buttons);
+      appendColumn(out, c.physicalButtons);
+    }
+
+    return true;
+  }
+
+  size_t writeColumnFile(FILE* output, const std::vector<std::string>& paths, unsigned int threadCount) {
+    fwrite(COLUMN_FILE_MAGIC, 1, sizeof(COLUMN_FILE_MAGIC), output);
+    fwrite(&COLUMN_FILE_VERSION, sizeof(COLUMN_FILE_VERSION), 1, output);
+
+    std::atomic<size_t> nextPath(0);
+    size_t nextWrite = 0;
+    size_t failed = 0;
+    std::mutex outputLock;
+    std::condition_variable written;
+
+    auto worker = [&]() {
+      std::vector<uint8_t> record;
+      for (size_t i = nextPath++; i < paths.size(); i = nextPath++) {
+        bool built = buildRecord(paths[i], record);
+
+        // Records are written in the order of paths, so the same replays always give the same
+        // file. Paths are handed out in that order too, so the one to write next is never
+        // waiting on the others
+        std::unique_lock<std::mutex> lk(outputLock);
+        written.wait(lk, [&] { return nextWrite == i; });
+        if (built) {
+          fwrite(record.data(), 1, record.size(), output);
+        }
+        else {
+          fprintf(stderr, "Skipping %s\n", paths[i].c_str());
+          failed++;
+        }
+
+        nextWrite++;
+        written.notify_all();
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < std::max(1u, threadCount); i++) {
+      threads.emplace_back(worker);
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    return failed;
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// Column files hold per-player columns of frame data from many replays, so queries over large
+// replay sets become straight array scans instead of parsing every replay again.
+//
+// Layout, all values in the host byte order of the machine that wrote the file:
+//   char magic[4] = "SLPC", uint32_t version
+//   then one record per replay that could be read, in the order the replays were given:
+//     uint32_t pathLength, char path[pathLength]
+//     uint16_t stage, uint8_t portMask, uint8_t characterIds[4]
+//     int32_t firstFrame, uint32_t frameCount
+//     for every port set in portMask, every column in the order of PlayerColumns, each as
+//     frameCount values
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "SlippiGame.h"
+
+namespace Slippi {
+  const char COLUMN_FILE_MAGIC[4] = { 'S', 'L', 'P', 'C' };
+  const uint32_t COLUMN_FILE_VERSION = 1;
+
+  struct PlayerColumns {
+    std::vector<float> locationX;
+    std::vector<float> locationY;
+    std::vector<float> facingDirection;
+    std::vector<float> percent;
+    std::vector<uint16_t> animation;
+    std::vector<float> joystickX;
+    std::vector<float> joystickY;
+    std::vector<float> cstickX;
+    std::vector<float> cstickY;
+    std::vector<float> trigger;
+    std::vector<uint32_t> buttons;
+    std::vector<uint16_t> physicalButtons;
+
+    void Append(const PlayerFrameData& p);
+  };
+
+  // Parses one replay and serializes its record into out. Returns false if the
+  // file can't be read or holds no frames
+  bool buildRecord(const std::string& path, std::vector<uint8_t>& out);
+
+  // Writes a column file of the replays in paths to output, parsing them on threadCount
+  // threads. Returns the number of replays skipped
+  size_t writeColumnFile(FILE* output, const std::vector<std::string>& paths, unsigned int threadCount);
+}
@@ -0,0 +1,58 @@
+// Batch replay analysis tool. Parses many .slp files in parallel with SlippiGame and writes
+// per-player columns of frame data to one compact file, laid out as described in
+// SlippiColumns.h.
+//
+// Usage: slippi-columns <output file> [replay.slp ...]
+// Replay paths are read from stdin, one per line, when none are given on the command line.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SlippiColumns.h"
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <output file> [replay.slp ...]\n", argv[0]);
+    fprintf(stderr, "Replay paths are read from stdin when none are given.\n");
+    return 1;
+  }
+
+  std::vector<std::string> paths(argv + 2, argv + argc);
+  if (paths.empty()) {
+    char line[4096];
+    while (fgets(line, sizeof(line), stdin)) {
+      size_t len = strcspn(line, "\r\n");
+      if (len) {
+        paths.emplace_back(line, len);
+      }
+    }
+  }
+
+  FILE* output = fopen(argv[1], "wb");
+  if (!output) {
+    fprintf(stderr, "Failed to open %s for writing\n", argv[1]);
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+
+  unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+  size_t failed = Slippi::writeColumnFile(output, paths, threadCount);
+
+  bool writeFailed = ferror(output) != 0;
+  writeFailed |= fclose(output) != 0;
+  if (writeFailed) {
+    fprintf(stderr, "Failed to write %s\n", argv[1]);
+    return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  fprintf(stderr, "Wrote %zu replays (%zu skipped) on %u threads in %.2fs\n",
+    paths.size() - failed, failed, threadCount, seconds);
+  return 0;
+}
@@ -1,11 +1,17 @@
 #include <string>
-#include <codecvt>
-#include <locale>
 
 #include "SlippiGame.h"
 
 namespace Slippi {
 
+  // Frames further than this from the start of the game are not indexed, so
+  // corrupt frame numbers can't make the index huge
+  const int64_t MAX_FRAME_INDEX = 1 << 24;
+
+  // Payload of the message being handled. Several games may be parsed at once
+  // on different threads
+  static thread_local uint8_t* data;
+
   //**********************************************************************
   //*                         Event Handlers
   //**********************************************************************
@@ -136,6 +142,35 @@ namespace Slippi {
     game->areSettingsLoaded = true;
   }
 
+  FrameData* findFrame(Game* game, int32_t frameCount) {
+    int64_t idx = (int64_t)frameCount - GAME_FIRST_FRAME;
+    if (idx < 0 || idx >= (int64_t)game->framePositions.size()) {
+      return nullptr;
+    }
+
+    int32_t pos = game->framePositions[idx];
+    return pos < 0 ? nullptr : &game->frames[pos];
+  }
+
+  FrameData* addFrame(Game* game, int32_t frameCount) {
+    game->frames.emplace_back();
+    FrameData* frame = &game->frames.back();
+    frame->frame = frameCount;
+    frame->numSinceStart = (uint32_t)game->frames.size() - 1;
+
+    // Frames before the start of the game can't be looked up by index
+    int64_t idx = (int64_t)frameCount - GAME_FIRST_FRAME;
+    if (idx >= 0 && idx < MAX_FRAME_INDEX) {
+      if (idx >= (int64_t)game->framePositions.size()) {
+        game->framePositions.resize(idx + 1, -1);
+      }
+
+      game->framePositions[idx] = frame->numSinceStart;
+    }
+
+    return frame;
+  }
+
   void handleFrameStart(Game* game, uint32_t maxSize) {
     int idx = 0;
 
@@ -143,18 +178,11 @@ namespace Slippi {
     int32_t frameCount = readWord(data, idx, maxSize, 0);
     game->frameCount = frameCount;
 
-    auto frameUniquePtr = std::make_unique<FrameData>();
-    FrameData* frame = frameUniquePtr.get();
-
-    frame->frame = frameCount;
+    // Add frame to game. A rollback replays a frame by starting it again, in
+    // which case lookups by index return the latest copy
+    FrameData* frame = addFrame(game, frameCount);
     frame->randomSeedExists = true;
     frame->randomSeed = readWord(data, idx, maxSize, 0);
-
-    // Add frame to game. The frames are stored in multiple ways because
-    // for games with rollback, the same frame may be replayed multiple times
-    frame->numSinceStart = game->frames.size();
-    game->frames.push_back(std::move(frameUniquePtr));
-    game->framesByIndex[frameCount] = frame;
   }
 
   void handlePreFrameUpdate(Game* game, uint32_t maxSize) {
@@ -164,22 +192,25 @@ namespace Slippi {
     int32_t frameCount = readWord(data, idx, maxSize, 0);
     game->frameCount = frameCount;
 
-    auto frameUniquePtr = std::make_unique<FrameData>();
-    FrameData* frame = frameUniquePtr.get();
-    bool isNewFrame = true;
-
-    if (game->framesByIndex.count(frameCount)) {
+    FrameData* frame;
+    if (findFrame(game, frameCount)) {
       // If this frame already exists, get the current frame
-      frame = game->frames.back().get();
-      isNewFrame = false;
+      frame = &game->frames.back();
+    }
+    else {
+      frame = addFrame(game, frameCount);
     }
-
-    frame->frame = frameCount;
-
-    PlayerFrameData p;
 
     uint8_t playerSlot = readByte(data, idx, maxSize, 0);
     uint8_t isFollower = readByte(data, idx, maxSize, 0);
+    if (playerSlot >= PORT_COUNT) {
+      return;
+    }
+
+    // Set the player data for the player or follower
+    PlayerFrameData& p = isFollower ? frame->followers[playerSlot] : frame->players[playerSlot];
+    uint8_t& present = isFollower ? frame->followersPresent : frame->playersPresent;
+    present |= 1 << playerSlot;
 
     //Load random seed for player frame update
     p.randomSeed = readWord(data, idx, maxSize, 0);
@@ -203,26 +234,11 @@ namespace Slippi {
     p.lTrigger = readFloat(data, idx, maxSize, 0);
     p.rTrigger = readFloat(data, idx, maxSize, 0);
 
-    if (asmEvents[EVENT_PRE_FRAME_UPDATE] >= 59) {
-      p.joystickXRaw = readByte(data, idx, maxSize, 0);
-    }
+    // The raw stick byte was added when the payload grew to 59 bytes
+    p.joystickXRaw = maxSize >= 59 ? readByte(data, idx, maxSize, 0) : 0;
 
     uint32_t noPercent = 0xFFFFFFFF;
     p.percent = readFloat(data, idx, maxSize, *(float*)(&noPercent));
-
-    // Add player data to frame
-    std::unordered_map<uint8_t, PlayerFrameData>* target;
-    target = isFollower ? &frame->followers : &frame->players;
-
-    // Set the player data for the player or follower
-    target->operator[](playerSlot) = p;
-
-    // Add frame to game
-    if (isNewFrame) {
-      frame->numSinceStart = game->frames.size();
-      game->frames.push_back(std::move(frameUniquePtr));
-      game->framesByIndex[frameCount] = frame;
-    }
   }
 
   void handlePostFrameUpdate(Game* game, uint32_t maxSize) {
@@ -231,20 +247,27 @@ namespace Slippi {
     //Check frame count
     int32_t frameCount = readWord(data, idx, maxSize, 0);
 
-    FrameData* frame;
-    if (game->framesByIndex.count(frameCount)) {
-      // If this frame already exists, get the current frame
-      frame = game->frames.back().get();
+    if (!findFrame(game, frameCount)) {
+      // Post frame updates always follow the pre frame update that added the frame
+      return;
     }
 
+    // If this frame already exists, get the current frame
+    FrameData* frame = &game->frames.back();
+
     // As soon as a post frame update happens, we know we have received all the inputs
     // This is used to determine if a frame is ready to be used for a replay (for mirroring)
     frame->inputsFullyFetched = true;
 
     uint8_t playerSlot = readByte(data, idx, maxSize, 0);
     uint8_t isFollower = readByte(data, idx, maxSize, 0);
+    if (playerSlot >= PORT_COUNT) {
+      return;
+    }
 
     PlayerFrameData* p = isFollower ? &frame->followers[playerSlot] : &frame->players[playerSlot];
+    uint8_t& present = isFollower ? frame->followersPresent : frame->playersPresent;
+    present |= 1 << playerSlot;
 
     p->internalCharacterId = readByte(data, idx, maxSize, 0);
 
@@ -256,12 +279,10 @@ namespace Slippi {
     // Set settings loaded if this is the last character
     if (frameCount == GAME_FIRST_FRAME) {
       uint8_t lastPlayerIndex = 0;
-      for (auto it = frame->players.begin(); it != frame->players.end(); ++it) {
-        if (it->first <= lastPlayerIndex) {
-          continue;
+      for (uint8_t port = 0; port < PORT_COUNT; port++) {
+        if (frame->HasPlayer(port, false)) {
+          lastPlayerIndex = port;
         }
-
-        lastPlayerIndex = it->first;
       }
 
       if (playerSlot >= lastPlayerIndex) {
@@ -277,16 +298,12 @@ namespace Slippi {
   }
 
   // This function gets the position where the raw data starts
-  int getRawDataPosition(std::ifstream* f) {
-    char buffer[2];
-    f->seekg(0, std::ios::beg);
-    f->read(buffer, 2);
-
-    if (buffer[0] == 0x36) {
+  size_t getRawDataPosition(const uint8_t* fileData) {
+    if (fileData[0] == 0x36) {
       return 0;
     }
 
-    if (buffer[0] != '{') {
+    if (fileData[0] != '{') {
       // TODO: Do something here to cause an error
       return 0;
     }
@@ -296,48 +313,18 @@ namespace Slippi {
     return 15;
   }
 
-  uint32_t getRawDataLength(std::ifstream* f, int position, int fileSize) {
-    if (position == 0) {
-      return fileSize;
-    }
-
-    char buffer[4];
-    f->seekg(position - 4, std::ios::beg);
-    f->read(buffer, 4);
-
-    uint8_t* byteBuf = (uint8_t*)&buffer[0];
-    uint32_t length = byteBuf[0] << 24 | byteBuf[1] << 16 | byteBuf[2] << 8 | byteBuf[3];
-    return length;
-  }
+  void getMessageSizes(const uint8_t* message, std::array<uint32_t, 256>& messageSizes) {
+    messageSizes.fill(0);
 
-  std::unordered_map<uint8_t, uint32_t> getMessageSizes(std::ifstream* f, int position) {
-    char buffer[2];
-    f->seekg(position, std::ios::beg);
-    f->read(buffer, 2);
-    if (buffer[0] != EVENT_PAYLOAD_SIZES) {
-      return {};
-    }
+    uint8_t payloadLength = message[1];
+    messageSizes[EVENT_PAYLOAD_SIZES] = payloadLength;
 
-    int payloadLength = buffer[1];
-    std::unordered_map<uint8_t, uint32_t> messageSizes = {
-      { EVENT_PAYLOAD_SIZES, payloadLength }
-    };
-
-
-    std::vector<char> messageSizesBuffer(payloadLength - 1);
-    f->read(&messageSizesBuffer[0], payloadLength - 1);
-    for (int i = 0; i < payloadLength - 1; i += 3) {
-      uint8_t command = messageSizesBuffer[i];
-
-      // Extract the bytes in u8s. Without this the chars don't or together well
-      uint8_t byte1 = messageSizesBuffer[i + 1];
-      uint8_t byte2 = messageSizesBuffer[i + 2];
-
-      uint16_t size = byte1 << 8 | byte2;
+    const uint8_t* sizes = &message[2];
+    for (int i = 0; i + 2 < payloadLength - 1; i += 3) {
+      uint8_t command = sizes[i];
+      uint16_t size = sizes[i + 1] << 8 | sizes[i + 2];
       messageSizes[command] = size;
     }
-
-    return messageSizes;
   }
 
   void SlippiGame::processData() {
@@ -346,76 +333,52 @@ namespace Slippi {
       return;
     }
 
-    // This function will process as much data as possible
-    int startPos = (int)file->tellg();
-    file->seekg(startPos);
-    if (startPos == 0) {
-      file->seekg(0, std::ios::end);
-      int len = (int)file->tellg();
-      if (len < 2) {
+    // This function will process as much data as possible. Only the part of
+    // the file past readPos is looked at, so a replay that is still being
+    // written is never scanned twice
+    file.Refresh();
+    const uint8_t* fileData = file.Data();
+    size_t fileSize = file.Size();
+
+    if (readPos == 0) {
+      if (fileSize < 2) {
         // If we can't read message sizes payload size yet, return
         return;
       }
 
-      int rawDataPos = getRawDataPosition(file.get());
-      int rawDataLen = len - rawDataPos;
-      if (rawDataLen < 2) {
+      size_t rawDataPos = getRawDataPosition(fileData);
+      size_t rawDataLen = fileSize - rawDataPos;
+      if (rawDataPos > fileSize || rawDataLen < 2) {
         // If we don't have enough raw data yet to read the replay file, return
-        // Reset to begining so that the startPos condition will be hit again
-        file->seekg(0);
         return;
       }
 
-      startPos = rawDataPos;
-
-      char buffer[2];
-      file->seekg(startPos);
-      file->read(buffer, 2);
-      file->seekg(startPos);
-      auto messageSizesSize = (int)buffer[1];
-      if (rawDataLen < messageSizesSize) {
+      auto messageSizesSize = fileData[rawDataPos + 1];
+      if (rawDataLen < (size_t)messageSizesSize + 1) {
         // If we haven't received the full payload sizes message, return
-        // Reset to begining so that the startPos condition will be hit again
-        file->seekg(0);
         return;
       }
 
-      asmEvents = getMessageSizes(file.get(), rawDataPos);
+      getMessageSizes(&fileData[rawDataPos], payloadSizes);
+      readPos = rawDataPos;
     }
 
-    // Read everything to the end
-    file->seekg(0, std::ios::end);
-    int endPos = (int)file->tellg();
-    int sizeToRead = endPos - startPos;
-    file->seekg(startPos);
-    //log << "Size to read: " << sizeToRead << "\n";
-    //log << "Start Pos: " << startPos << "\n";
-    //log << "End Pos: " << endPos << "\n\n";
-    if (sizeToRead <= 0) {
-      return;
-    }
-
-    std::vector<char> newData(sizeToRead);
-    file->read(&newData[0], sizeToRead);
-
-    int newDataPos = 0;
-    while (newDataPos < sizeToRead) {
-      auto command = newData[newDataPos];
-      auto payloadSize = asmEvents[command];
+    while (readPos < fileSize) {
+      auto command = fileData[readPos];
+      auto payloadSize = payloadSizes[command];
 
       //char buff[100];
       //snprintf(buff, sizeof(buff), "%x", command);
       //log << "Command: " << buff << " | Payload Size: " << payloadSize << "\n";
 
-      auto remainingLen = sizeToRead - newDataPos;
-      if (remainingLen < ((int)payloadSize + 1)) {
+      auto remainingLen = fileSize - readPos;
+      if (remainingLen < (size_t)payloadSize + 1) {
         // Here we don't have enough data to read the whole payload
         // Will be processed after getting more data (hopefully)
-        file->seekg(-remainingLen, std::ios::cur);
         return;
       }
 
-      data = (uint8_t*)&newData[newDataPos + 1];
+      data = (uint8_t*)&fileData[readPos + 1];
 
       uint8_t isSplitComplete = false;
       uint32_t outerPayloadSize = payloadSize;
@@ -438,7 +401,7 @@ namespace Slippi {
           // Transform this message into a different message
           command = data[SPLIT_MESSAGE_INTERNAL_DATA_LEN + 2];
           data = &splitMessageBuf[0];
-          payloadSize = asmEvents[command];
+          payloadSize = payloadSizes[command];
           shouldResetSplitMessageBuf = true;
         }
       }
@@ -470,12 +433,11 @@ namespace Slippi {
         // ubjson file format
         //log.close();
         isProcessingComplete = true;
-        file->seekg(-remainingLen, std::ios::cur);
         return;
       }
 
       payloadSize = isSplitComplete ? outerPayloadSize : payloadSize;
-      newDataPos += payloadSize + 1;
+      readPos += payloadSize + 1;
     }
   }
 
@@ -484,30 +446,11 @@ namespace Slippi {
     result->game = std::make_unique<Game>();
     result->path = path;
 
-#ifdef _WIN32
-    // On Windows, we need to convert paths to std::wstring to deal with UTF-8
-    std::wstring convertedPath = std::wstring_convert<std::codecvt_utf8<wchar_t>>().from_bytes(path);
-    result->file = std::make_unique<std::ifstream>(convertedPath, std::ios::in | std::ios::binary);
-#else
-    result->file = std::make_unique<std::ifstream>(path, std::ios::in | std::ios::binary);
-#endif
-
     //result->log.open("log.txt");
-    if (!result->file->is_open()) {
+    if (!result->file.Open(path)) {
       return nullptr;
     }
 
-    //int fileLength = (int)file.tellg();
-    //int rawDataPos = getRawDataPosition(&file);
-    //uint32_t rawDataLength = getRawDataLength(&file, rawDataPos, fileLength);
-    //asmEvents = getMessageSizes(&file, rawDataPos);
-
-    //std::vector<char> rawData(rawDataLength);
-    //file.seekg(rawDataPos, std::ios::beg);
-    //file.read(&rawData[0], rawDataLength);
-
-    //SlippiGame* result = processFile((uint8_t*)&rawData[0], rawDataLength);
-
     return std::move(result);
   }
 
@@ -522,7 +465,7 @@ namespace Slippi {
 
   bool SlippiGame::DoesFrameExist(int32_t frame) {
     processData();
-    return (bool)game->framesByIndex.count(frame);
+    return findFrame(game.get(), frame) != nullptr;
   }
 
   std::array<uint8_t, 4> SlippiGame::GetVersion()
@@ -532,7 +475,7 @@ namespace Slippi {
 
   FrameData* SlippiGame::GetFrame(int32_t frame) {
     // Get the frame we want
-    return game->framesByIndex.at(frame);
+    return findFrame(game.get(), frame);
   }
 
   FrameData* SlippiGame::GetFrameAt(uint32_t pos) {
@@ -541,7 +484,7 @@ namespace Slippi {
     }
 
     // Get the frame we want
-    return game->frames[pos].get();
+    return &game->frames[pos];
   }
 
   int32_t SlippiGame::GetLatestIndex() {
@@ -8,6 +8,8 @@
 #include <fstream>
 #include <memory>
 
+#include "MappedFile.h"
+
 namespace Slippi {
   const uint8_t EVENT_SPLIT_MESSAGE = 0x10;
   const uint8_t EVENT_PAYLOAD_SIZES = 0x35;
@@ -25,11 +27,10 @@ namespace Slippi {
   const int32_t PLAYBACK_FIRST_SAVE = -122;
   const uint8_t GAME_SHEIK_INTERNAL_ID = 0x7;
   const uint8_t GAME_SHEIK_EXTERNAL_ID = 0x13;
+  const uint8_t PORT_COUNT = 4;
 
   const uint32_t SPLIT_MESSAGE_INTERNAL_DATA_LEN = 512;
 
-  static uint8_t* data;
-
   typedef struct {
     // Every player update has its own rng seed because it might change in between players
     uint32_t randomSeed;
@@ -68,8 +69,17 @@ namespace Slippi {
     bool randomSeedExists = false;
     uint32_t randomSeed;
     bool inputsFullyFetched = false;
-    std::unordered_map<uint8_t, PlayerFrameData> players;
-    std::unordered_map<uint8_t, PlayerFrameData> followers;
+
+    // Indexed by port. Bit n of the present masks is set when port n has data this frame
+    std::array<PlayerFrameData, PORT_COUNT> players{};
+    std::array<PlayerFrameData, PORT_COUNT> followers{};
+    uint8_t playersPresent = 0;
+    uint8_t followersPresent = 0;
+
+    bool HasPlayer(uint8_t port, bool isFollower) const {
+      uint8_t present = isFollower ? followersPresent : playersPresent;
+      return port < PORT_COUNT && (present >> port) & 1;
+    }
   } FrameData;
 
   typedef struct {
@@ -94,8 +104,15 @@ namespace Slippi {
 
   typedef struct Game {
     std::array<uint8_t, 4> version;
-    std::unordered_map<int32_t, FrameData*> framesByIndex;
-    std::vector<std::unique_ptr<FrameData>> frames;
+
+    // Every frame in the order it was received. For games with rollback, the same
+    // frame may be replayed multiple times
+    std::vector<FrameData> frames;
+
+    // Position in frames of the latest copy of each frame, indexed by frame - GAME_FIRST_FRAME.
+    // -1 for frames not received yet
+    std::vector<int32_t> framePositions;
+
     GameSettings settings;
     bool areSettingsLoaded = false;
 
@@ -105,16 +122,6 @@ namespace Slippi {
     uint8_t winCondition;
   } Game;
 
-  // TODO: This shouldn't be static. Doesn't matter too much atm because we always
-  // TODO: only read one file at a time
-  static std::unordered_map<uint8_t, uint32_t> asmEvents = {
-    { EVENT_GAME_INIT, 320 },
-    { EVENT_PRE_FRAME_UPDATE, 58 },
-    { EVENT_POST_FRAME_UPDATE, 33 },
-    { EVENT_GAME_END, 1 },
-    { EVENT_FRAME_START, 8 }
-  };
-
   class SlippiGame
   {
   public:
@@ -122,6 +129,9 @@ namespace Slippi {
     bool AreSettingsLoaded();
     bool DoesFrameExist(int32_t frame);
     std::array<uint8_t, 4> GetVersion();
+
+    // Frames live in a single array, so the returned pointers are only valid
+    // until more of the file is processed
     FrameData* GetFrame(int32_t frame);
     FrameData* GetFrameAt(uint32_t pos);
     int32_t GetLatestIndex();
@@ -131,8 +141,9 @@ namespace Slippi {
     bool IsProcessingComplete();
   private:
     std::unique_ptr<Game> game;
-    std::unique_ptr<std::ifstream> file;
-    std::vector<uint8_t> rawData;
+    MappedFile file;
+    size_t readPos = 0; // Offset of the first message not processed yet, 0 before the payload sizes are read
+    std::array<uint32_t, 256> payloadSizes{}; // Indexed by command byte
     std::string path;
     std::ofstream log;
     std::vector<uint8_t> splitMessageBuf;
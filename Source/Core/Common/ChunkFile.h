@@ -66,8 +66,13 @@ public:
 	u8** ptr;
 	Mode mode;
 
+	// End of the buffer when writing into a fixed size buffer, nullptr if unbounded.
+	// A write that doesn't fit switches to MODE_MEASURE, so the final position is the size needed.
+	u8* ptr_end = nullptr;
+
 public:
 	PointerWrap(u8** ptr_, Mode mode_) : ptr(ptr_), mode(mode_) {}
+	PointerWrap(u8** ptr_, u8* ptr_end_, Mode mode_) : ptr(ptr_), mode(mode_), ptr_end(ptr_end_) {}
 	void SetMode(Mode mode_) { mode = mode_; }
 	Mode GetMode() const { return mode; }
 	template <typename K, class V>
@@ -279,7 +284,10 @@ private:
 			break;
 
 		case MODE_WRITE:
-			memcpy(*ptr, data, size);
+			if (ptr_end && size > static_cast<size_t>(ptr_end - *ptr))
+				mode = MODE_MEASURE;
+			else
+				memcpy(*ptr, data, size);
 			break;
 
 		case MODE_MEASURE:
@@ -0,0 +1,88 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+#include "Common/CommonTypes.h"
+#include "Common/MathUtil.h"
+
+namespace Common
+{
+// Fixed size histogram of unsigned samples, such as timings in microseconds. Buckets are exact
+// below 8 and split every power of two in four above that, so percentiles are accurate to
+// within 25% over the whole range. Adding a sample never allocates. Not thread safe.
+class Histogram
+{
+public:
+	static const size_t NUM_BUCKETS = 8 + (64 - 3) * 4;
+
+	void Add(u64 value)
+	{
+		m_buckets[BucketIndex(value)]++;
+		m_count++;
+		m_sum += value;
+		m_max = std::max(m_max, value);
+	}
+
+	void Reset()
+	{
+		m_buckets.fill(0);
+		m_count = 0;
+		m_sum = 0;
+		m_max = 0;
+	}
+
+	u64 Count() const { return m_count; }
+	u64 Max() const { return m_max; }
+	u64 Mean() const { return m_count ? m_sum / m_count : 0; }
+
+	// Upper bound of the bucket holding the given percentile (0-100) of samples
+	u64 Percentile(double percentile) const
+	{
+		if (m_count == 0)
+			return 0;
+
+		u64 rank = static_cast<u64>(m_count * percentile / 100.0 + 0.5);
+		rank = std::min(std::max<u64>(rank, 1), m_count);
+
+		u64 seen = 0;
+		for (size_t i = 0; i < m_buckets.size(); i++)
+		{
+			seen += m_buckets[i];
+			if (seen >= rank)
+				return std::min(BucketUpperBound(i), m_max);
+		}
+
+		return m_max;
+	}
+
+	static size_t BucketIndex(u64 value)
+	{
+		if (value < 8)
+			return static_cast<size_t>(value);
+
+		int log2 = IntLog2(value);
+		return 8 + (log2 - 3) * 4 + ((value >> (log2 - 2)) & 3);
+	}
+
+	static u64 BucketUpperBound(size_t index)
+	{
+		if (index < 8)
+			return index;
+
+		int log2 = static_cast<int>((index - 8) / 4) + 3;
+		u64 step = 1ULL << (log2 - 2);
+		return (4 + (index - 8) % 4) * step + (step - 1);
+	}
+
+private:
+	std::array<u64, NUM_BUCKETS> m_buckets{};
+	u64 m_count = 0;
+	u64 m_sum = 0;
+	u64 m_max = 0;
+};
+}  // namespace Common
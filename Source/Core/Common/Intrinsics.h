@@ -28,4 +28,14 @@
 # endif
 #endif
 
+// Lets a function use instructions above the build's baseline. Only call such functions after
+// checking cpu_info for the matching feature.
+#if defined(__GNUC__) || defined(__clang__)
+#  define FUNCTION_TARGET_SSE41 __attribute__((target("sse4.1")))
+#  define FUNCTION_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#  define FUNCTION_TARGET_SSE41
+#  define FUNCTION_TARGET_AVX2
+#endif
+
 #endif // _M_X86
@@ -0,0 +1,132 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+// a lockless single reader, single writer queue of variable sized byte records
+// stored in a buffer allocated once up front
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "Common/Align.h"
+#include "Common/CommonTypes.h"
+
+namespace Common
+{
+class RecordQueue
+{
+public:
+	explicit RecordQueue(size_t capacity)
+	    : m_buffer(AlignUpSizePow2(capacity, RECORD_ALIGNMENT)), m_read_pos(0), m_write_pos(0)
+	{
+	}
+
+	// Largest payload Push can ever accept
+	size_t MaxRecordSize() const { return m_buffer.size() - sizeof(Header); }
+
+	// Bytes currently queued, including record headers and padding
+	size_t Size() const { return static_cast<size_t>(m_write_pos.load() - m_read_pos.load()); }
+	bool Empty() const { return m_write_pos.load() == m_read_pos.load(); }
+
+	// Writer side. Copies a record into the queue, returns false if there is not enough room
+	bool Push(u32 tag, const u8* data, u32 size)
+	{
+		const size_t capacity = m_buffer.size();
+		const u64 write_pos = m_write_pos.load(std::memory_order_relaxed);
+		const u64 read_pos = m_read_pos.load(std::memory_order_acquire);
+
+		size_t offset = static_cast<size_t>(write_pos % capacity);
+		const size_t record_size = RecordSize(size);
+
+		// Records are never split, skip whatever is left at the end of the buffer instead
+		size_t padding = 0;
+		if (offset + record_size > capacity)
+			padding = capacity - offset;
+
+		if (record_size > capacity || write_pos - read_pos + padding + record_size > capacity)
+			return false;
+
+		if (padding)
+		{
+			WriteHeader(offset, WRAP_TAG, 0);
+			offset = 0;
+		}
+
+		WriteHeader(offset, tag, size);
+		if (size)
+			std::memcpy(&m_buffer[offset + sizeof(Header)], data, size);
+
+		m_write_pos.store(write_pos + padding + record_size, std::memory_order_release);
+		return true;
+	}
+
+	// Reader side. Points at the oldest record without removing it, returns false when empty.
+	// The data stays valid until the next call to Pop
+	bool Front(u32* tag, const u8** data, u32* size)
+	{
+		const size_t capacity = m_buffer.size();
+		u64 read_pos = m_read_pos.load(std::memory_order_relaxed);
+		if (read_pos == m_write_pos.load(std::memory_order_acquire))
+			return false;
+
+		size_t offset = static_cast<size_t>(read_pos % capacity);
+		Header header = ReadHeader(offset);
+		if (header.tag == WRAP_TAG)
+		{
+			// The writer always follows a wrap marker with a record at the start of the buffer
+			read_pos += capacity - offset;
+			m_read_pos.store(read_pos, std::memory_order_release);
+			offset = 0;
+			header = ReadHeader(offset);
+		}
+
+		*tag = header.tag;
+		*size = header.size;
+		*data = &m_buffer[offset + sizeof(Header)];
+		return true;
+	}
+
+	void Pop()
+	{
+		const size_t capacity = m_buffer.size();
+		const u64 read_pos = m_read_pos.load(std::memory_order_relaxed);
+		const Header header = ReadHeader(static_cast<size_t>(read_pos % capacity));
+		m_read_pos.store(read_pos + RecordSize(header.size), std::memory_order_release);
+	}
+
+private:
+	struct Header
+	{
+		u32 tag;
+		u32 size;
+	};
+
+	static const size_t RECORD_ALIGNMENT = sizeof(Header);
+	static const u32 WRAP_TAG = 0xFFFFFFFF;
+
+	static size_t RecordSize(u32 size)
+	{
+		return sizeof(Header) + AlignUpSizePow2(static_cast<size_t>(size), RECORD_ALIGNMENT);
+	}
+
+	void WriteHeader(size_t offset, u32 tag, u32 size)
+	{
+		const Header header = {tag, size};
+		std::memcpy(&m_buffer[offset], &header, sizeof(Header));
+	}
+
+	Header ReadHeader(size_t offset) const
+	{
+		Header header;
+		std::memcpy(&header, &m_buffer[offset], sizeof(Header));
+		return header;
+	}
+
+	std::vector<u8> m_buffer;
+	std::atomic<u64> m_read_pos;
+	std::atomic<u64> m_write_pos;
+};
+}  // namespace Common
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "Common/Common.h"
 #include "Common/CPUDetect.h"
 #include "Common/ThreadPool.h"
@@ -153,4 +155,79 @@ void AsyncWorker::ExecuteAsync(std::function<void()> &&func)
 	ThreadPool::NotifyWorkPending();
 }
 
+ParallelWorker& ParallelWorker::Getinstance()
+{
+	static ParallelWorker instance;
+	return instance;
+}
+
+ParallelWorker::ParallelWorker(): m_job(nullptr), m_users(0)
+{
+	ThreadPool::RegisterWorker(this);
+}
+
+ParallelWorker::~ParallelWorker()
+{
+	ThreadPool::UnregisterWorker(this);
+}
 
+bool ParallelWorker::RunBand(Job* job)
+{
+	int band = job->next_band.fetch_add(1);
+	if (band >= job->band_count)
+		return false;
+	int lower = job->lower + band * job->band_size;
+	// The last band takes the remainder
+	int upper = band == job->band_count - 1 ? job->upper : lower + job->band_size;
+	(*job->func)(lower, upper);
+	job->done_bands.fetch_add(1);
+	return true;
+}
+
+bool ParallelWorker::NextTask()
+{
+	m_users.fetch_add(1);
+	Job* job = m_job.load();
+	bool worked = job != nullptr && RunBand(job);
+	m_users.fetch_sub(1);
+	return worked;
+}
+
+void ParallelWorker::Loop(const std::function<void(int, int)> &func, int lower, int upper, int min_band)
+{
+	int count = upper - lower;
+	if (count <= 0)
+		return;
+	int max_bands = std::max(cpu_info.logical_cpu_count, 1) * 4;
+	int band_count = std::min(count / std::max(min_band, 1), max_bands);
+	if (band_count <= 1)
+	{
+		func(lower, upper);
+		return;
+	}
+
+	ParallelWorker& instance = Getinstance();
+	std::lock_guard<std::mutex> lk(instance.m_loop_lock);
+	Job job;
+	job.func = &func;
+	job.lower = lower;
+	job.upper = upper;
+	job.band_size = count / band_count;
+	job.band_count = band_count;
+	job.next_band.store(0);
+	job.done_bands.store(0);
+	instance.m_job.store(&job);
+	for (int i = 1; i < band_count; i++)
+		ThreadPool::NotifyWorkPending();
+
+	while (instance.RunBand(&job))
+	{
+	}
+	while (job.done_bands.load() < band_count)
+		Common::YieldCPU();
+
+	// The job lives on this stack, wait for the pool threads to let go of it
+	instance.m_job.store(nullptr);
+	while (instance.m_users.load() > 0)
+		Common::YieldCPU();
+}
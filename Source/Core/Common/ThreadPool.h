@@ -33,6 +33,7 @@
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "Common/Thread.h"
@@ -471,4 +472,32 @@ public:
 	bool NextTask() override;
 	static void ExecuteAsync(std::function<void()> &&func);
 };
+
+// Runs a loop over [lower, upper) on the pool, split in bands of at least min_band iterations.
+// The calling thread takes bands as well and returns once all of them are done.
+class ParallelWorker final: IWorker
+{
+private:
+	struct Job
+	{
+		const std::function<void(int, int)>* func;
+		int lower;
+		int upper;
+		int band_size;
+		int band_count;
+		std::atomic<int> next_band;
+		std::atomic<int> done_bands;
+	};
+	std::atomic<Job*> m_job;
+	// Pool threads that may still be looking at the current job
+	std::atomic<s32> m_users;
+	std::mutex m_loop_lock;
+	static ParallelWorker &Getinstance();
+	ParallelWorker();
+	bool RunBand(Job* job);
+public:
+	virtual ~ParallelWorker();
+	bool NextTask() override;
+	static void Loop(const std::function<void(int, int)> &func, int lower, int upper, int min_band = 1);
+};
 }
@@ -134,6 +134,7 @@ struct SConfig : NonCopyable
 
 	bool m_slippiSaveReplays = true;
 	bool m_slippiReplayMonthFolders = false;
+	bool m_slippiTelemetry = false;
 	std::string m_strSlippiReplayDir;
 	bool m_coutEnabled = false;
 
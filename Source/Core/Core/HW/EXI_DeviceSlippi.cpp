@@ -6,7 +6,9 @@
 
 #include "Core/Slippi/SlippiPlayback.h"
 #include "Core/Slippi/SlippiReplayComm.h"
+#include "Core/Slippi/SlippiTelemetry.h"
 #include <SlippiGame.h>
+#include <future>
 #include <semver/include/semver200.h>
 #include <utility> // std::move
 
@@ -104,6 +106,8 @@ CEXISlippi::CEXISlippi()
 	gameFileLoader = std::make_unique<SlippiGameFileLoader>();
 	g_replayComm = std::make_unique<SlippiReplayComm>();
 
+	SlippiTelemetry::Start();
+
 	generator = std::default_random_engine(Common::Timer::GetTimeMs());
 
 	shouldOutput = SConfig::GetInstance().m_coutEnabled && g_replayComm->getSettings().mode != "mirror";
@@ -194,8 +198,9 @@ CEXISlippi::~CEXISlippi()
 	// Closes file gracefully to prevent file corruption when emulation
 	// suddenly stops. This would happen often on netplay when the opponent
 	// would close the emulation before the file successfully finished writing
-	writeToFileAsync(&empty[0], 0, "close");
+	writeToFileAsync(&empty[0], 0, FILE_WRITE_CLOSE);
 	writeThreadRunning = false;
+	fileWriteEvent.Set();
 	if (m_fileWriteThread.joinable())
 	{
 		m_fileWriteThread.join();
@@ -206,6 +211,8 @@ CEXISlippi::~CEXISlippi()
 	// Kill threads to prevent cleanup crash
 	g_playbackStatus->resetPlayback();
 
+	SlippiTelemetry::Stop();
+
 	// TODO: ENET shutdown should maybe be done at app shutdown instead.
 	// Right now this might be problematic in the case where someone starts a netplay client
 	// and then queues into online matchmaking, and then stops the game. That might deinit
@@ -226,7 +233,7 @@ void CEXISlippi::configureCommands(u8 *payload, u8 length)
 	}
 }
 
-void CEXISlippi::updateMetadataFields(u8 *payload, u32 length)
+void CEXISlippi::updateMetadataFields(const u8 *payload, u32 length)
 {
 	if (length <= 0 || payload[0] != CMD_RECEIVE_POST_FRAME_UPDATE)
 	{
@@ -360,14 +367,14 @@ std::vector<u8> CEXISlippi::generateMetadata()
 	return metadata;
 }
 
-void CEXISlippi::writeToFileAsync(u8 *payload, u32 length, std::string fileOption)
+void CEXISlippi::writeToFileAsync(u8 *payload, u32 length, u32 fileOption)
 {
 	if (!SConfig::GetInstance().m_slippiSaveReplays)
 	{
 		return;
 	}
 
-	if (fileOption == "create" && !writeThreadRunning)
+	if (fileOption == FILE_WRITE_CREATE && !writeThreadRunning)
 	{
 		WARN_LOG(SLIPPI, "Creating file write thread...");
 		writeThreadRunning = true;
@@ -379,48 +386,75 @@ void CEXISlippi::writeToFileAsync(u8 *payload, u32 length, std::string fileOptio
 		return;
 	}
 
-	std::vector<u8> payloadData;
-	payloadData.insert(payloadData.end(), payload, payload + length);
+	if (length > fileWriteQueue.MaxRecordSize())
+	{
+		ERROR_LOG(SLIPPI, "Replay message of %u bytes is too large to write", length);
+		return;
+	}
 
-	auto writeMsg = std::make_unique<WriteMessage>();
-	writeMsg->data = payloadData;
-	writeMsg->operation = fileOption;
+	// Only stall the game if the write thread has fallen a whole queue behind
+	while (!fileWriteQueue.Push(fileOption, payload, length))
+	{
+		fileWriteEvent.Set();
+		Common::YieldCPU();
+	}
 
-	fileWriteQueue.Push(std::move(writeMsg));
+	// Frame data is left to accumulate so it gets written in large batches
+	if (fileOption != FILE_WRITE_APPEND || fileWriteQueue.Size() >= FILE_WRITE_BATCH_SIZE)
+	{
+		fileWriteEvent.Set();
+	}
 }
 
 void CEXISlippi::FileWriteThread(void)
 {
+	Common::SetCurrentThreadName("Slippi File Write");
+
 	while (writeThreadRunning || !fileWriteQueue.Empty())
 	{
 		// Process all messages
-		while (!fileWriteQueue.Empty())
+		u32 fileOption;
+		const u8 *payload;
+		u32 length;
+		while (fileWriteQueue.Front(&fileOption, &payload, &length))
 		{
-			writeToFile(std::move(fileWriteQueue.Front()));
+			writeToFile(payload, length, fileOption);
 			fileWriteQueue.Pop();
-
-			Common::SleepCurrentThread(0);
 		}
 
-		Common::SleepCurrentThread(WRITE_FILE_SLEEP_TIME_MS);
+		flushFileWriteBuffer();
+
+		if (writeThreadRunning)
+		{
+			fileWriteEvent.WaitFor(std::chrono::milliseconds(WRITE_FILE_SLEEP_TIME_MS));
+		}
 	}
 }
 
-void CEXISlippi::writeToFile(std::unique_ptr<WriteMessage> msg)
+void CEXISlippi::flushFileWriteBuffer()
 {
-	if (!msg)
+	if (fileWriteBuffer.empty())
 	{
-		ERROR_LOG(SLIPPI, "Unexpected error: write message is falsy.");
 		return;
 	}
 
-	u8 *payload = &msg->data[0];
-	u32 length = (u32)msg->data.size();
-	std::string fileOption = msg->operation;
+	// Write data to file
+	bool result = m_file.WriteBytes(&fileWriteBuffer[0], fileWriteBuffer.size());
+	if (!result)
+	{
+		ERROR_LOG(EXPANSIONINTERFACE, "Failed to write data to file.");
+	}
+
+	fileWriteBuffer.clear();
+}
 
-	std::vector<u8> dataToWrite;
-	if (fileOption == "create")
+void CEXISlippi::writeToFile(const u8 *payload, u32 length, u32 fileOption)
+{
+	if (fileOption == FILE_WRITE_CREATE)
 	{
+		// Anything still buffered belongs to the previous file
+		flushFileWriteBuffer();
+
 		// If the game sends over option 1 that means a file should be created
 		createNewFile();
 
@@ -428,7 +462,7 @@ void CEXISlippi::writeToFile(std::unique_ptr<WriteMessage> msg)
 		// data output will be dumped into. The size of the raw output will
 		// be initialized to 0 until all of the data has been received
 		std::vector<u8> headerBytes({'{', 'U', 3, 'r', 'a', 'w', '[', '$', 'U', '#', 'l', 0, 0, 0, 0});
-		dataToWrite.insert(dataToWrite.end(), headerBytes.begin(), headerBytes.end());
+		fileWriteBuffer.insert(fileWriteBuffer.end(), headerBytes.begin(), headerBytes.end());
 
 		// Used to keep track of how many bytes have been written to the file
 		writtenByteCount = 0;
@@ -459,6 +493,7 @@ void CEXISlippi::writeToFile(std::unique_ptr<WriteMessage> msg)
 	// If no file, do nothing
 	if (!m_file)
 	{
+		fileWriteBuffer.clear();
 		return;
 	}
 
@@ -466,32 +501,23 @@ void CEXISlippi::writeToFile(std::unique_ptr<WriteMessage> msg)
 	updateMetadataFields(payload, length);
 
 	// Add the payload to data to write
-	dataToWrite.insert(dataToWrite.end(), payload, payload + length);
+	fileWriteBuffer.insert(fileWriteBuffer.end(), payload, payload + length);
 	writtenByteCount += length;
 
 	// If we are going to close the file, generate data to complete the UBJSON file
-	if (fileOption == "close")
+	if (fileOption == FILE_WRITE_CLOSE)
 	{
 		// This option indicates we are done sending over body
 		std::vector<u8> closingBytes = generateMetadata();
 		closingBytes.push_back('}');
-		dataToWrite.insert(dataToWrite.end(), closingBytes.begin(), closingBytes.end());
+		fileWriteBuffer.insert(fileWriteBuffer.end(), closingBytes.begin(), closingBytes.end());
 
 		// Reset display names and connect codes retrieved from netplay client
 		slippi_names.clear();
 		slippi_connect_codes.clear();
-	}
 
-	// Write data to file
-	bool result = m_file.WriteBytes(&dataToWrite[0], dataToWrite.size());
-	if (!result)
-	{
-		ERROR_LOG(EXPANSIONINTERFACE, "Failed to write data to file.");
-	}
+		flushFileWriteBuffer();
 
-	// If file should be closed, close it
-	if (fileOption == "close")
-	{
 		// Write the number of bytes for the raw output
 		std::vector<u8> sizeBytes = uint32ToVector(writtenByteCount);
 		m_file.Seek(11, 0);
@@ -710,24 +736,13 @@ void CEXISlippi::prepareGameInfo(u8 *payload)
 
 	if (replayCommSettings.rollbackDisplayMethod != "off")
 	{
-		// Prepare savestates
-		availableSavestates.clear();
-		activeSavestates.clear();
-
 		// Prepare savestates for online play
-		for (int i = 0; i < ROLLBACK_MAX_FRAMES; i++)
-		{
-			availableSavestates.push_back(std::make_unique<SlippiSavestate>());
-		}
+		prepareSavestates(ROLLBACK_MAX_FRAMES);
 	}
 	else
 	{
-		// Prepare savestates
-		availableSavestates.clear();
-		activeSavestates.clear();
-
 		// Add savestate for testing
-		availableSavestates.push_back(std::make_unique<SlippiSavestate>());
+		prepareSavestates(1);
 	}
 
 	// Reset playback frame to begining
@@ -1097,14 +1112,11 @@ void CEXISlippi::prepareGeckoList()
 
 void CEXISlippi::prepareCharacterFrameData(Slippi::FrameData *frame, u8 port, u8 isFollower)
 {
-	std::unordered_map<uint8_t, Slippi::PlayerFrameData> source;
-	source = isFollower ? frame->followers : frame->players;
-
 	// This must be updated if new data is added
 	int characterDataLen = 49;
 
 	// Check if player exists
-	if (!source.count(port))
+	if (!frame->HasPlayer(port, isFollower))
 	{
 		// If player does not exist, insert blank section
 		m_read_queue.insert(m_read_queue.end(), characterDataLen, 0);
@@ -1112,7 +1124,7 @@ void CEXISlippi::prepareCharacterFrameData(Slippi::FrameData *frame, u8 port, u8
 	}
 
 	// Get data for this player
-	Slippi::PlayerFrameData data = source[port];
+	const Slippi::PlayerFrameData &data = isFollower ? frame->followers[port] : frame->players[port];
 
 	// log << frameIndex << "\t" << port << "\t" << data.locationX << "\t" << data.locationY << "\t" <<
 	// data.animation
@@ -1375,9 +1387,8 @@ void CEXISlippi::prepareIsStockSteal(u8 *payload)
 
 	// Load the data from this frame into the read buffer
 	Slippi::FrameData *frame = m_current_game->GetFrame(frameIndex);
-	auto players = frame->players;
 
-	u8 playerIsBack = players.count(playerIndex) ? 1 : 0;
+	u8 playerIsBack = frame->HasPlayer(playerIndex, false) ? 1 : 0;
 	m_read_queue.push_back(playerIsBack);
 }
 
@@ -1437,14 +1448,8 @@ void CEXISlippi::handleOnlineInputs(u8 *payload)
 
 	if (frame == 1)
 	{
-		availableSavestates.clear();
-		activeSavestates.clear();
-
 		// Prepare savestates for online play
-		for (int i = 0; i < ROLLBACK_MAX_FRAMES; i++)
-		{
-			availableSavestates.push_back(std::make_unique<SlippiSavestate>());
-		}
+		prepareSavestates(ROLLBACK_MAX_FRAMES);
 
 		// Reset stall counter
 		isConnectionStalled = false;
@@ -1500,26 +1505,34 @@ bool CEXISlippi::shouldSkipOnlineFrame(s32 frame)
 		return true;
 	}
 
+	if (stallFrameCount > 0)
+		SlippiTelemetry::Record(SlippiTelemetry::Metric::StallFrames, stallFrameCount);
 	stallFrameCount = 0;
 
-	// Return true if we are over 60% of a frame ahead of our opponent. Currently limiting how
-	// often this happens because I'm worried about jittery data causing a lot of unneccesary delays.
-	// Only skip once for a given frame because our time detection method doesn't take into consideration
-	// waiting for a frame. Also it's less jarring and it happens often enough that it will smoothly
-	// get to the right place
+	// Time sync every 30 frames. Small offsets are absorbed by stretching the frame limiter's sleep
+	// over the next frames; only a large offset, like at the start of a game, halts whole frames. Only
+	// skip once for a given frame because our time detection method doesn't take into consideration
+	// waiting for a frame
 	auto isTimeSyncFrame = frame % SLIPPI_ONLINE_LOCKSTEP_INTERVAL; // Only time sync every 30 frames
 	if (isTimeSyncFrame == 0 && !isCurrentlySkipping)
 	{
-		auto offsetUs = slippi_netplay->CalcTimeOffsetUs();
+		auto offsetUs = slippi_netplay->GetSlippiTimeOffsetUs();
+		auto correction = slippi_netplay->UpdateTimeSync(frame);
 		INFO_LOG(SLIPPI_ONLINE, "[Frame %d] Offset is: %d us", frame, offsetUs);
 
-		if (offsetUs > 10000)
+		if (offsetUs >= 0)
+			SlippiTelemetry::Record(SlippiTelemetry::Metric::TimeAheadUs, offsetUs);
+		else
+			SlippiTelemetry::Record(SlippiTelemetry::Metric::TimeBehindUs, -(s64)offsetUs);
+
+		if (correction.delayUs > 0)
+			SystemTimers::DelayThrottle(correction.delayUs);
+
+		if (correction.skipFrames > 0)
 		{
 			isCurrentlySkipping = true;
-
-			int maxSkipFrames = frame <= 120 ? 5 : 1; // On early frames, support skipping more frames
-			framesToSkip = ((offsetUs - 10000) / 16683) + 1;
-			framesToSkip = framesToSkip > maxSkipFrames ? maxSkipFrames : framesToSkip; // Only skip 5 frames max
+			framesToSkip = correction.skipFrames;
+			SlippiTelemetry::Record(SlippiTelemetry::Metric::SkippedFrames, framesToSkip);
 
 			WARN_LOG(SLIPPI_ONLINE, "Halting on frame %d due to time sync. Offset: %d us. Frames: %d...", frame,
 			         offsetUs, framesToSkip);
@@ -1529,8 +1542,6 @@ bool CEXISlippi::shouldSkipOnlineFrame(s32 frame)
 	// Handle the skipped frames
 	if (framesToSkip > 0)
 	{
-		// If ahead by 60% of a frame, stall. I opted to use 60% instead of half a frame
-		// because I was worried about two systems continuously stalling for each other
 		framesToSkip = framesToSkip - 1;
 		return true;
 	}
@@ -1548,9 +1559,9 @@ void CEXISlippi::handleSendInputs(u8 *payload)
 	int32_t frame = payload[0] << 24 | payload[1] << 16 | payload[2] << 8 | payload[3];
 	u8 delay = payload[4];
 
-	auto pad = std::make_unique<SlippiPad>(frame + delay, &payload[5]);
+	SlippiPad pad(frame + delay, &payload[5]);
 
-	slippi_netplay->SendSlippiPad(std::move(pad));
+	slippi_netplay->SendSlippiPad(&pad);
 }
 
 void CEXISlippi::prepareOpponentInputs(u8 *payload)
@@ -1569,72 +1580,61 @@ void CEXISlippi::prepareOpponentInputs(u8 *payload)
 
 	int32_t frame = payload[0] << 24 | payload[1] << 16 | payload[2] << 8 | payload[3];
 
-	auto result = slippi_netplay->GetSlippiRemotePad(frame);
-
-	// determine offset from which to copy data
-	int offset = (result->latestFrame - frame) * SLIPPI_PAD_FULL_SIZE;
-	offset = offset < 0 ? 0 : offset;
+	u8 remotePads[SLIPPI_PAD_FULL_SIZE * ROLLBACK_MAX_FRAMES];
+	int32_t latestFrame = slippi_netplay->GetSlippiRemotePad(frame, remotePads, ROLLBACK_MAX_FRAMES);
 
 	// add latest frame we are transfering to begining of return buf
-	int32_t latestFrame = offset > 0 ? frame : result->latestFrame;
 	appendWordToBuffer(&m_read_queue, *(u32 *)&latestFrame);
 
 	// copy pad data over
-	auto txStart = result->data.begin() + offset;
-	auto txEnd = result->data.end();
-
-	std::vector<u8> tx;
-	tx.insert(tx.end(), txStart, txEnd);
-	tx.resize(SLIPPI_PAD_FULL_SIZE * ROLLBACK_MAX_FRAMES, 0);
-
-	m_read_queue.insert(m_read_queue.end(), tx.begin(), tx.end());
+	m_read_queue.insert(m_read_queue.end(), std::begin(remotePads), std::end(remotePads));
 
 	// ERROR_LOG(SLIPPI_ONLINE, "EXI: [%d] %X %X %X %X %X %X %X %X", latestFrame, m_read_queue[5], m_read_queue[6],
 	// m_read_queue[7], m_read_queue[8], m_read_queue[9], m_read_queue[10], m_read_queue[11], m_read_queue[12]);
 }
 
+void CEXISlippi::prepareSavestates(int maxFrames)
+{
+	// Report what is left over from the previous game
+	if (captureTimes.Count() || loadTimes.Count())
+		reportSavestateTimings();
+
+	// Reuse the existing storage when possible
+	if (savestates && savestates->GetMaxFrames() == maxFrames)
+	{
+		savestates->Clear();
+		return;
+	}
+
+	// Release the previous savestates first, only one of them can track memory writes at a time
+	savestates.reset();
+	savestates = std::make_unique<SlippiSavestate>(maxFrames);
+}
+
 void CEXISlippi::handleCaptureSavestate(u8 *payload)
 {
 	s32 frame = payload[0] << 24 | payload[1] << 16 | payload[2] << 8 | payload[3];
 
 	u64 startTime = Common::Timer::GetTimeUs();
 
-	// Grab an available savestate
-	std::unique_ptr<SlippiSavestate> ss;
-	if (!availableSavestates.empty())
-	{
-		ss = std::move(availableSavestates.back());
-		availableSavestates.pop_back();
-	}
-	else
-	{
-		// If there were no available savestates, use the oldest one
-		auto it = activeSavestates.begin();
-		ss = std::move(it->second);
-		activeSavestates.erase(it->first);
-	}
+	if (!savestates)
+		prepareSavestates(ROLLBACK_MAX_FRAMES);
 
-	// If there is already a savestate for this frame, remove it and add it to available
-	if (activeSavestates.count(frame))
-	{
-		availableSavestates.push_back(std::move(activeSavestates[frame]));
-		activeSavestates.erase(frame);
-	}
+	savestates->Capture(frame);
+	lastCapturedFrame = frame;
 
-	ss->Capture();
-	activeSavestates[frame] = std::move(ss);
-
-	u32 timeDiff = (u32)(Common::Timer::GetTimeUs() - startTime);
-	INFO_LOG(SLIPPI_ONLINE, "SLIPPI ONLINE: Captured savestate for frame %d in: %f ms", frame,
-	         ((double)timeDiff) / 1000);
+	u64 captureTime = Common::Timer::GetTimeUs() - startTime;
+	captureTimes.Add(captureTime);
+	SlippiTelemetry::Record(SlippiTelemetry::Metric::CaptureTimeUs, captureTime);
+	if (captureTimes.Count() >= SAVESTATE_TIMING_REPORT_INTERVAL)
+		reportSavestateTimings();
 }
 
 void CEXISlippi::handleLoadSavestate(u8 *payload)
 {
 	s32 frame = payload[0] << 24 | payload[1] << 16 | payload[2] << 8 | payload[3];
-	u32 *preserveArr = (u32 *)(&payload[4]);
 
-	if (!activeSavestates.count(frame))
+	if (!savestates || !savestates->HasFrame(frame))
 	{
 		// This savestate does not exist... uhhh? What do we do?
 		ERROR_LOG(SLIPPI_ONLINE, "SLIPPI ONLINE: Savestate for frame %d does not exist.", frame);
@@ -1644,30 +1644,30 @@ void CEXISlippi::handleLoadSavestate(u8 *payload)
 	u64 startTime = Common::Timer::GetTimeUs();
 
 	// Fetch preservation blocks
-	std::vector<SlippiSavestate::PreserveBlock> blocks;
+	std::vector<SlippiSavestate::PreserveBlock> blocks = SlippiSavestate::ReadPreserveBlocks(&payload[4]);
 
-	// Get preservation blocks
-	int idx = 0;
-	while (Common::swap32(preserveArr[idx]) != 0)
-	{
-		SlippiSavestate::PreserveBlock p = {Common::swap32(preserveArr[idx]), Common::swap32(preserveArr[idx + 1])};
-		blocks.push_back(p);
-		idx += 2;
-	}
-
-	// Load savestate
-	activeSavestates[frame]->Load(blocks);
-
-	// Move all active savestates to available
-	for (auto it = activeSavestates.begin(); it != activeSavestates.end(); ++it)
-	{
-		availableSavestates.push_back(std::move(it->second));
-	}
+	// Load savestate. This also discards every frame captured after it
+	savestates->Load(frame, blocks);
 
-	activeSavestates.clear();
+	u64 loadTime = Common::Timer::GetTimeUs() - startTime;
+	loadTimes.Add(loadTime);
+	SlippiTelemetry::Record(SlippiTelemetry::Metric::LoadTimeUs, loadTime);
+	if (lastCapturedFrame >= frame)
+		SlippiTelemetry::Record(SlippiTelemetry::Metric::RollbackDepth, lastCapturedFrame - frame);
+}
 
-	u32 timeDiff = (u32)(Common::Timer::GetTimeUs() - startTime);
-	INFO_LOG(SLIPPI_ONLINE, "SLIPPI ONLINE: Loaded savestate for frame %d in: %f ms", frame, ((double)timeDiff) / 1000);
+void CEXISlippi::reportSavestateTimings()
+{
+	INFO_LOG(SLIPPI_ONLINE,
+	         "SLIPPI ONLINE: Savestate capture us (n=%llu) p50: %llu, p99: %llu, max: %llu | load us (n=%llu) "
+	         "p50: %llu, p99: %llu, max: %llu",
+	         (unsigned long long)captureTimes.Count(), (unsigned long long)captureTimes.Percentile(50),
+	         (unsigned long long)captureTimes.Percentile(99), (unsigned long long)captureTimes.Max(),
+	         (unsigned long long)loadTimes.Count(), (unsigned long long)loadTimes.Percentile(50),
+	         (unsigned long long)loadTimes.Percentile(99), (unsigned long long)loadTimes.Max());
+
+	captureTimes.Reset();
+	loadTimes.Reset();
 }
 
 void CEXISlippi::startFindMatch(u8 *payload)
@@ -2138,7 +2138,7 @@ void CEXISlippi::DMAWrite(u32 _uAddr, u32 _uSize)
 		time(&gameStartTime); // Store game start time
 		u8 receiveCommandsLen = memPtr[1];
 		configureCommands(&memPtr[1], receiveCommandsLen);
-		writeToFileAsync(&memPtr[0], receiveCommandsLen + 1, "create");
+		writeToFileAsync(&memPtr[0], receiveCommandsLen + 1, FILE_WRITE_CREATE);
 		bufLoc += receiveCommandsLen + 1;
 	}
 
@@ -2160,7 +2160,7 @@ void CEXISlippi::DMAWrite(u32 _uAddr, u32 _uSize)
 		switch (byte)
 		{
 		case CMD_RECEIVE_GAME_END:
-			writeToFileAsync(&memPtr[bufLoc], payloadLen + 1, "close");
+			writeToFileAsync(&memPtr[bufLoc], payloadLen + 1, FILE_WRITE_CLOSE);
 			break;
 		case CMD_PREPARE_REPLAY:
 			// log.open("log.txt");
@@ -2222,7 +2222,7 @@ void CEXISlippi::DMAWrite(u32 _uAddr, u32 _uSize)
 			handleUpdateAppRequest();
 			break;
 		default:
-			writeToFileAsync(&memPtr[bufLoc], payloadLen + 1, "");
+			writeToFileAsync(&memPtr[bufLoc], payloadLen + 1, FILE_WRITE_APPEND);
 			break;
 		}
 
@@ -5,9 +5,13 @@
 #pragma once
 
 #include <SlippiGame.h>
+#include <atomic>
 
 #include "Common/CommonTypes.h"
+#include "Common/Event.h"
 #include "Common/FileUtil.h"
+#include "Common/Histogram.h"
+#include "Common/RecordQueue.h"
 #include "Core/HW/EXI_Device.h"
 #include "Core/Slippi/SlippiGameFileLoader.h"
 #include "Core/Slippi/SlippiMatchmaking.h"
@@ -19,6 +23,9 @@
 #define ROLLBACK_MAX_FRAMES 7
 #define MAX_NAME_LENGTH 15
 #define CONNECT_CODE_LENGTH 8
+#define SAVESTATE_TIMING_REPORT_INTERVAL 600 // Captures between savestate timing reports
+#define FILE_WRITE_QUEUE_SIZE (1024 * 1024)
+#define FILE_WRITE_BATCH_SIZE (64 * 1024) // Queued bytes that wake the file write thread early
 
 // Emulated Slippi device used to receive and respond to in-game messages
 class CEXISlippi : public IEXIDevice
@@ -112,10 +119,11 @@ class CEXISlippi : public IEXIDevice
 	    {CMD_FILE_LOAD, 0x40},
 	};
 
-	struct WriteMessage
+	enum
 	{
-		std::vector<u8> data;
-		std::string operation;
+		FILE_WRITE_APPEND = 0,
+		FILE_WRITE_CREATE = 1,
+		FILE_WRITE_CLOSE = 2,
 	};
 
 	// .slp File creation stuff
@@ -130,10 +138,11 @@ class CEXISlippi : public IEXIDevice
 	s32 lastFrame;
 	std::unordered_map<u8, std::unordered_map<u8, u32>> characterUsage;
 
-	void updateMetadataFields(u8 *payload, u32 length);
+	void updateMetadataFields(const u8 *payload, u32 length);
 	void configureCommands(u8 *payload, u8 length);
-	void writeToFileAsync(u8 *payload, u32 length, std::string fileOption);
-	void writeToFile(std::unique_ptr<WriteMessage> msg);
+	void writeToFileAsync(u8 *payload, u32 length, u32 fileOption);
+	void writeToFile(const u8 *payload, u32 length, u32 fileOption);
+	void flushFileWriteBuffer();
 	std::vector<u8> generateMetadata();
 	void createNewFile();
 	void closeFile();
@@ -153,6 +162,8 @@ class CEXISlippi : public IEXIDevice
 	void handleSendInputs(u8 *payload);
 	void handleCaptureSavestate(u8 *payload);
 	void handleLoadSavestate(u8 *payload);
+	void prepareSavestates(int maxFrames);
+	void reportSavestateTimings();
 	void startFindMatch(u8 *payload);
 	void prepareOnlineMatchState();
 	void setMatchSelections(u8 *payload);
@@ -178,8 +189,11 @@ class CEXISlippi : public IEXIDevice
 
 	void FileWriteThread(void);
 
-	Common::FifoQueue<std::unique_ptr<WriteMessage>, false> fileWriteQueue;
-	bool writeThreadRunning = false;
+	// Messages to write, filled by the emulation thread and drained by the file write thread
+	Common::RecordQueue fileWriteQueue{FILE_WRITE_QUEUE_SIZE};
+	Common::Event fileWriteEvent;
+	std::atomic<bool> writeThreadRunning{false};
+	std::vector<u8> fileWriteBuffer;
 	std::thread m_fileWriteThread;
 
 	std::unordered_map<u8, std::string> getNetplayNames();
@@ -219,6 +233,12 @@ class CEXISlippi : public IEXIDevice
 	std::unique_ptr<SlippiNetplayClient> slippi_netplay;
 	std::unique_ptr<SlippiMatchmaking> matchmaking;
 
-	std::map<s32, std::unique_ptr<SlippiSavestate>> activeSavestates;
-	std::deque<std::unique_ptr<SlippiSavestate>> availableSavestates;
+	std::unique_ptr<SlippiSavestate> savestates;
+
+	// Savestate capture and load times in microseconds since the last report
+	Common::Histogram captureTimes;
+	Common::Histogram loadTimes;
+
+	// Latest frame captured, to know how deep a rollback goes
+	s32 lastCapturedFrame = 0;
 };
@@ -7,6 +7,9 @@
 // However, if a JITed instruction (for example lwz) wants to access a bad memory area that call
 // may be redirected here (for example to Read_U32()).
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstring>
 #include <memory>
 
@@ -15,6 +18,7 @@
 #include "Common/CommonTypes.h"
 #include "Common/Logging/Log.h"
 #include "Common/MemArena.h"
+#include "Common/MemoryUtil.h"
 #include "Core/ConfigManager.h"
 #include "Core/HW/AudioInterface.h"
 #include "Core/HW/DSP.h"
@@ -164,6 +168,18 @@ static MemoryView views[] = {
 	{ nullptr, 0x2D0000000, EXRAM_SIZE, MV_WII_ONLY | MV_MIRROR_PREVIOUS },
 };
 static const int num_views = sizeof(views) / sizeof(MemoryView);
+// The first views are all mappings of the same 32MB of RAM
+static const int num_ram_views = 4;
+
+// Write tracking state, one entry per page of RAM
+enum : u8
+{
+	PAGE_UNTRACKED = 0,
+	PAGE_CLEAN,
+	PAGE_DIRTY,
+};
+static std::array<std::atomic<u8>, TRACKED_PAGE_COUNT> s_page_state;
+static std::atomic<bool> s_write_tracking_enabled{false};
 
 void Init()
 {
@@ -213,6 +229,7 @@ void DoState(PointerWrap& p)
 
 void Shutdown()
 {
+	StopWriteTracking();
 	m_IsInitialized = false;
 	u32 flags = 0;
 	if (SConfig::GetInstance().bWii)
@@ -246,6 +263,134 @@ bool AreMemoryBreakpointsActivated()
 #endif
 }
 
+static void SetPageProtection(u32 first_page, u32 count, bool write_protect)
+{
+	for (int i = 0; i < num_ram_views; i++)
+	{
+		u8* ptr = static_cast<u8*>(views[i].view_ptr) + (first_page << TRACKED_PAGE_SHIFT);
+		if (write_protect)
+			Common::WriteProtectMemory(ptr, count << TRACKED_PAGE_SHIFT);
+		else
+			Common::UnWriteProtectMemory(ptr, count << TRACKED_PAGE_SHIFT);
+	}
+}
+
+bool IsWriteTrackingSupported()
+{
+	// Faults on the RAM views are only routed back to us when the fastmem handler is installed,
+	// and the Mach handler only watches the CPU thread while the GPU thread also writes RAM.
+#if defined(_ARCH_64) && !defined(_M_GENERIC) && (!defined(__APPLE__) || defined(USE_SIGACTION_ON_APPLE))
+	return m_IsInitialized && SConfig::GetInstance().bFastmem;
+#else
+	return false;
+#endif
+}
+
+bool TrackWrites(u32 address, u32 size)
+{
+	if (size == 0 || !IsWriteTrackingSupported())
+		return false;
+
+	address &= RAM_MASK;
+	u32 first_page = address >> TRACKED_PAGE_SHIFT;
+	u32 last_page = (address + size - 1) >> TRACKED_PAGE_SHIFT;
+	if (last_page >= TRACKED_PAGE_COUNT)
+		return false;
+
+	for (u32 page = first_page; page <= last_page; page++)
+		s_page_state[page].store(PAGE_CLEAN);
+	SetPageProtection(first_page, last_page - first_page + 1, true);
+
+	s_write_tracking_enabled.store(true);
+	return true;
+}
+
+void StopWriteTracking()
+{
+	if (!s_write_tracking_enabled.exchange(false))
+		return;
+
+	u32 page = 0;
+	while (page < TRACKED_PAGE_COUNT)
+	{
+		if (s_page_state[page].load() == PAGE_UNTRACKED)
+		{
+			page++;
+			continue;
+		}
+
+		u32 first_page = page;
+		while (page < TRACKED_PAGE_COUNT && s_page_state[page].load() != PAGE_UNTRACKED)
+			page++;
+		SetPageProtection(first_page, page - first_page, false);
+		for (u32 i = first_page; i < page; i++)
+			s_page_state[i].store(PAGE_UNTRACKED);
+	}
+}
+
+bool IsWriteTrackingEnabled()
+{
+	return s_write_tracking_enabled.load();
+}
+
+void CollectDirtyPages(std::vector<u32>* pages)
+{
+	if (!s_write_tracking_enabled.load())
+		return;
+
+	for (u32 page = 0; page < TRACKED_PAGE_COUNT; page++)
+	{
+		// Clear the flag before protecting again. A write landing in between is still part of
+		// this batch, and one landing after faults and dirties the page for the next batch.
+		u8 expected = PAGE_DIRTY;
+		if (!s_page_state[page].compare_exchange_strong(expected, PAGE_CLEAN))
+			continue;
+
+		SetPageProtection(page, 1, true);
+		pages->push_back(page);
+	}
+}
+
+void MarkPagesDirty(u32 address, u32 size)
+{
+	if (size == 0 || !s_write_tracking_enabled.load())
+		return;
+
+	address &= RAM_MASK;
+	u32 first_page = address >> TRACKED_PAGE_SHIFT;
+	u32 last_page = std::min<u32>((address + size - 1) >> TRACKED_PAGE_SHIFT, TRACKED_PAGE_COUNT - 1);
+	for (u32 page = first_page; page <= last_page; page++)
+	{
+		if (s_page_state[page].load() != PAGE_CLEAN)
+			continue;
+
+		SetPageProtection(page, 1, false);
+		s_page_state[page].store(PAGE_DIRTY);
+	}
+}
+
+bool HandleWriteTrackingFault(uintptr_t access_address)
+{
+	for (int i = 0; i < num_ram_views; i++)
+	{
+		uintptr_t base = reinterpret_cast<uintptr_t>(views[i].view_ptr);
+		if (!base || access_address < base || access_address >= base + RAM_SIZE)
+			continue;
+
+		u32 page = static_cast<u32>((access_address - base) >> TRACKED_PAGE_SHIFT);
+		if (s_page_state[page].load() == PAGE_UNTRACKED)
+			return false;
+
+		// Unprotect before flagging so that CollectDirtyPages never protects a page again while
+		// this write is still pending.
+		SetPageProtection(page, 1, false);
+		s_page_state[page].store(PAGE_DIRTY);
+		return true;
+	}
+
+	return false;
+}
+
 static inline u8* GetPointerForRange(u32 address, size_t size)
 {
 	// Make sure we don't have a range spanning 2 separate banks
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Common/CommonFuncs.h"
 #include "Common/CommonTypes.h"
@@ -78,6 +79,28 @@ void DoState(PointerWrap& p);
 void Clear();
 bool AreMemoryBreakpointsActivated();
 
+// Dirty page tracking for RAM. Tracked pages are write-protected in every RAM view, so the
+// first write to one of them faults into HandleWriteTrackingFault, which marks the page dirty
+// and lifts the protection. This relies on the fastmem exception handler being installed.
+enum
+{
+	TRACKED_PAGE_SHIFT = 12,
+	TRACKED_PAGE_SIZE = 1 << TRACKED_PAGE_SHIFT,
+	TRACKED_PAGE_COUNT = RAM_SIZE >> TRACKED_PAGE_SHIFT,
+};
+
+bool IsWriteTrackingSupported();
+// Starts tracking every page overlapping [address, address + size)
+bool TrackWrites(u32 address, u32 size);
+void StopWriteTracking();
+bool IsWriteTrackingEnabled();
+// Appends the indices of pages written since the last call and write-protects them again
+void CollectDirtyPages(std::vector<u32>* pages);
+// Lifts protection on tracked pages about to be written by the host and marks them dirty
+void MarkPagesDirty(u32 address, u32 size);
+bool HandleWriteTrackingFault(uintptr_t access_address);
+
+
 // Routines to access physically addressed memory, designed for use by
 // emulated hardware outside the CPU. Use "Device_" prefix.
 std::string GetString(u32 em_address, size_t size = 0);
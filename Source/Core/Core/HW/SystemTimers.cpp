@@ -43,6 +43,8 @@ IPC_HLE_PERIOD: For the Wii Remote this is the call schedule:
 			CWII_IPC_HLE_WiiMote::Update()
 */
 
+#include <algorithm>
+
 #include "Core/HW/SystemTimers.h"
 #include "Common/Atomic.h"
 #include "Common/CommonTypes.h"
@@ -73,6 +75,12 @@ static CoreTiming::EventType* et_IPC_HLE;
 static CoreTiming::EventType* et_PatchEngine;
 static CoreTiming::EventType* et_Throttle;
 
+// Real time the throttle still has to add, and the part of a millisecond added so far.
+// At most a quarter of each 1ms throttle event is added.
+static const u32 MAX_THROTTLE_STRETCH_US = 250;
+static u32 s_throttle_delay_us;
+static u32 s_throttle_stretch_us;
+
 static u32 s_cpu_core_clock = 486000000u;  // 486 mhz (its not 485, stop bugging me!)
 
 // These two are badly educated guesses.
@@ -180,9 +188,25 @@ static void ThrottleCallback(u64 last_time, s64 cyclesLate)
 
 	u32 time = Common::Timer::GetTimeMs();
 
-	int diff = (u32)last_time - time;
 	const SConfig& config = SConfig::GetInstance();
 	bool frame_limiter = config.m_EmulationSpeed > 0.0f && !Core::GetIsThrottlerTempDisabled();
+	if (!frame_limiter)
+	{
+		s_throttle_delay_us = 0;
+	}
+	else if (s_throttle_delay_us)
+	{
+		u32 stretch = std::min(s_throttle_delay_us, MAX_THROTTLE_STRETCH_US);
+		s_throttle_delay_us -= stretch;
+		s_throttle_stretch_us += stretch;
+		if (s_throttle_stretch_us >= 1000)
+		{
+			s_throttle_stretch_us -= 1000;
+			last_time++;
+		}
+	}
+
+	int diff = (u32)last_time - time;
 	u32 next_event = GetTicksPerSecond() / 1000;
 	if (frame_limiter)
 	{
@@ -201,6 +225,11 @@ static void ThrottleCallback(u64 last_time, s64 cyclesLate)
 	CoreTiming::ScheduleEvent(next_event - cyclesLate, et_Throttle, last_time + 1);
 }
 
+void DelayThrottle(u32 us)
+{
+	s_throttle_delay_us += us;
+}
+
 // split from Init to break a circular dependency between VideoInterface::Init and
 // SystemTimers::Init
 void PreInit()
@@ -252,6 +281,8 @@ void Init()
 	CoreTiming::ScheduleEvent(VideoInterface::GetTicksPerHalfLine(), et_VI);
 	CoreTiming::ScheduleEvent(0, et_DSP);
 	CoreTiming::ScheduleEvent(s_audio_dma_period, et_AudioDMA);
+	s_throttle_delay_us = 0;
+	s_throttle_stretch_us = 0;
 	CoreTiming::ScheduleEvent(0, et_Throttle, Common::Timer::GetTimeMs());
 
 	CoreTiming::ScheduleEvent(VideoInterface::GetTicksPerField(), et_PatchEngine);
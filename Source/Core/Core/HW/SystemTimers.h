@@ -46,4 +46,8 @@ void TimeBaseSet();
 u64 GetFakeTimeBase();
 // Custom RTC
 s64 GetLocalTimeRTCOffset();
+
+// Slows the frame limiter down by the given real time, spread over the next throttle events so
+// emulation briefly runs slower instead of stopping. Call from the CPU thread.
+void DelayThrottle(u32 us);
 }
@@ -61,6 +61,7 @@ enum
 	NP_MSG_SLIPPI_PAD_ACK = 0x81,
 	NP_MSG_SLIPPI_MATCH_SELECTIONS = 0x82,
 	NP_MSG_SLIPPI_CONN_SELECTED = 0x83,
+	NP_MSG_SLIPPI_PAD_DELTA = 0x84,
 
 	NP_MSG_START_GAME = 0xA0,
 	NP_MSG_CHANGE_GAME = 0xA1,
@@ -240,10 +240,14 @@ void Jit64::Init()
 	code_block.m_gpa = &js.gpa;
 	code_block.m_fpa = &js.fpa;
 	EnableOptimization();
+
+	if (!SConfig::GetInstance().bEnableDebugging && !SConfig::GetInstance().bJITNoBlockCache)
+		m_profile.Load(SConfig::GetInstance().GetGameID(), SConfig::GetInstance().GetGameRevision());
 }
 
 void Jit64::ClearCache()
 {
+	m_profile.RecordBlocks(blocks);
 	blocks.Clear();
 	trampolines.ClearCodeSpace();
 	farcode.ClearCodeSpace();
@@ -254,6 +258,9 @@ void Jit64::ClearCache()
 
 void Jit64::Shutdown()
 {
+	m_profile.RecordBlocks(blocks);
+	m_profile.Save();
+
 	FreeStack();
 	FreeCodeSpace();
 
@@ -593,7 +600,51 @@ void Jit64::Jit(u32 em_address)
 
 	int block_num = blocks.AllocateBlock(em_address);
 	JitBlock *b = blocks.GetBlock(block_num);
+	b->codeHash = JitProfile::HashCode(code_block, code_buffer);
 	blocks.FinalizeBlock(block_num, jo.enableBlocklink, DoJit(em_address, &code_buffer, b, nextPC));
+
+	PrecompileProfiledBlocks();
+}
+
+void Jit64::PrecompileProfiledBlocks()
+{
+	// A few blocks per miss, so the first misses after boot don't stall on the whole profile
+	const int BLOCKS_PER_MISS = 16;
+
+	// MMU translated code can't be read without changing the guest's TLB and page table, which
+	// must not depend on the local profile
+	if (SConfig::GetInstance().bMMU)
+		return;
+
+	JitProfile::Entry entry;
+	for (int i = 0; i < BLOCKS_PER_MISS && m_profile.NextPending(&entry); i++)
+	{
+		// Never clear the cache for a block that isn't needed yet
+		if (IsAlmostFull() || farcode.IsAlmostFull() || trampolines.IsAlmostFull() || blocks.IsFull())
+		{
+			m_profile.ClearPending();
+			return;
+		}
+
+		if (blocks.GetBlockNumberFromStartAddress(entry.address) != -1)
+			continue;
+
+		// The block isn't running yet, so reading it must leave the emulated icache as it is
+		analyzer.SetOption(PPCAnalyst::PPCAnalyzer::OPTION_PEEK_CODE);
+		u32 nextPC = analyzer.Analyze(entry.address, &code_block, &code_buffer, code_buffer.GetSize());
+		analyzer.ClearOption(PPCAnalyst::PPCAnalyzer::OPTION_PEEK_CODE);
+		if (code_block.m_memory_exception || code_block.m_num_instructions != entry.num_instructions ||
+			JitProfile::HashCode(code_block, code_buffer) != entry.code_hash)
+		{
+			m_profile.Retry(entry);
+			continue;
+		}
+
+		int block_num = blocks.AllocateBlock(entry.address);
+		JitBlock *b = blocks.GetBlock(block_num);
+		b->codeHash = entry.code_hash;
+		blocks.FinalizeBlock(block_num, jo.enableBlocklink, DoJit(entry.address, &code_buffer, b, nextPC));
+	}
 }
 
 const u8* Jit64::DoJit(u32 em_address, PPCAnalyst::CodeBuffer *code_buf, JitBlock *b, u32 nextPC)
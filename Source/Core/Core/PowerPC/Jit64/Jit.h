@@ -25,6 +25,7 @@
 #include "Core/PowerPC/Jit64/JitRegCache.h"
 #include "Core/PowerPC/JitCommon/JitBase.h"
 #include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitProfile.h"
 
 class Jit64 : public Jitx86Base
 {
@@ -44,6 +45,9 @@ private:
 	bool m_cleanup_after_stackfault;
 	u8* m_stack;
 
+	JitProfile m_profile;
+	void PrecompileProfiledBlocks();
+
 public:
 	Jit64() : code_buffer(32000) {}
 	~Jit64() {}
@@ -9,8 +9,9 @@
 // performance hit, it's not enabled by default, but it's useful for
 // locating performance issues.
 
+#include <algorithm>
 #include <cstring>
-#include <map>
+#include <unordered_set>
 #include <utility>
 
 #include "Common/CommonTypes.h"
@@ -104,6 +105,7 @@ int JitBaseBlockCache::AllocateBlock(u32 em_address)
 	JitBlock &b = blocks[num_blocks];
 	b.invalid = false;
 	b.originalAddress = em_address;
+	b.codeHash = 0;
 	b.linkData.clear();
 	num_blocks++; //commit the current block
 	return num_blocks - 1;
@@ -122,13 +124,15 @@ void JitBaseBlockCache::FinalizeBlock(int block_num, bool block_link, const u8 *
 	for (u32 block = pAddr / 32; block <= (pAddr + (b.originalSize - 1) * 4) / 32; ++block)
 		valid_block.Set(block);
 
-	block_map[std::make_pair(pAddr + 4 * b.originalSize - 1, pAddr)] = block_num;
+	u32 last_page = (pAddr + 4 * b.originalSize - 1) >> BLOCK_MAP_PAGE_SHIFT;
+	for (u32 page = pAddr >> BLOCK_MAP_PAGE_SHIFT; page <= last_page; ++page)
+		block_map[page].push_back(block_num);
 
 	if (block_link)
 	{
 		for (const auto& e : b.linkData)
 		{
-			links_to.emplace(e.exitAddress, block_num);
+			links_to[e.exitAddress].push_back(block_num);
 		}
 
 		LinkBlock(block_num);
@@ -209,38 +213,34 @@ void JitBaseBlockCache::LinkBlock(int i)
 {
 	LinkBlockExits(i);
 	JitBlock &b = blocks[i];
-	// equal_range(b) returns pair<iterator,iterator> representing the range
-	// of element with key b
-	auto ppp = links_to.equal_range(b.originalAddress);
-
-	if (ppp.first == ppp.second)
+	auto iter = links_to.find(b.originalAddress);
+	if (iter == links_to.end())
 		return;
 
-	for (auto iter = ppp.first; iter != ppp.second; ++iter)
+	for (int source : iter->second)
 	{
-		// PanicAlert("Linking block %i to block %i", iter->second, i);
-		LinkBlockExits(iter->second);
+		// PanicAlert("Linking block %i to block %i", source, i);
+		LinkBlockExits(source);
 	}
 }
 
 void JitBaseBlockCache::UnlinkBlock(int i)
 {
 	JitBlock &b = blocks[i];
-	auto ppp = links_to.equal_range(b.originalAddress);
-
-	if (ppp.first == ppp.second)
+	auto iter = links_to.find(b.originalAddress);
+	if (iter == links_to.end())
 		return;
 
-	for (auto iter = ppp.first; iter != ppp.second; ++iter)
+	for (int source : iter->second)
 	{
-		JitBlock &sourceBlock = blocks[iter->second];
+		JitBlock &sourceBlock = blocks[source];
 		for (auto& e : sourceBlock.linkData)
 		{
 			if (e.exitAddress == b.originalAddress)
 				e.linkStatus = false;
 		}
 	}
-	links_to.erase(b.originalAddress);
+	links_to.erase(iter);
 }
 
 void JitBaseBlockCache::DestroyBlock(int block_num, bool invalidate)
@@ -268,6 +268,29 @@ void JitBaseBlockCache::DestroyBlock(int block_num, bool invalidate)
 	WriteDestroyBlock(b.checkedEntry, b.originalAddress);
 }
 
+void JitBaseBlockCache::RemoveFromBlockMap(int block_num)
+{
+	const JitBlock &b = blocks[block_num];
+	u32 pAddr = b.originalAddress & 0x1FFFFFFF;
+	u32 last_page = (pAddr + 4 * b.originalSize - 1) >> BLOCK_MAP_PAGE_SHIFT;
+	for (u32 page = pAddr >> BLOCK_MAP_PAGE_SHIFT; page <= last_page; ++page)
+	{
+		auto iter = block_map.find(page);
+		if (iter == block_map.end())
+			continue;
+
+		std::vector<int> &page_blocks = iter->second;
+		auto entry = std::find(page_blocks.begin(), page_blocks.end(), block_num);
+		if (entry != page_blocks.end())
+		{
+			*entry = page_blocks.back();
+			page_blocks.pop_back();
+		}
+		if (page_blocks.empty())
+			block_map.erase(iter);
+	}
+}
+
 void JitBaseBlockCache::InvalidateICache(u32 address, const u32 length, bool forced)
 {
 	// Convert the logical address to a physical address for the block map
@@ -284,34 +307,75 @@ void JitBaseBlockCache::InvalidateICache(u32 address, const u32 length, bool for
 	}
 
 	// destroy JIT blocks
-	// !! this works correctly under assumption that any two overlapping blocks end at the same address
-	if (destroy_block)
+	if (destroy_block && length)
 	{
-		std::map<std::pair<u32, u32>, u32>::iterator it1 = block_map.lower_bound(std::make_pair(pAddr, 0)), it2 = it1;
-		while (it2 != block_map.end() && it2->first.second < pAddr + length)
-		{
-			JitBlock &b = blocks[it2->second];
-			std::memcpy(GetICachePtr(b.originalAddress), &JIT_ICACHE_INVALID_WORD, sizeof(u32));
+		u64 end = (u64)pAddr + length;
+		u32 first_page = pAddr >> BLOCK_MAP_PAGE_SHIFT;
+		u32 last_page = u32((end - 1) >> BLOCK_MAP_PAGE_SHIFT);
+
+		// A block covering several pages is found once per page, but only destroyed the first time
+		invalidated_blocks.clear();
+		auto invalidate_page = [&](const std::vector<int> &page_blocks) {
+			for (int block_num : page_blocks)
+			{
+				JitBlock &b = blocks[block_num];
+				u32 block_start = b.originalAddress & 0x1FFFFFFF;
+				u64 block_end = (u64)block_start + 4 * b.originalSize;
+				if (b.invalid || block_start >= end || block_end <= pAddr)
+					continue;
+
+				DestroyBlock(block_num, true);
+				invalidated_blocks.push_back(block_num);
+			}
+		};
 
-			DestroyBlock(it2->second, true);
-			++it2;
+		// Huge ranges (whole memory, DMA) visit the pages that have blocks instead of every page
+		if (last_page - first_page >= block_map.size())
+		{
+			for (const auto &page : block_map)
+			{
+				if (page.first >= first_page && page.first <= last_page)
+					invalidate_page(page.second);
+			}
 		}
-		if (it1 != it2)
+		else
 		{
-			block_map.erase(it1, it2);
+			for (u32 page = first_page; page <= last_page; ++page)
+			{
+				auto iter = block_map.find(page);
+				if (iter != block_map.end())
+					invalidate_page(iter->second);
+			}
 		}
 
+		for (int block_num : invalidated_blocks)
+			RemoveFromBlockMap(block_num);
+
 		// If the code was actually modified, we need to clear the relevant entries from the
 		// FIFO write address cache, so we don't end up with FIFO checks in places they shouldn't
 		// be (this can clobber flags, and thus break any optimization that relies on flags
 		// being in the right place between instructions).
 		if (!forced)
 		{
-			for (u32 i = address; i < address + length; i += 4)
-			{
-				jit->js.fifoWriteAddresses.erase(i);
-				jit->js.pairedQuantizeAddresses.erase(i);
-			}
+			auto erase_range = [&](std::unordered_set<u32> &addresses) {
+				if (length / 4 > addresses.size())
+				{
+					for (auto iter = addresses.begin(); iter != addresses.end();)
+					{
+						if (*iter >= address && *iter - address < length)
+							iter = addresses.erase(iter);
+						else
+							++iter;
+					}
+				}
+				else
+				{
+					for (u32 i = address; i < address + length; i += 4)
+						addresses.erase(i);
+				}
+			};
+			erase_range(jit->js.fifoWriteAddresses);
+			erase_range(jit->js.pairedQuantizeAddresses);
 		}
 	}
 }
@@ -8,6 +8,7 @@
 #include <bitset>
 #include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -32,6 +33,7 @@ struct JitBlock
 	u32 codeSize;
 	u32 originalSize;
 	int runCount;  // for profiling.
+	u64 codeHash;  // of the analyzed instructions, for the JIT profile
 
 	bool invalid;
 
@@ -97,13 +99,16 @@ class JitBaseBlockCache
 	enum
 	{
 		MAX_NUM_BLOCKS = 65536 * 2,
+		// Blocks are indexed by the 4KB physical pages they cover
+		BLOCK_MAP_PAGE_SHIFT = 12,
 	};
 
 	std::array<const u8*, MAX_NUM_BLOCKS> blockCodePointers;
 	std::array<JitBlock, MAX_NUM_BLOCKS> blocks;
 	int num_blocks;
-	std::multimap<u32, int> links_to;
-	std::map<std::pair<u32, u32>, u32> block_map; // (end_addr, start_addr) -> number
+	std::unordered_map<u32, std::vector<int>> links_to; // exit address -> blocks linking to it
+	std::unordered_map<u32, std::vector<int>> block_map; // physical page -> blocks on it
+	std::vector<int> invalidated_blocks;
 	ValidBlockBitSet valid_block;
 
 	bool m_initialized;
@@ -114,6 +119,7 @@ class JitBaseBlockCache
 
 	u8* GetICachePtr(u32 addr);
 	void DestroyBlock(int block_num, bool invalidate);
+	void RemoveFromBlockMap(int block_num);
 
 	// Virtual for overloaded
 	virtual void WriteLinkBlock(u8* location, const JitBlock& block) = 0;
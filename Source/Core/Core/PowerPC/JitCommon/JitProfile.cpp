@@ -0,0 +1,190 @@
+// Copyright 2008 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <xxhash.h>
+
+#include "Common/CommonPaths.h"
+#include "Common/FileUtil.h"
+#include "Common/LinearDiskCache.h"
+#include "Common/Logging/Log.h"
+#include "Common/StringUtil.h"
+#include "Core/PowerPC/JitCommon/JitCache.h"
+#include "Core/PowerPC/JitCommon/JitProfile.h"
+#include "Core/PowerPC/PPCAnalyst.h"
+
+// Blocks kept in the profile, the ones compiled in the most runs first
+static const size_t PROFILE_MAX_ENTRIES = 16384;
+// Score a block gets for every run that compiled it. Old scores are halved on every save
+// so blocks the game stopped running age out
+static const u32 PROFILE_RUN_SCORE = 16;
+// Blocks whose code didn't match are tried again a few times, spread over this many block
+// misses, as the game may load it later
+static const u32 RETRY_INTERVAL = 4096;
+static const u32 MAX_RETRY_ROUNDS = 8;
+
+namespace
+{
+class JitProfileReader : public LinearDiskCacheReader<JitProfile::Entry, u32>
+{
+public:
+	JitProfileReader(std::map<u32, std::pair<JitProfile::Entry, u32>>* profile) : m_profile(profile)
+	{
+	}
+
+	void Read(const JitProfile::Entry& key, const u32* value, u32 value_size) override
+	{
+		if (value_size != 1 || key.num_instructions == 0)
+			return;
+		(*m_profile)[key.address] = std::make_pair(key, *value);
+	}
+
+private:
+	std::map<u32, std::pair<JitProfile::Entry, u32>>* m_profile;
+};
+}
+
+u64 JitProfile::HashCode(const PPCAnalyst::CodeBlock& code_block, const PPCAnalyst::CodeBuffer& code_buffer)
+{
+	// Addresses are part of the hash, with branch following the instructions of a block
+	// don't have to be contiguous
+	XXH64_state_t state;
+	XXH64_reset(&state, 0);
+	for (u32 i = 0; i < code_block.m_num_instructions; i++)
+	{
+		const PPCAnalyst::CodeOp& op = code_buffer.codebuffer[i];
+		u32 words[2] = { op.address, op.inst.hex };
+		XXH64_update(&state, words, sizeof(words));
+	}
+	return XXH64_digest(&state);
+}
+
+void JitProfile::Load(const std::string& game_id, u16 revision)
+{
+	m_filename.clear();
+	m_profile.clear();
+	m_session.clear();
+	ClearPending();
+
+	if (game_id.empty() || game_id == "00000000")
+		return;
+	m_filename = StringFromFormat("%sJIT-%s-%u.cache", File::GetUserPath(D_CACHE_IDX).c_str(), game_id.c_str(), revision);
+
+	LinearDiskCache<Entry, u32> cache;
+	JitProfileReader reader(&m_profile);
+	cache.OpenAndRead(m_filename, reader);
+	cache.Close();
+
+	std::vector<std::pair<Entry, u32>> entries;
+	for (const auto& entry : m_profile)
+		entries.push_back(entry.second);
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const std::pair<Entry, u32>& a, const std::pair<Entry, u32>& b) { return a.second > b.second; });
+	for (const auto& entry : entries)
+		m_pending.push_back(entry.first);
+
+	INFO_LOG(DYNA_REC, "Loaded %zu profiled JIT blocks for %s", m_pending.size(), game_id.c_str());
+}
+
+void JitProfile::Save()
+{
+	if (m_filename.empty() || m_session.empty())
+		return;
+
+	std::map<u32, std::pair<Entry, u32>> scores;
+	for (const auto& entry : m_profile)
+		scores[entry.first] = std::make_pair(entry.second.first, entry.second.second / 2);
+
+	for (const auto& entry : m_session)
+	{
+		auto& score = scores[entry.first];
+		if (score.second && score.first.code_hash == entry.second.code_hash)
+		{
+			score.second += PROFILE_RUN_SCORE;
+		}
+		else
+		{
+			// New block, or different code at the same address
+			score = std::make_pair(entry.second, PROFILE_RUN_SCORE);
+		}
+	}
+
+	std::vector<std::pair<Entry, u32>> entries;
+	for (const auto& entry : scores)
+	{
+		if (entry.second.second > 0)
+			entries.push_back(entry.second);
+	}
+	std::stable_sort(entries.begin(), entries.end(),
+		[](const std::pair<Entry, u32>& a, const std::pair<Entry, u32>& b) { return a.second > b.second; });
+	if (entries.size() > PROFILE_MAX_ENTRIES)
+		entries.erase(entries.begin() + PROFILE_MAX_ENTRIES, entries.end());
+
+	// Rewritten as a whole, the file would otherwise grow with every run
+	File::Delete(m_filename);
+
+	LinearDiskCache<Entry, u32> cache;
+	std::map<u32, std::pair<Entry, u32>> unused;
+	JitProfileReader reader(&unused);
+	cache.OpenAndRead(m_filename, reader);
+	for (const auto& entry : entries)
+		cache.Append(entry.first, &entry.second, 1);
+	cache.Close();
+
+	m_session.clear();
+}
+
+void JitProfile::RecordBlocks(JitBaseBlockCache& blocks)
+{
+	if (m_filename.empty())
+		return;
+
+	for (int i = 0; i < blocks.GetNumBlocks(); i++)
+	{
+		const JitBlock* b = blocks.GetBlock(i);
+		if (b->invalid || !b->codeHash)
+			continue;
+
+		Entry entry;
+		entry.address = b->originalAddress;
+		entry.num_instructions = b->originalSize;
+		entry.code_hash = b->codeHash;
+		m_session[entry.address] = entry;
+	}
+}
+
+bool JitProfile::NextPending(Entry* entry)
+{
+	if (m_next_pending >= m_pending.size())
+	{
+		if (m_retry.empty() || m_retry_rounds >= MAX_RETRY_ROUNDS)
+			return false;
+
+		// Start another round once enough misses went by without anything to compile
+		if (++m_next_pending - m_pending.size() < RETRY_INTERVAL)
+			return false;
+
+		m_pending.swap(m_retry);
+		m_retry.clear();
+		m_next_pending = 0;
+		m_retry_rounds++;
+	}
+
+	*entry = m_pending[m_next_pending++];
+	return true;
+}
+
+void JitProfile::Retry(const Entry& entry)
+{
+	m_retry.push_back(entry);
+}
+
+void JitProfile::ClearPending()
+{
+	m_pending.clear();
+	m_pending.shrink_to_fit();
+	m_retry.clear();
+	m_next_pending = 0;
+	m_retry_rounds = 0;
+}
@@ -0,0 +1,58 @@
+// Copyright 2008 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+class JitBaseBlockCache;
+
+namespace PPCAnalyst
+{
+class CodeBuffer;
+struct CodeBlock;
+}
+
+// Blocks the JIT compiled in earlier runs of the same game. The next boot compiles them ahead
+// of time, as soon as their code is in memory, so the first frames don't wait on the JIT.
+// Entries carry a hash of the analyzed instructions and are only compiled when it still matches.
+class JitProfile
+{
+public:
+	struct Entry
+	{
+		u32 address;
+		u32 num_instructions;
+		u64 code_hash;
+	};
+
+	static u64 HashCode(const PPCAnalyst::CodeBlock& code_block, const PPCAnalyst::CodeBuffer& code_buffer);
+
+	void Load(const std::string& game_id, u16 revision);
+	void Save();
+
+	// Adds the valid blocks of the cache to this run's profile, call before clearing it
+	void RecordBlocks(JitBaseBlockCache& blocks);
+
+	// Next profiled block to compile ahead of time
+	bool NextPending(Entry* entry);
+	// The code of the block doesn't match yet, it may not be loaded. Tried again later
+	void Retry(const Entry& entry);
+	void ClearPending();
+
+private:
+	std::string m_filename;
+	// Scores of the loaded profile, and of the blocks this run compiled
+	std::map<u32, std::pair<Entry, u32>> m_profile;
+	std::map<u32, Entry> m_session;
+
+	std::vector<Entry> m_pending;
+	size_t m_next_pending = 0;
+	std::vector<Entry> m_retry;
+	u32 m_retry_rounds = 0;
+};
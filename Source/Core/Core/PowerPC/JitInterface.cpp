@@ -14,6 +14,7 @@
 
 #include "Core/ConfigManager.h"
 #include "Core/Core.h"
+#include "Core/HW/Memmap.h"
 #include "Core/PowerPC/CachedInterpreter.h"
 #include "Core/PowerPC/JitInterface.h"
 #include "Core/PowerPC/PowerPC.h"
@@ -209,6 +210,12 @@ int GetHostCode(u32* address, const u8** code, u32* code_size)
 
 bool HandleFault(uintptr_t access_address, SContext* ctx)
 {
+	// Writes to write-tracked RAM pages are expected and not the JIT's business
+	if (Memory::HandleWriteTrackingFault(access_address))
+	{
+		return true;
+	}
+
 	// Prevent nullptr dereference on a crash with no JIT present
 	if (!jit)
 	{
@@ -653,7 +653,7 @@ u32 PPCAnalyzer::Analyze(u32 address, CodeBlock *block, CodeBuffer *buffer, u32
 
 	for (u32 i = 0; i < blockSize; ++i)
 	{
-		auto result = PowerPC::TryReadInstruction(address);
+		auto result = HasOption(OPTION_PEEK_CODE) ? PowerPC::TryPeekInstruction(address) : PowerPC::TryReadInstruction(address);
 		if (!result.valid)
 		{
 			if (i == 0)
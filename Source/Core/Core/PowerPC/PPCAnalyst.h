@@ -221,6 +221,10 @@ public:
 
 		// Reorder cror instructions next to their associated fcmp.
 		OPTION_CROR_MERGE = (1 << 6),
+
+		// Read the code without side effects on the emulated instruction cache and TLB.
+		// Used for code the game hasn't run yet.
+		OPTION_PEEK_CODE = (1 << 7),
 	};
 
 
@@ -33,6 +33,7 @@ struct InstructionCache
 
 	InstructionCache();
 	u32 ReadInstruction(u32 addr);
+	u32 PeekInstruction(u32 addr) const;
 	void Invalidate(u32 addr);
 	void Init();
 	void Reset();
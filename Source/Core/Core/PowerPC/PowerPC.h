@@ -230,6 +230,9 @@ struct TryReadInstResult
 	u32 hex;
 };
 TryReadInstResult TryReadInstruction(const u32 address);
+// Same as TryReadInstruction, but leaves the instruction cache and TLB alone. Fails for code
+// that needs MMU translation.
+TryReadInstResult TryPeekInstruction(const u32 address);
 
 u8  Read_U8(const u32 address);
 u16 Read_U16(const u32 address);
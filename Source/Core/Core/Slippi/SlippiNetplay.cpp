@@ -20,6 +20,7 @@
 #include "Core/HW/WiimoteReal/WiimoteReal.h"
 #include "Core/IPC_HLE/WII_IPC_HLE_Device_usb_bt_emu.h"
 #include "Core/Movie.h"
+#include "Core/Slippi/SlippiTelemetry.h"
 #include "InputCommon/GCAdapter.h"
 #include "VideoCommon/OnScreenDisplay.h"
 #include "VideoCommon/VideoConfig.h"
@@ -30,7 +31,6 @@
 #include <memory>
 #include <thread>
 
-static std::mutex pad_mutex;
 static std::mutex ack_mutex;
 
 // called from ---GUI--- thread
@@ -132,6 +132,7 @@ unsigned int SlippiNetplayClient::OnData(sf::Packet &packet)
 	switch (mid)
 	{
 	case NP_MSG_SLIPPI_PAD:
+	case NP_MSG_SLIPPI_PAD_DELTA:
 	{
 		int32_t frame;
 		if(!(packet >> frame))
@@ -156,47 +157,61 @@ unsigned int SlippiNetplayClient::OnData(sf::Packet &packet)
 			timing.timeUs = curTime;
 		}
 
-		s64 opponentSendTimeUs = curTime - (pingUs / 2);
-		s64 frameDiffOffsetUs = 16683 * (timing.frame - frame);
-		s64 timeOffsetUs = opponentSendTimeUs - timing.timeUs + frameDiffOffsetUs;
+		timeSync.AddRemoteFrame(frame, timing.frame, timing.timeUs, curTime);
 
-		INFO_LOG(SLIPPI_ONLINE, "[Offset] Opp Frame: %d, My Frame: %d. Time offset: %lld", frame, timing.frame,
-		         timeOffsetUs);
-
-		// Add this offset to circular buffer for use later
-		if (frameOffsetData.buf.size() < SLIPPI_ONLINE_LOCKSTEP_INTERVAL)
-			frameOffsetData.buf.push_back((s32)timeOffsetUs);
-		else
-			frameOffsetData.buf[frameOffsetData.idx] = (s32)timeOffsetUs;
-
-		frameOffsetData.idx = (frameOffsetData.idx + 1) % SLIPPI_ONLINE_LOCKSTEP_INTERVAL;
+		INFO_LOG(SLIPPI_ONLINE, "[Offset] Opp Frame: %d, My Frame: %d. Time offset: %d", frame, timing.frame,
+		         timeSync.GetOffsetUs());
 
 		{
-			std::lock_guard<std::mutex> lk(pad_mutex); // TODO: Is this the correct lock?
-
 			auto packetData = (u8 *)packet.getData();
 
 			INFO_LOG(SLIPPI_ONLINE, "Receiving a packet of inputs [%d]...", frame);
 
-			int32_t headFrame = remotePadQueue.empty() ? 0 : remotePadQueue.front()->frame;
+			std::lock_guard<std::mutex> lk(remotePadsMutex);
+			int32_t headFrame = remotePads.LatestFrame();
 			int inputsToCopy = frame - headFrame;
 
-			// Check that the packet actually contains the data it claims to
-			if((5 + inputsToCopy * SLIPPI_PAD_DATA_SIZE) > (int)packet.getDataSize())
+			u8 *pads = &packetData[5];
+			u8 decodedPads[SLIPPI_PAD_RING_SIZE * SLIPPI_PAD_DATA_SIZE];
+			if (mid == NP_MSG_SLIPPI_PAD_DELTA)
 			{
+				// Encoding version and number of pads, followed by the delta encoded pads
+				size_t dataSize = packet.getDataSize();
+				if (dataSize < 7 || packetData[5] != SLIPPI_PAD_ENCODING_DELTA)
+				{
+					ERROR_LOG(SLIPPI_ONLINE, "Unsupported pad encoding");
+					break;
+				}
+
+				int padCount = packetData[6];
+				if (inputsToCopy > padCount || inputsToCopy > SLIPPI_PAD_RING_SIZE ||
+				    (inputsToCopy > 0 && !SlippiPadDeltaDecode(&packetData[7], dataSize - 7, inputsToCopy, decodedPads)))
+				{
+					ERROR_LOG(SLIPPI_ONLINE, "Netplay packet too small to read pad buffer");
+					break;
+				}
+
+				pads = decodedPads;
+			}
+			else if ((5 + inputsToCopy * SLIPPI_PAD_DATA_SIZE) > (int)packet.getDataSize())
+			{
+				// Check that the packet actually contains the data it claims to
 				ERROR_LOG(SLIPPI_ONLINE, "Netplay packet too small to read pad buffer");
 				break;
 			}
 
 			for (int i = inputsToCopy - 1; i >= 0; i--)
 			{
-				auto pad = std::make_unique<SlippiPad>(frame - i, &packetData[5 + i * SLIPPI_PAD_DATA_SIZE]);
-
-				INFO_LOG(SLIPPI_ONLINE, "Rcv [%d] -> %02X %02X %02X %02X %02X %02X %02X %02X", pad->frame,
-				         pad->padBuf[0], pad->padBuf[1], pad->padBuf[2], pad->padBuf[3], pad->padBuf[4], pad->padBuf[5],
-				         pad->padBuf[6], pad->padBuf[7]);
+				u8 *padBuf = &pads[i * SLIPPI_PAD_DATA_SIZE];
+				INFO_LOG(SLIPPI_ONLINE, "Rcv [%d] -> %02X %02X %02X %02X %02X %02X %02X %02X", frame - i, padBuf[0],
+				         padBuf[1], padBuf[2], padBuf[3], padBuf[4], padBuf[5], padBuf[6], padBuf[7]);
+			}
 
-				remotePadQueue.push_front(std::move(pad));
+			// Without an ack the opponent will send these inputs again
+			if (!remotePads.Push(frame, pads, inputsToCopy))
+			{
+				ERROR_LOG(SLIPPI_ONLINE, "Remote pad ring full, dropping inputs up to frame %d", frame);
+				break;
 			}
 		}
 
@@ -220,7 +235,8 @@ unsigned int SlippiNetplayClient::OnData(sf::Packet &packet)
 			break;
 		}
 
-		lastFrameAcked = frame > lastFrameAcked ? frame : lastFrameAcked;
+		if (frame > lastFrameAcked)
+			lastFrameAcked = frame;
 
 		// Remove old timings
 		while (!ackTimers.Empty() && ackTimers.Front().frame < frame)
@@ -238,6 +254,8 @@ unsigned int SlippiNetplayClient::OnData(sf::Packet &packet)
 		ackTimers.Pop();
 
 		pingUs = Common::Timer::GetTimeUs() - sendTime;
+		timeSync.AddRttSample(pingUs);
+		SlippiTelemetry::Record(SlippiTelemetry::Metric::PingUs, pingUs);
 		if (g_ActiveConfig.bShowNetPlayPing && frame % SLIPPI_PING_DISPLAY_INTERVAL == 0)
 		{
 			OSD::AddTypedMessage(OSD::MessageType::NetPlayPing, StringFromFormat("Ping: %u", pingUs / 1000),
@@ -252,6 +270,11 @@ unsigned int SlippiNetplayClient::OnData(sf::Packet &packet)
 		INFO_LOG(SLIPPI_ONLINE, "[Netplay] Received selections from opponent");
 		matchInfo.remotePlayerSelections.Merge(*s);
 
+		// Older clients end the message here and only read raw pads
+		u8 padEncoding = SLIPPI_PAD_ENCODING_RAW;
+		packet >> padEncoding;
+		remotePadEncoding = padEncoding;
+
 		// This might be a good place to reset some logic? Game can't start until we receive this msg
 		// so this should ensure that everything is initialized before the game starts
 		// TODO: This could cause issues in the case of a desync? If this is ever received mid-game, bad things
@@ -281,6 +304,7 @@ void SlippiNetplayClient::writeToPacket(sf::Packet &packet, SlippiPlayerSelectio
 	packet << s.characterId << s.characterColor << s.isCharacterSelected;
 	packet << s.stageId << s.isStageSelected;
 	packet << s.rngOffset;
+	packet << static_cast<u8>(SLIPPI_PAD_ENCODING_LATEST);
 }
 
 std::unique_ptr<SlippiPlayerSelections> SlippiNetplayClient::readSelectionsFromPacket(sf::Packet &packet)
@@ -305,7 +329,7 @@ void SlippiNetplayClient::Send(sf::Packet &packet)
 	u8 channelId = 0;
 
 	MessageId mid = ((u8 *)packet.getData())[0];
-	if (mid == NP_MSG_SLIPPI_PAD || mid == NP_MSG_SLIPPI_PAD_ACK)
+	if (mid == NP_MSG_SLIPPI_PAD || mid == NP_MSG_SLIPPI_PAD_DELTA || mid == NP_MSG_SLIPPI_PAD_ACK)
 	{
 		// Slippi communications do not need reliable connection and do not need to
 		// be received in order. Channel is changed so that other reliable communications
@@ -513,14 +537,12 @@ void SlippiNetplayClient::StartSlippiGame()
 	lastFrameTiming = timing;
 	hasGameStarted = false;
 
-	localPadQueue.clear();
-
-	remotePadQueue.clear();
-	for (s32 i = 1; i <= 2; i++)
+	localPads.Reset(0, 0);
 	{
-		std::unique_ptr<SlippiPad> pad = std::make_unique<SlippiPad>(i);
-		remotePadQueue.push_front(std::move(pad));
+		std::lock_guard<std::mutex> lk(remotePadsMutex);
+		remotePads.Reset(1, 2);
 	}
+	timeSync.Reset();
 
 	// Reset match info for next game
 	matchInfo.Reset();
@@ -538,7 +560,7 @@ void SlippiNetplayClient::SendConnectionSelected()
 	SendAsync(std::move(spac));
 }
 
-void SlippiNetplayClient::SendSlippiPad(std::unique_ptr<SlippiPad> pad)
+void SlippiNetplayClient::SendSlippiPad(const SlippiPad *pad)
 {
 	auto status = slippiConnectStatus;
 	bool connectionFailed = status == SlippiNetplayClient::SlippiConnectStatus::NET_CONNECT_STATUS_FAILED;
@@ -554,37 +576,52 @@ void SlippiNetplayClient::SendSlippiPad(std::unique_ptr<SlippiPad> pad)
 	//  pad->padBuf[2], pad->padBuf[3], pad->padBuf[4], pad->padBuf[5], pad->padBuf[6], pad->padBuf[7]);
 	//}
 
-	if (pad)
+	if (pad && !localPads.Push(pad->frame, pad->padBuf, 1))
 	{
-		// Add latest local pad report to queue
-		localPadQueue.push_front(std::move(pad));
+		// Only possible if nothing has been acked for longer than the ring holds
+		ERROR_LOG(SLIPPI_ONLINE, "Local pad ring full, dropping input for frame %d", pad->frame);
 	}
 
 	// Remove pad reports that have been received and acked
-	while (!localPadQueue.empty() && localPadQueue.back()->frame < lastFrameAcked)
-	{
-		localPadQueue.pop_back();
-	}
+	localPads.Trim(lastFrameAcked);
 
-	if (localPadQueue.empty())
+	auto frame = localPads.LatestFrame();
+	if (frame < lastFrameAcked || frame <= 0)
 	{
-		// If pad queue is empty now, there's no reason to send anything
+		// If every pad has been acked, there's no reason to send anything
 		return;
 	}
 
-	auto frame = localPadQueue.front()->frame;
+	// Unacked pads, newest first
+	u8 pads[SLIPPI_PAD_RING_SIZE * SLIPPI_PAD_DATA_SIZE];
+	int padCount = 0;
+	for (int32_t f = frame; f >= localPads.OldestFrame(); f--, padCount++)
+		memcpy(&pads[padCount * SLIPPI_PAD_DATA_SIZE], localPads.Get(f), SLIPPI_PAD_DATA_SIZE);
+
+	INFO_LOG(SLIPPI_ONLINE, "Sending a packet of inputs [%d]...", frame);
+	for (int i = 0; i < padCount; i++)
+	{
+		const u8 *padBuf = &pads[i * SLIPPI_PAD_DATA_SIZE];
+		INFO_LOG(SLIPPI_ONLINE, "Send [%d] -> %02X %02X %02X %02X %02X %02X %02X %02X", frame - i, padBuf[0],
+		         padBuf[1], padBuf[2], padBuf[3], padBuf[4], padBuf[5], padBuf[6], padBuf[7]);
+	}
 
 	auto spac = std::make_unique<sf::Packet>();
-	*spac << static_cast<MessageId>(NP_MSG_SLIPPI_PAD);
-	*spac << frame;
+	if (remotePadEncoding >= SLIPPI_PAD_ENCODING_DELTA)
+	{
+		u8 encodedPads[SLIPPI_PAD_DELTA_MAX_SIZE(SLIPPI_PAD_RING_SIZE)];
+		size_t encodedSize = SlippiPadDeltaEncode(pads, padCount, encodedPads);
 
-	INFO_LOG(SLIPPI_ONLINE, "Sending a packet of inputs [%d]...", frame);
-	for (auto it = localPadQueue.begin(); it != localPadQueue.end(); ++it)
+		*spac << static_cast<MessageId>(NP_MSG_SLIPPI_PAD_DELTA);
+		*spac << frame;
+		*spac << static_cast<u8>(SLIPPI_PAD_ENCODING_DELTA) << static_cast<u8>(padCount);
+		spac->append(encodedPads, encodedSize);
+	}
+	else
 	{
-		INFO_LOG(SLIPPI_ONLINE, "Send [%d] -> %02X %02X %02X %02X %02X %02X %02X %02X", (*it)->frame, (*it)->padBuf[0],
-		         (*it)->padBuf[1], (*it)->padBuf[2], (*it)->padBuf[3], (*it)->padBuf[4], (*it)->padBuf[5],
-		         (*it)->padBuf[6], (*it)->padBuf[7]);
-		spac->append((*it)->padBuf, SLIPPI_PAD_DATA_SIZE); // only transfer 8 bytes per pad
+		*spac << static_cast<MessageId>(NP_MSG_SLIPPI_PAD);
+		*spac << frame;
+		spac->append(pads, padCount * SLIPPI_PAD_DATA_SIZE); // only transfer 8 bytes per pad
 	}
 
 	SendAsync(std::move(spac));
@@ -615,40 +652,23 @@ void SlippiNetplayClient::SetMatchSelections(SlippiPlayerSelections &s)
 	SendAsync(std::move(spac));
 }
 
-std::unique_ptr<SlippiRemotePadOutput> SlippiNetplayClient::GetSlippiRemotePad(int32_t curFrame)
+// Fills padBuf with up to maxFrames remote pads of SLIPPI_PAD_FULL_SIZE, starting at curFrame or the
+// latest frame received if that is older, and going back in time. Returns the frame of the first pad
+int32_t SlippiNetplayClient::GetSlippiRemotePad(int32_t curFrame, u8 *padBuf, int maxFrames)
 {
-	std::lock_guard<std::mutex> lk(pad_mutex); // TODO: Is this the correct lock?
-
-	std::unique_ptr<SlippiRemotePadOutput> padOutput = std::make_unique<SlippiRemotePadOutput>();
+	memset(padBuf, 0, SLIPPI_PAD_FULL_SIZE * maxFrames);
 
-	if (remotePadQueue.empty())
-	{
-		auto emptyPad = std::make_unique<SlippiPad>(0);
+	int32_t latestFrame = remotePads.LatestFrame();
+	int32_t oldestFrame = remotePads.OldestFrame();
+	int32_t startFrame = curFrame < latestFrame ? curFrame : latestFrame;
 
-		padOutput->latestFrame = emptyPad->frame;
-
-		auto emptyIt = std::begin(emptyPad->padBuf);
-		padOutput->data.insert(padOutput->data.end(), emptyIt, emptyIt + SLIPPI_PAD_FULL_SIZE);
-
-		return std::move(padOutput);
-	}
-
-	padOutput->latestFrame = remotePadQueue.front()->frame;
-
-	// Copy the entire remaining remote buffer
-	for (auto it = remotePadQueue.begin(); it != remotePadQueue.end(); ++it)
-	{
-		auto padIt = std::begin((*it)->padBuf);
-		padOutput->data.insert(padOutput->data.end(), padIt, padIt + SLIPPI_PAD_FULL_SIZE);
-	}
+	for (int i = 0; i < maxFrames && startFrame - i >= oldestFrame; i++)
+		memcpy(&padBuf[i * SLIPPI_PAD_FULL_SIZE], remotePads.Get(startFrame - i), SLIPPI_PAD_DATA_SIZE);
 
 	// Remove pad reports that should no longer be needed
-	while (remotePadQueue.size() > 1 && remotePadQueue.back()->frame < curFrame)
-	{
-		remotePadQueue.pop_back();
-	}
+	remotePads.Trim(curFrame);
 
-	return std::move(padOutput);
+	return startFrame;
 }
 
 SlippiMatchInfo *SlippiNetplayClient::GetMatchInfo()
@@ -663,44 +683,15 @@ u64 SlippiNetplayClient::GetSlippiPing()
 
 int32_t SlippiNetplayClient::GetSlippiLatestRemoteFrame()
 {
-	std::lock_guard<std::mutex> lk(pad_mutex); // TODO: Is this the correct lock?
-
-	if (remotePadQueue.empty())
-	{
-		return 0;
-	}
-
-	return remotePadQueue.front()->frame;
+	return remotePads.LatestFrame();
 }
 
-s32 SlippiNetplayClient::CalcTimeOffsetUs()
+s32 SlippiNetplayClient::GetSlippiTimeOffsetUs()
 {
-	if (frameOffsetData.buf.empty())
-	{
-		return 0;
-	}
-
-	std::vector<s32> buf;
-	std::copy(frameOffsetData.buf.begin(), frameOffsetData.buf.end(), std::back_inserter(buf));
-
-	// TODO: Does this work?
-	std::sort(buf.begin(), buf.end());
-
-	int bufSize = (int)buf.size();
-	int offset = (int)((1.0f / 3.0f) * bufSize);
-	int end = bufSize - offset;
-
-	int sum = 0;
-	for (int i = offset; i < end; i++)
-	{
-		sum += buf[i];
-	}
-
-	int count = end - offset;
-	if (count <= 0)
-	{
-		return 0; // What do I return here?
-	}
+	return timeSync.GetOffsetUs();
+}
 
-	return sum / count;
+SlippiTimeSync::ssCorrection SlippiNetplayClient::UpdateTimeSync(int32_t frame)
+{
+	return timeSync.Update(frame);
 }
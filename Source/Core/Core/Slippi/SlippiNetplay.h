@@ -11,10 +11,11 @@
 #include "Common/TraversalClient.h"
 #include "Core/NetPlayProto.h"
 #include "Core/Slippi/SlippiPad.h"
+#include "Core/Slippi/SlippiTimeSync.h"
 #include "InputCommon/GCPadStatus.h"
 #include <SFML/Network/Packet.hpp>
 #include <array>
-#include <deque>
+#include <atomic>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -29,12 +30,6 @@
 #define SLIPPI_ONLINE_LOCKSTEP_INTERVAL 30 // Number of frames to wait before attempting to time-sync
 #define SLIPPI_PING_DISPLAY_INTERVAL 60
 
-struct SlippiRemotePadOutput
-{
-	int32_t latestFrame;
-	std::vector<u8> data;
-};
-
 class SlippiPlayerSelections
 {
   public:
@@ -116,13 +111,14 @@ class SlippiNetplayClient
 	SlippiConnectStatus GetSlippiConnectStatus();
 	void StartSlippiGame();
 	void SendConnectionSelected();
-	void SendSlippiPad(std::unique_ptr<SlippiPad> pad);
+	void SendSlippiPad(const SlippiPad *pad);
 	void SetMatchSelections(SlippiPlayerSelections &s);
-	std::unique_ptr<SlippiRemotePadOutput> GetSlippiRemotePad(int32_t curFrame);
+	int32_t GetSlippiRemotePad(int32_t curFrame, u8 *padBuf, int maxFrames);
 	SlippiMatchInfo *GetMatchInfo();
 	u64 GetSlippiPing();
 	int32_t GetSlippiLatestRemoteFrame();
-	s32 CalcTimeOffsetUs();
+	s32 GetSlippiTimeOffsetUs();
+	SlippiTimeSync::ssCorrection UpdateTimeSync(int32_t frame);
 
   protected:
 	struct
@@ -154,21 +150,18 @@ class SlippiNetplayClient
 		u64 timeUs;
 	};
 
-	struct
-	{
-		// TODO: Should the buffer size be dynamic based on time sync interval or not?
-		int idx;
-		std::vector<s32> buf;
-	} frameOffsetData;
+	SlippiTimeSync timeSync;
 
 	bool isConnectionSelected = false;
 	bool isDecider = false;
-	int32_t lastFrameAcked;
+	std::atomic<int32_t> lastFrameAcked;
 	bool hasGameStarted = false;
 	FrameTiming lastFrameTiming;
 	u64 pingUs;
-	std::deque<std::unique_ptr<SlippiPad>> localPadQueue;  // most recent inputs at start of deque
-	std::deque<std::unique_ptr<SlippiPad>> remotePadQueue; // most recent inputs at start of deque
+	SlippiPadRing localPads;  // inputs not yet acked, only used by the CPU thread
+	SlippiPadRing remotePads; // written by the netplay thread, read by the CPU thread
+	std::mutex remotePadsMutex; // keeps a new game's reset from racing with a push
+	std::atomic<u8> remotePadEncoding{SLIPPI_PAD_ENCODING_RAW}; // newest pad encoding the opponent reads
 	Common::FifoQueue<FrameTiming, false> ackTimers;
 	SlippiConnectStatus slippiConnectStatus = SlippiConnectStatus::NET_CONNECT_STATUS_UNSET;
 	SlippiMatchInfo matchInfo;
@@ -1,5 +1,7 @@
 #include "SlippiPad.h"
 
+#include <cstring>
+
 // TODO: Confirm the default and padding values are right
 static u8 emptyPad[SLIPPI_PAD_FULL_SIZE] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 
@@ -19,3 +21,157 @@ SlippiPad::~SlippiPad()
 {
   // Do nothing?
 }
+
+size_t SlippiPadDeltaEncode(const u8* pads, int count, u8* out)
+{
+  if (count <= 0)
+    return 0;
+
+  u8* start = out;
+  memcpy(out, pads, SLIPPI_PAD_DATA_SIZE);
+  out += SLIPPI_PAD_DATA_SIZE;
+
+  for (int i = 1; i < count;)
+  {
+    const u8* prev = &pads[(i - 1) * SLIPPI_PAD_DATA_SIZE];
+    const u8* cur = &pads[i * SLIPPI_PAD_DATA_SIZE];
+
+    u8 mask = 0;
+    for (int b = 0; b < SLIPPI_PAD_DATA_SIZE; b++)
+    {
+      if (cur[b] != prev[b])
+        mask |= 1 << b;
+    }
+
+    *out++ = mask;
+    if (mask)
+    {
+      for (int b = 0; b < SLIPPI_PAD_DATA_SIZE; b++)
+      {
+        if (mask & (1 << b))
+          *out++ = cur[b] ^ prev[b];
+      }
+      i++;
+      continue;
+    }
+
+    // Held inputs repeat the same report, store them as a run
+    int run = 1;
+    while (i + run < count && run < 256 &&
+           memcmp(&pads[(i + run) * SLIPPI_PAD_DATA_SIZE], cur, SLIPPI_PAD_DATA_SIZE) == 0)
+      run++;
+
+    *out++ = (u8)(run - 1);
+    i += run;
+  }
+
+  return out - start;
+}
+
+size_t SlippiPadDeltaDecode(const u8* data, size_t size, int count, u8* pads)
+{
+  if (count <= 0 || size < SLIPPI_PAD_DATA_SIZE)
+    return 0;
+
+  memcpy(pads, data, SLIPPI_PAD_DATA_SIZE);
+  size_t pos = SLIPPI_PAD_DATA_SIZE;
+
+  for (int i = 1; i < count;)
+  {
+    if (pos >= size)
+      return 0;
+
+    u8* cur = &pads[i * SLIPPI_PAD_DATA_SIZE];
+    const u8* prev = cur - SLIPPI_PAD_DATA_SIZE;
+    memcpy(cur, prev, SLIPPI_PAD_DATA_SIZE);
+
+    u8 mask = data[pos++];
+    if (mask)
+    {
+      for (int b = 0; b < SLIPPI_PAD_DATA_SIZE; b++)
+      {
+        if (!(mask & (1 << b)))
+          continue;
+        if (pos >= size)
+          return 0;
+        cur[b] ^= data[pos++];
+      }
+      i++;
+      continue;
+    }
+
+    if (pos >= size)
+      return 0;
+
+    int run = data[pos++] + 1;
+    for (; run > 0 && i < count; run--, i++)
+      memcpy(&pads[i * SLIPPI_PAD_DATA_SIZE], prev, SLIPPI_PAD_DATA_SIZE);
+  }
+
+  return pos;
+}
+
+SlippiPadRing::SlippiPadRing()
+{
+  Reset(0, 0);
+}
+
+u8* SlippiPadRing::slot(int32_t frame)
+{
+  return pads[frame & (SLIPPI_PAD_RING_SIZE - 1)].data();
+}
+
+void SlippiPadRing::Reset(int32_t oldest, int32_t latest)
+{
+  for (int32_t frame = oldest; frame <= latest; frame++)
+    memcpy(slot(frame), emptyPad, SLIPPI_PAD_DATA_SIZE);
+
+  oldestFrame.store(oldest, std::memory_order_release);
+  latestFrame.store(latest, std::memory_order_release);
+}
+
+int32_t SlippiPadRing::LatestFrame() const
+{
+  return latestFrame.load(std::memory_order_acquire);
+}
+
+int32_t SlippiPadRing::OldestFrame() const
+{
+  return oldestFrame.load(std::memory_order_acquire);
+}
+
+bool SlippiPadRing::Push(int32_t frame, const u8* padData, int count)
+{
+  int32_t latest = latestFrame.load(std::memory_order_relaxed);
+  if (frame <= latest || count <= 0)
+    return true;
+
+  // The slots of the new frames must no longer be in use by the reader
+  if (frame - oldestFrame.load(std::memory_order_acquire) >= SLIPPI_PAD_RING_SIZE)
+    return false;
+
+  for (int32_t f = latest + 1; f <= frame; f++)
+  {
+    int i = frame - f;
+    i = i < count ? i : count - 1;
+    memcpy(slot(f), &padData[i * SLIPPI_PAD_DATA_SIZE], SLIPPI_PAD_DATA_SIZE);
+  }
+
+  latestFrame.store(frame, std::memory_order_release);
+  return true;
+}
+
+const u8* SlippiPadRing::Get(int32_t frame) const
+{
+  return pads[frame & (SLIPPI_PAD_RING_SIZE - 1)].data();
+}
+
+void SlippiPadRing::Trim(int32_t frame)
+{
+  int32_t latest = latestFrame.load(std::memory_order_acquire);
+  int32_t oldest = oldestFrame.load(std::memory_order_relaxed);
+
+  frame = frame < latest ? frame : latest;
+  if (frame > oldest)
+    oldestFrame.store(frame, std::memory_order_release);
+}
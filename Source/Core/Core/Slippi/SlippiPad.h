@@ -1,9 +1,22 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+
 #include "Common/CommonTypes.h"
 
 #define SLIPPI_PAD_FULL_SIZE 0xC
 #define SLIPPI_PAD_DATA_SIZE 0x8
+#define SLIPPI_PAD_RING_SIZE 128 // Must be a power of two
+
+// Pad message encodings. Each client sends the newest one it reads along with its match
+// selections, and peers that don't send one only get the raw NP_MSG_SLIPPI_PAD
+#define SLIPPI_PAD_ENCODING_RAW 0
+#define SLIPPI_PAD_ENCODING_DELTA 1
+#define SLIPPI_PAD_ENCODING_LATEST SLIPPI_PAD_ENCODING_DELTA
+
+#define SLIPPI_PAD_DELTA_MAX_SIZE(count) ((count) * (SLIPPI_PAD_DATA_SIZE + 1))
 
 class SlippiPad
 {
@@ -16,3 +29,46 @@ public:
   u8 padBuf[SLIPPI_PAD_FULL_SIZE];
 };
 
+
+// Delta encoding of count reports ordered newest first. The first report is stored as is. Every
+// other one is XORed with the report before it and stored as a mask of the bytes that changed
+// followed by those bytes. A zero mask is followed by the number of unchanged reports minus one.
+// out must hold SLIPPI_PAD_DELTA_MAX_SIZE(count) bytes. Returns the encoded size
+size_t SlippiPadDeltaEncode(const u8* pads, int count, u8* out);
+
+// Decodes the first count reports. Returns the number of bytes read, or 0 if data is too short
+size_t SlippiPadDeltaDecode(const u8* data, size_t size, int count, u8* pads);
+
+// Fixed size ring of pad reports indexed by frame, holding the contiguous frames from the oldest
+// one still needed to the latest one received. One thread pushes and one thread reads without
+// locks: frames are published with a release store of the latest frame, and the reader gives
+// slots back by trimming the oldest frame the same way.
+class SlippiPadRing
+{
+public:
+  SlippiPadRing();
+
+  // Fills oldest to latest with empty pads. Not safe while the writer is pushing
+  void Reset(int32_t oldest, int32_t latest);
+
+  int32_t LatestFrame() const;
+  int32_t OldestFrame() const;
+
+  // Writer. padData holds count reports for frame, frame - 1, ... Only frames after the latest one
+  // are added, and a gap before the first of them is filled with its report. Returns false if
+  // the frames don't fit until the reader trims
+  bool Push(int32_t frame, const u8* padData, int count);
+
+  // Reader. The report of a frame between OldestFrame and LatestFrame
+  const u8* Get(int32_t frame) const;
+
+  // Reader. Frees the frames before frame, always keeping the latest one
+  void Trim(int32_t frame);
+
+private:
+  u8* slot(int32_t frame);
+
+  std::array<std::array<u8, SLIPPI_PAD_DATA_SIZE>, SLIPPI_PAD_RING_SIZE> pads;
+  std::atomic<int32_t> latestFrame;
+  std::atomic<int32_t> oldestFrame;
+};
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cinttypes>
 #include <memory>
 #include <mutex>
 
@@ -6,6 +8,7 @@
 #endif
 
 #include "Common/Logging/Log.h"
+#include "Common/Timer.h"
 #include "Core/Core.h"
 #include "Core/HW/EXI_DeviceSlippi.h"
 #include "Core/NetPlayClient.h"
@@ -20,34 +23,8 @@ extern std::unique_ptr<SlippiReplayComm> g_replayComm;
 
 static std::mutex mtx;
 static std::mutex seekMtx;
-static std::mutex diffMtx;
-static std::unique_lock<std::mutex> processingLock(diffMtx);
 static std::condition_variable condVar;
 static std::condition_variable cv_waitingForTargetFrame;
-static std::condition_variable cv_processingDiff;
-static std::atomic<int> numDiffsProcessing(0);
-
-s32 emod(s32 a, s32 b)
-{
-	assert(b != 0);
-	int r = a % b;
-	return r >= 0 ? r : r + std::abs(b);
-}
-
-std::string processDiff(std::vector<u8> iState, std::vector<u8> cState)
-{
-	INFO_LOG(SLIPPI, "Processing diff");
-	numDiffsProcessing += 1;
-	cv_processingDiff.notify_one();
-	std::string diff = std::string();
-	open_vcdiff::VCDiffEncoder encoder((char *)iState.data(), iState.size());
-	encoder.Encode((char *)cState.data(), cState.size(), &diff);
-
-	INFO_LOG(SLIPPI, "done processing");
-	numDiffsProcessing -= 1;
-	cv_processingDiff.notify_one();
-	return diff;
-}
 
 SlippiPlaybackStatus::SlippiPlaybackStatus()
 {
@@ -74,13 +51,6 @@ void SlippiPlaybackStatus::startThreads()
 
 void SlippiPlaybackStatus::prepareSlippiPlayback(s32 &frameIndex)
 {
-	// block if there's too many diffs being processed
-	while (shouldRunThreads && numDiffsProcessing > 3)
-	{
-		INFO_LOG(SLIPPI, "Processing too many diffs, blocking main process");
-		cv_processingDiff.wait(processingLock);
-	}
-
 	// Unblock thread to save a state every interval
 	if (shouldRunThreads && ((currentPlaybackFrame + 122) % FRAME_INTERVAL == 0))
 		condVar.notify_one();
@@ -117,8 +87,12 @@ void SlippiPlaybackStatus::resetPlayback()
 			m_seekThread.detach();
 
 		condVar.notify_one(); // Will allow thread to kill itself
-		futureDiffs.clear();
-		futureDiffs.rehash(0);
+		snapshots.Clear();
+
+		std::lock_guard<std::mutex> lk(prefetchMutex);
+		for (auto &slot : prefetched)
+			slot.frame = INT_MIN;
+		keyframeDecodeTimes.Reset();
 	}
 
 	shouldJumpBack = false;
@@ -129,10 +103,11 @@ void SlippiPlaybackStatus::resetPlayback()
 	inSlippiPlayback = false;
 }
 
-void SlippiPlaybackStatus::processInitialState(std::vector<u8> &iState)
+void SlippiPlaybackStatus::processInitialState()
 {
-	INFO_LOG(SLIPPI, "saving iState");
-	State::SaveToBuffer(iState);
+	INFO_LOG(SLIPPI, "saving initial state");
+	State::SaveToBuffer(cState);
+	snapshots.Add(Slippi::PLAYBACK_FIRST_SAVE, cState);
 };
 
 void SlippiPlaybackStatus::SavestateThread()
@@ -157,19 +132,19 @@ void SlippiPlaybackStatus::SavestateThread()
 			continue;
 
 		bool isStartFrame = fixedFrameNumber == Slippi::PLAYBACK_FIRST_SAVE;
-		bool hasStateBeenProcessed = futureDiffs.count(fixedFrameNumber) > 0;
+		bool hasStateBeenProcessed = snapshots.Has(fixedFrameNumber);
 
 		if (!inSlippiPlayback && isStartFrame)
 		{
-			processInitialState(iState);
+			processInitialState();
 			inSlippiPlayback = true;
 		}
 		else if (SConfig::GetInstance().m_InterfaceSeekbar && !hasStateBeenProcessed && !isStartFrame)
 		{
-			INFO_LOG(SLIPPI, "saving diff at frame: %d", fixedFrameNumber);
+			INFO_LOG(SLIPPI, "saving state at frame: %d", fixedFrameNumber);
 			State::SaveToBuffer(cState);
-
-			futureDiffs[fixedFrameNumber] = std::async(processDiff, iState, cState);
+			snapshots.Add(fixedFrameNumber, cState);
+			INFO_LOG(SLIPPI, "Playback snapshots hold %zu KB of distinct pages", snapshots.GetStoredBytes() / 1024);
 		}
 		Common::SleepCurrentThread(SLEEP_TIME_MS);
 	}
@@ -214,48 +189,31 @@ void SlippiPlaybackStatus::SeekThread()
 				targetFrameNum = latestFrame;
 			}
 
-			s32 closestStateFrame = targetFrameNum - emod(targetFrameNum - Slippi::PLAYBACK_FIRST_SAVE, FRAME_INTERVAL);
-
+			// Loading a keyframe only helps if it is closer to the target than where playback already is
+			s32 keyframe;
+			bool hasKeyframe = snapshots.FindKeyframe(targetFrameNum, &keyframe);
 			bool isLoadingStateOptimal =
-				targetFrameNum < currentPlaybackFrame || closestStateFrame > currentPlaybackFrame;
+			    hasKeyframe && (targetFrameNum < currentPlaybackFrame || keyframe > currentPlaybackFrame);
 
+			s32 seekStartFrame = currentPlaybackFrame;
 			if (isLoadingStateOptimal)
 			{
-				if (closestStateFrame <= Slippi::PLAYBACK_FIRST_SAVE)
-				{
-					State::LoadFromBuffer(iState);
-				}
-				else
-				{
-					// If this diff has been processed, load it
-					if (futureDiffs.count(closestStateFrame) > 0)
-					{
-						loadState(closestStateFrame);
-					}
-					else if (targetFrameNum < currentPlaybackFrame)
-					{
-						s32 closestActualStateFrame = closestStateFrame - FRAME_INTERVAL;
-						while (closestActualStateFrame > Slippi::PLAYBACK_FIRST_SAVE &&
-							   futureDiffs.count(closestActualStateFrame) == 0)
-							closestActualStateFrame -= FRAME_INTERVAL;
-						loadState(closestActualStateFrame);
-					}
-					else if (targetFrameNum > currentPlaybackFrame)
-					{
-						s32 closestActualStateFrame = closestStateFrame - FRAME_INTERVAL;
-						while (closestActualStateFrame > currentPlaybackFrame &&
-							   futureDiffs.count(closestActualStateFrame) == 0)
-							closestActualStateFrame -= FRAME_INTERVAL;
-
-						// only load a savestate if we find one past our current frame since we are seeking forwards
-						if (closestActualStateFrame > currentPlaybackFrame)
-							loadState(closestActualStateFrame);
-					}
-				}
+				u64 loadStartUs = Common::Timer::GetTimeUs();
+				bool wasPrefetched = loadState(keyframe);
+				seekStartFrame = keyframe;
+
+				u64 loadUs = Common::Timer::GetTimeUs() - loadStartUs;
+
+				std::lock_guard<std::mutex> lk(prefetchMutex);
+				INFO_LOG(SLIPPI,
+				         "Seeking to %d: loaded %s keyframe %d in %" PRIu64 " us | keyframe decode us (n=%" PRIu64
+				         ") p50: %" PRIu64 ", max: %" PRIu64,
+				         targetFrameNum, wasPrefetched ? "prefetched" : "stored", keyframe, loadUs,
+				         keyframeDecodeTimes.Count(), keyframeDecodeTimes.Percentile(50), keyframeDecodeTimes.Max());
 			}
 
 			// Fastforward until we get to the frame we want
-			if (targetFrameNum != closestStateFrame && targetFrameNum != latestFrame)
+			if (targetFrameNum != seekStartFrame && targetFrameNum != latestFrame)
 			{
 				setHardFFW(true);
 
@@ -273,6 +231,11 @@ void SlippiPlaybackStatus::SeekThread()
 			shouldJumpForward = false;
 			targetFrameNum = INT_MAX;
 		}
+		else if (inSlippiPlayback)
+		{
+			// Get the keyframes on either side of the playback position ready while the viewer scrubs
+			prefetchKeyframes();
+		}
 
 		Common::SleepCurrentThread(SLEEP_TIME_MS);
 	}
@@ -295,19 +258,67 @@ void SlippiPlaybackStatus::setHardFFW(bool enable) {
 	}
 }
 
-void SlippiPlaybackStatus::loadState(s32 closestStateFrame)
+void SlippiPlaybackStatus::prefetchKeyframes()
 {
-	if (closestStateFrame == Slippi::PLAYBACK_FIRST_SAVE)
-		State::LoadFromBuffer(iState);
-	else
+	s32 frame = currentPlaybackFrame;
+	std::array<s32, PREFETCH_KEYFRAMES> wanted;
+	wanted.fill(INT_MIN);
+	snapshots.FindKeyframe(frame, &wanted[0]);
+	snapshots.FindNextKeyframe(frame, &wanted[1]);
+
+	std::lock_guard<std::mutex> lk(prefetchMutex);
+	for (s32 keyframe : wanted)
 	{
-		std::string stateString;
-		decoder.Decode((char *)iState.data(), iState.size(), futureDiffs[closestStateFrame].get(), &stateString);
-		std::vector<u8> stateToLoad(stateString.begin(), stateString.end());
-		State::LoadFromBuffer(stateToLoad);
+		if (keyframe == INT_MIN)
+			continue;
+
+		auto isWanted = [&](const ssPrefetchedState &p) {
+			return p.frame != INT_MIN && std::find(wanted.begin(), wanted.end(), p.frame) != wanted.end();
+		};
+		auto hasKeyframe = [&](const ssPrefetchedState &p) { return p.frame == keyframe; };
+
+		if (std::any_of(prefetched.begin(), prefetched.end(), hasKeyframe))
+			continue;
+
+		// Reuse a slot holding a keyframe that is no longer next to the playback position
+		auto slot = std::find_if_not(prefetched.begin(), prefetched.end(), isWanted);
+		if (slot == prefetched.end())
+			return;
+
+		slot->frame = INT_MIN;
+		if (restoreKeyframe(keyframe, slot->state))
+			slot->frame = keyframe;
 	}
 }
 
+bool SlippiPlaybackStatus::restoreKeyframe(s32 keyframe, std::vector<u8> &state)
+{
+	u64 startUs = Common::Timer::GetTimeUs();
+	if (!snapshots.Restore(keyframe, state))
+		return false;
+
+	keyframeDecodeTimes.Add(Common::Timer::GetTimeUs() - startUs);
+	return true;
+}
+
+bool SlippiPlaybackStatus::loadState(s32 closestStateFrame)
+{
+	std::lock_guard<std::mutex> lk(prefetchMutex);
+
+	for (auto &slot : prefetched)
+	{
+		if (slot.frame == closestStateFrame)
+		{
+			State::LoadFromBuffer(slot.state);
+			return true;
+		}
+	}
+
+	if (restoreKeyframe(closestStateFrame, loadBuffer))
+		State::LoadFromBuffer(loadBuffer);
+	return false;
+}
+
 bool SlippiPlaybackStatus::shouldFFWFrame(int32_t frameIndex) const
 {
 	if (!isSoftFFW && !isHardFFW)
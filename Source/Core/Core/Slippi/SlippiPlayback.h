@@ -1,14 +1,15 @@
 #pragma once
 
+#include <array>
 #include <climits>
-#include <future>
-#include <open-vcdiff/src/google/vcdecoder.h>
-#include <open-vcdiff/src/google/vcencoder.h>
+#include <mutex>
 #include <SlippiLib/SlippiGame.h>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
 #include "../../Common/CommonTypes.h"
+#include "../../Common/Histogram.h"
+#include "SlippiSnapshotStore.h"
 
 class SlippiPlaybackStatus
 {
@@ -42,15 +43,29 @@ class SlippiPlaybackStatus
   private:
 	void SavestateThread(void);
 	void SeekThread(void);
-	void loadState(s32 closestStateFrame);
-	void processInitialState(std::vector<u8> &iState);
+	bool loadState(s32 closestStateFrame);
+	bool restoreKeyframe(s32 keyframe, std::vector<u8> &state);
+	void prefetchKeyframes();
+	void processInitialState();
 	void updateWatchSettingsStartEnd();
 
-	std::unordered_map<int32_t, std::shared_future<std::string>>
-	    futureDiffs;        // State diffs keyed by frameIndex, processed async
-	std::vector<u8> iState; // The initial state
-	std::vector<u8> cState; // The current (latest) state
+	SlippiSnapshotStore snapshots; // States keyed by frameIndex, including the initial state
+	std::vector<u8> cState;        // The current (latest) state
+	std::vector<u8> loadBuffer;    // State being restored by the seek thread
 
-	open_vcdiff::VCDiffDecoder decoder;
-	open_vcdiff::VCDiffEncoder *encoder = NULL;
+	// Keyframes just before and after the playback position, restored ahead of time so
+	// seeking to them only costs loading the state
+	static const int PREFETCH_KEYFRAMES = 2;
+	typedef struct
+	{
+		s32 frame = INT_MIN;
+		std::vector<u8> state;
+	} ssPrefetchedState;
+	std::array<ssPrefetchedState, PREFETCH_KEYFRAMES> prefetched;
+
+	// Time taken to rebuild each keyframe from its stored pages, in microseconds
+	Common::Histogram keyframeDecodeTimes;
+
+	// Guards prefetched and keyframeDecodeTimes
+	std::mutex prefetchMutex;
 };
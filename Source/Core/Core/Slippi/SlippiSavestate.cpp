@@ -1,6 +1,11 @@
 #include "SlippiSavestate.h"
+#include "Common/CPUDetect.h"
 #include "Common/CommonFuncs.h"
+#include "Common/Logging/Log.h"
+#include "Common/Event.h"
+#include "Common/Intrinsics.h"
 #include "Common/MemoryUtil.h"
+#include "Common/Thread.h"
 #include "Core/HW/AudioInterface.h"
 #include "Core/HW/DSP.h"
 #include "Core/HW/DVDInterface.h"
@@ -11,16 +16,211 @@
 #include "Core/HW/ProcessorInterface.h"
 #include "Core/HW/SI.h"
 #include "Core/HW/VideoInterface.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
 #include <vector>
 
-SlippiSavestate::SlippiSavestate()
+// Only one savestate can consume the dirty pages of the write tracker
+static SlippiSavestate *trackingOwner = nullptr;
+
+// Copies below this many chunks are not worth waking the helper threads for
+static const u32 PARALLEL_COPY_MIN_CHUNKS = 64;
+
+#ifdef _M_X86
+FUNCTION_TARGET_AVX2 static void streamCopyAVX2(u8 *dst, const u8 *src, size_t size)
+{
+	for (; size >= 128; dst += 128, src += 128, size -= 128)
+	{
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+		__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 64));
+		__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 96));
+		_mm256_stream_si256(reinterpret_cast<__m256i *>(dst), a);
+		_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 32), b);
+		_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 64), c);
+		_mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 96), d);
+	}
+
+	memcpy(dst, src, size);
+}
+
+static void streamCopySSE2(u8 *dst, const u8 *src, size_t size)
+{
+	for (; size >= 64; dst += 64, src += 64, size -= 64)
+	{
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst), a);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), b);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), c);
+		_mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), d);
+	}
+
+	memcpy(dst, src, size);
+}
+#endif
+
+// Copies into snapshot storage. Snapshots are not read again until a rollback, so they are
+// written with non-temporal stores rather than pulled through the cache
+static void streamCopy(u8 *dst, const u8 *src, size_t size)
+{
+#ifdef _M_X86
+	// Streaming stores need an aligned destination
+	size_t head = std::min(size, (size_t)((32 - ((uintptr_t)dst & 31)) & 31));
+	memcpy(dst, src, head);
+	dst += head;
+	src += head;
+	size -= head;
+
+	if (cpu_info.bAVX2)
+		streamCopyAVX2(dst, src, size);
+	else
+		streamCopySSE2(dst, src, size);
+
+	// Streaming stores are weakly ordered, make them visible before anyone is told we are done
+	_mm_sfence();
+#else
+	memcpy(dst, src, size);
+#endif
+}
+
+// Helper threads splitting large snapshot copies with the CPU thread. They stay parked on an
+// event between jobs, so handing work over costs a wakeup rather than a thread start
+class SlippiSavestate::CopyWorkers
+{
+  public:
+	explicit CopyWorkers(u32 count)
+	{
+		for (u32 i = 0; i < count; i++)
+		{
+			wakeEvents.push_back(std::make_unique<Common::Event>());
+		}
+
+		for (u32 i = 0; i < count; i++)
+		{
+			threads.emplace_back(&CopyWorkers::workerLoop, this, i);
+		}
+	}
+
+	~CopyWorkers()
+	{
+		running.store(false);
+		for (auto it = wakeEvents.begin(); it != wakeEvents.end(); ++it)
+		{
+			(*it)->Set();
+		}
+
+		for (auto it = threads.begin(); it != threads.end(); ++it)
+		{
+			it->join();
+		}
+	}
+
+	// Runs fn(begin, end) over [0, count), split between the helpers and the calling thread
+	void Run(u32 count, const std::function<void(u32, u32)> &fn)
+	{
+		if (threads.empty() || count < PARALLEL_COPY_MIN_CHUNKS)
+		{
+			fn(0, count);
+			return;
+		}
+
+		job = &fn;
+		jobCount = count;
+		pending.store((u32)threads.size());
+		for (auto it = wakeEvents.begin(); it != wakeEvents.end(); ++it)
+		{
+			(*it)->Set();
+		}
+
+		fn(0, count / (u32)(threads.size() + 1));
+
+		// The remaining parts take about as long as ours did, so spin rather than sleep
+		while (pending.load(std::memory_order_acquire))
+			Common::YieldCPU();
+	}
+
+  private:
+	void workerLoop(u32 id)
+	{
+		Common::SetCurrentThreadName("Slippi Savestate Copy Thread");
+
+		while (true)
+		{
+			wakeEvents[id]->Wait();
+			if (!running.load())
+				return;
+
+			u32 parts = (u32)threads.size() + 1;
+			u32 begin = (u32)((u64)jobCount * (id + 1) / parts);
+			u32 end = (u32)((u64)jobCount * (id + 2) / parts);
+			(*job)(begin, end);
+
+			pending.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::vector<std::unique_ptr<Common::Event>> wakeEvents;
+	const std::function<void(u32, u32)> *job = nullptr;
+	u32 jobCount = 0;
+	std::atomic<u32> pending{0};
+	std::atomic<bool> running{true};
+};
+
+SlippiSavestate::SlippiSavestate(int maxFrames, u32 deltaCapacity)
 {
 	initBackupLocs();
 
+	size_t totalSize = 0;
+	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+	{
+		totalSize += it->endAddress - it->startAddress;
+	}
+
+	latest = static_cast<u8 *>(Common::AllocateAlignedMemory(totalSize, 64));
+
+	size_t offset = 0;
 	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
 	{
-		auto size = it->endAddress - it->startAddress;
-		it->data = static_cast<u8 *>(Common::AllocateAlignedMemory(size, 64));
+		it->data = latest + offset;
+		offset += it->endAddress - it->startAddress;
+	}
+
+	initChunks();
+
+	frames.resize(std::max(maxFrames, 1));
+	slotCount = deltaCapacity / Memory::TRACKED_PAGE_SIZE;
+	deltaSlots = static_cast<u8 *>(Common::AllocateAlignedMemory((size_t)slotCount * Memory::TRACKED_PAGE_SIZE, 64));
+
+	changedChunks.reserve(chunks.size());
+	chunkRestore.resize(chunks.size(), 0);
+	restoreChunks.reserve(chunks.size());
+
+	// The CPU and GPU threads are busy already, leave them their cores
+	copyWorkers = std::make_unique<CopyWorkers>((u32)std::min(std::max(cpu_info.num_cores - 2, 0), 3));
+
+	// Track writes to the backed up regions so that only the chunks written since the latest
+	// capture need to be looked at. Otherwise changes are found by comparing contents
+	if (!trackingOwner && Memory::IsWriteTrackingSupported())
+	{
+		trackingWrites = true;
+		for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+		{
+			if (!Memory::TrackWrites(it->startAddress, it->endAddress - it->startAddress))
+			{
+				Memory::StopWriteTracking();
+				trackingWrites = false;
+				break;
+			}
+		}
+
+		if (trackingWrites)
+			trackingOwner = this;
 	}
 
 	// u8 *ptr = nullptr;
@@ -33,10 +233,14 @@ SlippiSavestate::SlippiSavestate()
 
 SlippiSavestate::~SlippiSavestate()
 {
-	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+	if (trackingWrites)
 	{
-		Common::FreeAlignedMemory(it->data);
+		Memory::StopWriteTracking();
+		trackingOwner = nullptr;
 	}
+
+	Common::FreeAlignedMemory(latest);
+	Common::FreeAlignedMemory(deltaSlots);
 }
 
 bool cmpFn(SlippiSavestate::PreserveBlock pb1, SlippiSavestate::PreserveBlock pb2)
@@ -168,6 +372,156 @@ void SlippiSavestate::initBackupLocs()
 	processedLocs.insert(processedLocs.end(), backupLocs.begin(), backupLocs.end());
 }
 
+void SlippiSavestate::initChunks()
+{
+	chunks.clear();
+	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+	{
+		for (u32 address = it->startAddress; address < it->endAddress;)
+		{
+			u32 pageEnd = ((address >> Memory::TRACKED_PAGE_SHIFT) + 1) << Memory::TRACKED_PAGE_SHIFT;
+			u32 endAddress = std::min(pageEnd, it->endAddress);
+
+			ssChunk chunk = {address, endAddress - address, it->data + (address - it->startAddress)};
+			chunks.push_back(chunk);
+			address = endAddress;
+		}
+	}
+
+	// backupLocs are sorted, so the chunks of a page are contiguous
+	pageChunks.assign(Memory::TRACKED_PAGE_COUNT, std::make_pair(0, 0));
+	for (u32 i = 0; i < chunks.size(); i++)
+	{
+		auto &range = pageChunks[(chunks[i].address & Memory::RAM_MASK) >> Memory::TRACKED_PAGE_SHIFT];
+		if (range.second == 0)
+			range.first = i;
+		range.second++;
+	}
+}
+
+u8 *SlippiSavestate::slotData(u32 slot)
+{
+	return deltaSlots + (size_t)slot * Memory::TRACKED_PAGE_SIZE;
+}
+
+void SlippiSavestate::dropOldestFrame()
+{
+	ssFrame &oldest = frameAt(0);
+	slotsUsed -= (u32)oldest.deltas.size();
+	oldest.deltas.clear();
+
+	frameHead = (frameHead + 1) % frames.size();
+	frameCount--;
+}
+
+void SlippiSavestate::growDeltaSlots(u32 freeSlots)
+{
+	u32 newCount = std::max(slotCount * 2, slotsUsed + freeSlots);
+	u8 *newSlots = static_cast<u8 *>(Common::AllocateAlignedMemory((size_t)newCount * Memory::TRACKED_PAGE_SIZE, 64));
+
+	// Move the used slots to the start of the new ring, oldest first
+	u32 tail = slotCount ? (slotHead + slotCount - slotsUsed) % slotCount : 0;
+	for (u32 i = 0; i < slotsUsed; i++)
+	{
+		memcpy(newSlots + (size_t)i * Memory::TRACKED_PAGE_SIZE, slotData((tail + i) % slotCount),
+		       Memory::TRACKED_PAGE_SIZE);
+	}
+
+	for (u32 i = 0; i < frameCount; i++)
+	{
+		ssFrame &f = frameAt(i);
+		for (auto it = f.deltas.begin(); it != f.deltas.end(); ++it)
+		{
+			it->slot = (it->slot + slotCount - tail) % slotCount;
+		}
+		f.firstSlot = f.deltas.empty() ? slotsUsed : f.deltas.front().slot;
+	}
+
+	WARN_LOG(SLIPPI_ONLINE, "Rollback deltas need more than %u KB, growing them to %u KB",
+	         slotCount * Memory::TRACKED_PAGE_SIZE / 1024, newCount * Memory::TRACKED_PAGE_SIZE / 1024);
+
+	Common::FreeAlignedMemory(deltaSlots);
+	deltaSlots = newSlots;
+	slotCount = newCount;
+	slotHead = slotsUsed;
+}
+
+void SlippiSavestate::collectChangedChunks()
+{
+	changedChunks.clear();
+
+	if (trackingWrites)
+	{
+		dirtyPages.clear();
+		Memory::CollectDirtyPages(&dirtyPages);
+		for (auto it = dirtyPages.begin(); it != dirtyPages.end(); ++it)
+		{
+			auto &range = pageChunks[*it];
+			for (u32 i = range.first; i < range.first + range.second; i++)
+			{
+				changedChunks.push_back(i);
+			}
+		}
+		return;
+	}
+
+	for (u32 i = 0; i < chunks.size(); i++)
+	{
+		if (memcmp(Memory::GetPointer(chunks[i].address), chunks[i].data, chunks[i].length))
+			changedChunks.push_back(i);
+	}
+}
+
+bool SlippiSavestate::HasFrame(s32 frame) const
+{
+	for (u32 i = 0; i < frameCount; i++)
+	{
+		if (frameAt(i).frame == frame)
+			return true;
+	}
+
+	return false;
+}
+
+size_t SlippiSavestate::GetBackupSize() const
+{
+	size_t size = 0;
+	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+	{
+		size += it->endAddress - it->startAddress;
+	}
+
+	return size;
+}
+
+std::vector<SlippiSavestate::PreserveBlock> SlippiSavestate::ReadPreserveBlocks(const u8 *data)
+{
+	std::vector<PreserveBlock> blocks;
+
+	const u32 *preserveArr = (const u32 *)data;
+	for (int idx = 0; Common::swap32(preserveArr[idx]) != 0; idx += 2)
+	{
+		PreserveBlock p = {Common::swap32(preserveArr[idx]), Common::swap32(preserveArr[idx + 1])};
+		blocks.push_back(p);
+	}
+
+	return blocks;
+}
+
+void SlippiSavestate::Clear()
+{
+	for (auto it = frames.begin(); it != frames.end(); ++it)
+	{
+		it->deltas.clear();
+	}
+
+	frameHead = 0;
+	frameCount = 0;
+	slotHead = 0;
+	slotsUsed = 0;
+	hasLatest = false;
+}
+
 void SlippiSavestate::getDolphinState(PointerWrap &p)
 {
 	// p.DoArray(Memory::m_pRAM, Memory::RAM_SIZE);
@@ -190,23 +544,94 @@ void SlippiSavestate::getDolphinState(PointerWrap &p)
 	// p.DoMarker("AudioInterface");
 }
 
-void SlippiSavestate::Capture()
+void SlippiSavestate::Capture(s32 frame)
 {
-	// First copy memory
-	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+	if (frameCount == frames.size())
+		dropOldestFrame();
+
+	u32 firstDeltaSlot = slotHead;
+	bool storeDeltas = false;
+
+	if (!hasLatest)
+	{
+		// Start from a full copy. Pending dirty pages are flushed first so that nothing written
+		// during the copy is missed
+		if (trackingWrites)
+			collectChangedChunks();
+
+		changedChunks.clear();
+		for (u32 i = 0; i < chunks.size(); i++)
+		{
+			changedChunks.push_back(i);
+		}
+
+		hasLatest = true;
+	}
+	else
 	{
-		auto size = it->endAddress - it->startAddress;
-		Memory::CopyFromEmu(it->data, it->startAddress, size);
+		collectChangedChunks();
+
+		// Save what the changed chunks held at the previous frame as its delta. Every frame kept
+		// has to stay loadable, so the slots are grown when there is no room left for it
+		if (frameCount > 0)
+		{
+			if (slotCount - slotsUsed < changedChunks.size())
+				growDeltaSlots((u32)changedChunks.size());
+
+			firstDeltaSlot = slotHead;
+			ssFrame &prev = frameAt(frameCount - 1);
+			prev.firstSlot = slotHead;
+			for (auto it = changedChunks.begin(); it != changedChunks.end(); ++it)
+			{
+				ssChunkDelta delta = {*it, slotHead};
+				prev.deltas.push_back(delta);
+
+				slotHead = (slotHead + 1) % slotCount;
+				slotsUsed++;
+			}
+
+			storeDeltas = true;
+		}
 	}
 
+	// Copy the changed chunks, the k-th one having its previous contents go to the k-th slot
+	copyWorkers->Run((u32)changedChunks.size(), [&](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; i++)
+		{
+			ssChunk &chunk = chunks[changedChunks[i]];
+			if (storeDeltas)
+				streamCopy(slotData((firstDeltaSlot + i) % slotCount), chunk.data, chunk.length);
+			streamCopy(chunk.data, Memory::GetPointer(chunk.address), chunk.length);
+		}
+	});
+
+	ssFrame &current = frameAt(frameCount++);
+	current.frame = frame;
+	current.deltas.clear();
+	current.firstSlot = slotHead;
+
 	//// Second copy dolphin states
 	// u8 *ptr = &dolphinSsBackup[0];
 	// PointerWrap p(&ptr, PointerWrap::MODE_WRITE);
 	// getDolphinState(p);
 }
 
-void SlippiSavestate::Load(std::vector<PreserveBlock> blocks)
+bool SlippiSavestate::Load(s32 frame, std::vector<PreserveBlock> blocks)
 {
+	// Find the latest capture of this frame
+	u32 idx = frameCount;
+	for (u32 i = frameCount; i-- > 0;)
+	{
+		if (frameAt(i).frame == frame)
+		{
+			idx = i;
+			break;
+		}
+	}
+
+	if (idx == frameCount)
+		return false;
+
 	// static std::vector<PreserveBlock> interruptStuff = {
 	//    {0x804BF9D2, 4},
 	//    {0x804C3DE4, 20},
@@ -231,13 +656,56 @@ void SlippiSavestate::Load(std::vector<PreserveBlock> blocks)
 		Memory::CopyFromEmu(&preservationMap[*it][0], it->address, it->length);
 	}
 
+	// Anything changed since the latest capture has to be put back
+	collectChangedChunks();
+	for (auto it = changedChunks.begin(); it != changedChunks.end(); ++it)
+	{
+		chunkRestore[*it] = 1;
+	}
+
+	// Walk the deltas back to the requested frame, newest first, so that each chunk ends up with
+	// its contents from the oldest delta after that frame
+	u32 releasedSlots = 0;
+	for (u32 i = frameCount - 1; i-- > idx;)
+	{
+		ssFrame &f = frameAt(i);
+		for (auto it = f.deltas.begin(); it != f.deltas.end(); ++it)
+		{
+			memcpy(chunks[it->chunk].data, slotData(it->slot), chunks[it->chunk].length);
+			chunkRestore[it->chunk] = 1;
+		}
+
+		releasedSlots += (u32)f.deltas.size();
+		f.deltas.clear();
+	}
+
 	// Restore memory blocks
-	for (auto it = backupLocs.begin(); it != backupLocs.end(); ++it)
+	restoreChunks.clear();
+	for (u32 i = 0; i < chunks.size(); i++)
 	{
-		auto size = it->endAddress - it->startAddress;
-		Memory::CopyToEmu(it->startAddress, it->data, size);
+		if (chunkRestore[i])
+			restoreChunks.push_back(i);
+		chunkRestore[i] = 0;
 	}
 
+	copyWorkers->Run((u32)restoreChunks.size(), [&](u32 begin, u32 end) {
+		for (u32 i = begin; i < end; i++)
+		{
+			ssChunk &chunk = chunks[restoreChunks[i]];
+			if (trackingWrites)
+				Memory::MarkPagesDirty(chunk.address, chunk.length);
+			Memory::CopyToEmu(chunk.address, chunk.data, chunk.length);
+		}
+	});
+
+	// The requested frame is the latest capture now
+	if (releasedSlots)
+	{
+		slotHead = (slotHead + slotCount - releasedSlots) % slotCount;
+		slotsUsed -= releasedSlots;
+	}
+	frameCount = idx + 1;
+
 	//// Restore audio
 	// u8 *ptr = &dolphinSsBackup[0];
 	// PointerWrap p(&ptr, PointerWrap::MODE_READ);
@@ -248,4 +716,6 @@ void SlippiSavestate::Load(std::vector<PreserveBlock> blocks)
 	{
 		Memory::CopyToEmu(it->address, &preservationMap[*it][0], it->length);
 	}
+
+	return true;
 }
@@ -2,10 +2,14 @@
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
+#include <memory>
 #include <unordered_map>
 
 class PointerWrap;
 
+// Rollback savestates for the last maxFrames captured frames. Only the latest capture is kept
+// in full, every older frame is stored as the chunks that changed between it and the next one
+// captured, so a frame is restored by walking those deltas back from the latest capture.
 class SlippiSavestate
 {
   public:
@@ -17,11 +21,24 @@ class SlippiSavestate
 		bool operator==(const PreserveBlock &p) const { return address == p.address && length == p.length; }
 	};
 
-	SlippiSavestate();
+	SlippiSavestate(int maxFrames, u32 deltaCapacity = DEFAULT_DELTA_CAPACITY);
 	~SlippiSavestate();
 
-	void Capture();
-	void Load(std::vector<PreserveBlock> blocks);
+	void Capture(s32 frame);
+	bool HasFrame(s32 frame) const;
+	bool Load(s32 frame, std::vector<PreserveBlock> blocks);
+	void Clear();
+	int GetMaxFrames() const { return (int)frames.size(); }
+
+	// Bytes of game memory backed up by each capture
+	size_t GetBackupSize() const;
+
+	// Reads the big endian {address, length} pairs sent along with a load request, up to the
+	// zero address that ends them
+	static std::vector<PreserveBlock> ReadPreserveBlocks(const u8 *data);
+
+	// Initial storage for frame deltas, in bytes. More is allocated when a capture needs it
+	static const u32 DEFAULT_DELTA_CAPACITY = 4 * 1024 * 1024;
 
   private:
 	typedef struct
@@ -36,6 +53,67 @@ class SlippiSavestate
 
 	void initBackupLocs();
 
+	// Piece of a backup location that sits within a single tracked page
+	typedef struct
+	{
+		u32 address;
+		u32 length;
+		u8 *data;
+	} ssChunk;
+
+	std::vector<ssChunk> chunks;
+	std::vector<std::pair<u32, u32>> pageChunks; // [first chunk, chunk count) of each tracked page
+
+	void initChunks();
+
+	typedef struct
+	{
+		u32 chunk;
+		u32 slot;
+	} ssChunkDelta;
+
+	typedef struct
+	{
+		s32 frame;
+		// Contents at this frame of the chunks that changed before the next capture. Stored in
+		// deltaSlots[firstSlot, firstSlot + deltas.size()) wrapping around
+		std::vector<ssChunkDelta> deltas;
+		u32 firstSlot;
+	} ssFrame;
+
+	// Contents of the backup locations as of the latest capture
+	u8 *latest = nullptr;
+	bool hasLatest = false;
+
+	// Ring of captured frames, oldest first
+	std::vector<ssFrame> frames;
+	u32 frameHead = 0;
+	u32 frameCount = 0;
+
+	// Ring of chunk sized slots holding frame deltas, allocated and freed in frame order. Grown
+	// when the deltas of the frames kept do not fit
+	u8 *deltaSlots = nullptr;
+	u32 slotCount = 0;
+	u32 slotHead = 0;
+	u32 slotsUsed = 0;
+
+	std::vector<u32> changedChunks;
+	std::vector<u32> dirtyPages;
+	std::vector<u8> chunkRestore;
+	std::vector<u32> restoreChunks;
+	bool trackingWrites = false;
+
+	// Helper threads for copies big enough to be worth splitting
+	class CopyWorkers;
+	std::unique_ptr<CopyWorkers> copyWorkers;
+
+	ssFrame &frameAt(u32 idx) { return frames[(frameHead + idx) % frames.size()]; }
+	const ssFrame &frameAt(u32 idx) const { return frames[(frameHead + idx) % frames.size()]; }
+	u8 *slotData(u32 slot);
+	void dropOldestFrame();
+	void growDeltaSlots(u32 freeSlots);
+	void collectChangedChunks();
+
 	typedef struct
 	{
 		u32 address;
@@ -0,0 +1,122 @@
+#include "SlippiSnapshotStore.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <xxhash.h>
+
+const u8 *SlippiSnapshotStore::pageData(u32 page) const
+{
+	return &pageBlocks[page / PAGES_PER_BLOCK][(page % PAGES_PER_BLOCK) * PAGE_SIZE];
+}
+
+u32 SlippiSnapshotStore::findOrAddPage(const u8 *data)
+{
+	u64 hash = XXH64(data, PAGE_SIZE, 0);
+
+	auto &candidates = pagesByHash[hash];
+	for (u32 page : candidates)
+	{
+		if (memcmp(pageData(page), data, PAGE_SIZE) == 0)
+			return page;
+	}
+
+	u32 page = pageCount++;
+	if (page / PAGES_PER_BLOCK >= pageBlocks.size())
+		pageBlocks.emplace_back(new u8[PAGES_PER_BLOCK * PAGE_SIZE]);
+
+	memcpy(&pageBlocks[page / PAGES_PER_BLOCK][(page % PAGES_PER_BLOCK) * PAGE_SIZE], data, PAGE_SIZE);
+	candidates.push_back(page);
+	return page;
+}
+
+void SlippiSnapshotStore::Add(s32 frame, const std::vector<u8> &state)
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+
+	ssSnapshot &snapshot = snapshots[frame];
+	snapshot.size = state.size();
+	snapshot.pages.clear();
+	snapshot.pages.reserve((state.size() + PAGE_SIZE - 1) / PAGE_SIZE);
+
+	size_t fullPages = state.size() / PAGE_SIZE;
+	for (size_t i = 0; i < fullPages; i++)
+		snapshot.pages.push_back(findOrAddPage(&state[i * PAGE_SIZE]));
+
+	// Zero pad the last partial page
+	size_t tail = state.size() % PAGE_SIZE;
+	if (tail)
+	{
+		u8 lastPage[PAGE_SIZE] = {};
+		memcpy(lastPage, &state[fullPages * PAGE_SIZE], tail);
+		snapshot.pages.push_back(findOrAddPage(lastPage));
+	}
+}
+
+bool SlippiSnapshotStore::Has(s32 frame) const
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+	return snapshots.count(frame) > 0;
+}
+
+bool SlippiSnapshotStore::Restore(s32 frame, std::vector<u8> &state) const
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+
+	auto it = snapshots.find(frame);
+	if (it == snapshots.end())
+		return false;
+
+	const ssSnapshot &snapshot = it->second;
+	state.resize(snapshot.size);
+
+	size_t offset = 0;
+	for (u32 page : snapshot.pages)
+	{
+		size_t len = std::min<size_t>(PAGE_SIZE, snapshot.size - offset);
+		memcpy(&state[offset], pageData(page), len);
+		offset += len;
+	}
+
+	return true;
+}
+
+bool SlippiSnapshotStore::FindKeyframe(s32 frame, s32 *keyframe) const
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+
+	auto it = snapshots.upper_bound(frame);
+	if (it == snapshots.begin())
+		return false;
+
+	*keyframe = std::prev(it)->first;
+	return true;
+}
+
+bool SlippiSnapshotStore::FindNextKeyframe(s32 frame, s32 *keyframe) const
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+
+	auto it = snapshots.upper_bound(frame);
+	if (it == snapshots.end())
+		return false;
+
+	*keyframe = it->first;
+	return true;
+}
+
+void SlippiSnapshotStore::Clear()
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+
+	snapshots.clear();
+	pagesByHash.clear();
+	pageBlocks.clear();
+	pageCount = 0;
+}
+
+size_t SlippiSnapshotStore::GetStoredBytes() const
+{
+	std::lock_guard<std::mutex> lk(storeMutex);
+	return (size_t)pageCount * PAGE_SIZE;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Savestate history for replay playback. States are split in 4KB pages and every distinct
+// page is stored once, found by its xxhash, so a snapshot is just the list of its pages.
+// Most of the state does not change between snapshots, so each one only costs the pages
+// that did. Safe to use from several threads.
+class SlippiSnapshotStore
+{
+  public:
+	static const u32 PAGE_SIZE = 4096;
+
+	void Add(s32 frame, const std::vector<u8> &state);
+	bool Has(s32 frame) const;
+	bool Restore(s32 frame, std::vector<u8> &state) const;
+	void Clear();
+
+	// Keyframe index. Finds the latest snapshot at or before a frame, or the first one after it
+	bool FindKeyframe(s32 frame, s32 *keyframe) const;
+	bool FindNextKeyframe(s32 frame, s32 *keyframe) const;
+
+	// Memory held by distinct pages, in bytes
+	size_t GetStoredBytes() const;
+
+  private:
+	typedef struct
+	{
+		size_t size;
+		std::vector<u32> pages;
+	} ssSnapshot;
+
+	const u8 *pageData(u32 page) const;
+	u32 findOrAddPage(const u8 *data);
+
+	// Distinct pages, allocated in blocks so stored pages never move
+	static const u32 PAGES_PER_BLOCK = 256;
+	std::vector<std::unique_ptr<u8[]>> pageBlocks;
+	u32 pageCount = 0;
+
+	// Pages with each hash. More than one only on a hash collision
+	std::unordered_map<u64, std::vector<u32>> pagesByHash;
+
+	// Ordered by frame so the nearest snapshot to any frame is a single lookup
+	std::map<s32, ssSnapshot> snapshots;
+
+	mutable std::mutex storeMutex;
+};
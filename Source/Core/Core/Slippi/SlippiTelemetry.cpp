@@ -0,0 +1,162 @@
+#include "SlippiTelemetry.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "Common/Event.h"
+#include "Common/FileUtil.h"
+#include "Common/Histogram.h"
+#include "Common/StringUtil.h"
+#include "Common/Thread.h"
+#include "Common/Timer.h"
+#include "Core/ConfigManager.h"
+
+namespace SlippiTelemetry
+{
+static const std::chrono::seconds EXPORT_INTERVAL(10);
+
+// The file is moved to a .1 backup and started over once it reaches this size
+static const u64 MAX_FILE_SIZE = 4 * 1024 * 1024;
+
+static const char *METRIC_NAMES[] = {"rollback_depth", "capture_time_us", "load_time_us", "time_ahead_us",
+                                     "time_behind_us", "stall_frames", "skipped_frames", "ping_us"};
+static_assert(sizeof(METRIC_NAMES) / sizeof(METRIC_NAMES[0]) == (size_t)Metric::Count,
+              "Every metric needs a name");
+
+// Same bucket layout as Common::Histogram. Only the recording thread writes, so updates are plain
+// relaxed stores that never wait on the export thread
+struct AtomicHistogram
+{
+	static const size_t NUM_BUCKETS = Common::Histogram::NUM_BUCKETS;
+
+	std::array<std::atomic<u64>, NUM_BUCKETS> buckets{};
+	std::atomic<u64> sum{0};
+};
+
+struct Snapshot
+{
+	std::array<u64, AtomicHistogram::NUM_BUCKETS> buckets{};
+	u64 sum = 0;
+};
+
+static std::array<AtomicHistogram, (size_t)Metric::Count> s_metrics;
+
+static std::thread s_export_thread;
+static Common::Event s_export_event;
+static std::atomic<bool> s_export_running{false};
+
+void Record(Metric metric, u64 value)
+{
+	AtomicHistogram &h = s_metrics[(size_t)metric];
+	std::atomic<u64> &bucket = h.buckets[Common::Histogram::BucketIndex(value)];
+	bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	h.sum.store(h.sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+// Appends the samples recorded since the previous snapshot as a JSON object
+static bool appendInterval(std::string &out, const AtomicHistogram &h, Snapshot &previous)
+{
+	Snapshot current;
+	u64 count = 0;
+	for (size_t i = 0; i < AtomicHistogram::NUM_BUCKETS; i++)
+	{
+		current.buckets[i] = h.buckets[i].load(std::memory_order_relaxed);
+		count += current.buckets[i] - previous.buckets[i];
+	}
+	current.sum = h.sum.load(std::memory_order_relaxed);
+
+	if (count == 0)
+	{
+		previous = current;
+		return false;
+	}
+
+	// Percentiles are bucket upper bounds, like Common::Histogram
+	const double percentiles[] = {50, 90, 99, 100};
+	u64 values[4] = {};
+	std::string buckets;
+	u64 seen = 0;
+	int next = 0;
+	for (size_t i = 0; i < AtomicHistogram::NUM_BUCKETS; i++)
+	{
+		u64 n = current.buckets[i] - previous.buckets[i];
+		if (n == 0)
+			continue;
+
+		u64 upper = Common::Histogram::BucketUpperBound(i);
+		buckets += StringFromFormat("%s[%llu,%llu]", buckets.empty() ? "" : ",", (unsigned long long)upper,
+		                            (unsigned long long)n);
+
+		seen += n;
+		while (next < 4 && seen >= (u64)(count * percentiles[next] / 100.0 + 0.5))
+			values[next++] = upper;
+	}
+
+	out += StringFromFormat("{\"count\":%llu,\"sum\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu,"
+	                        "\"buckets\":[%s]}",
+	                        (unsigned long long)count, (unsigned long long)(current.sum - previous.sum),
+	                        (unsigned long long)values[0], (unsigned long long)values[1],
+	                        (unsigned long long)values[2], (unsigned long long)values[3], buckets.c_str());
+
+	previous = current;
+	return true;
+}
+
+static void exportThread()
+{
+	Common::SetCurrentThreadName("Slippi telemetry");
+
+	const std::string path = File::GetUserPath(D_LOGS_IDX) + "slippi-telemetry.jsonl";
+	std::array<Snapshot, (size_t)Metric::Count> previous;
+
+	while (s_export_running)
+	{
+		s_export_event.WaitFor(EXPORT_INTERVAL);
+
+		std::string line;
+		for (size_t i = 0; i < (size_t)Metric::Count; i++)
+		{
+			std::string metric;
+			if (appendInterval(metric, s_metrics[i], previous[i]))
+				line += StringFromFormat("%s\"%s\":%s", line.empty() ? "" : ",", METRIC_NAMES[i], metric.c_str());
+		}
+
+		if (line.empty())
+			continue;
+
+		if (File::Exists(path) && File::GetSize(path) >= MAX_FILE_SIZE)
+			File::Rename(path, path + ".1");
+
+		line = StringFromFormat("{\"time\":%llu,\"metrics\":{%s}}\n",
+		                        (unsigned long long)Common::Timer::GetTimeSinceJan1970(), line.c_str());
+
+		File::IOFile f(path, "ab");
+		f.WriteBytes(line.data(), line.size());
+	}
+}
+
+void Start()
+{
+	if (!SConfig::GetInstance().m_slippiTelemetry || s_export_running)
+		return;
+
+	File::CreateFullPath(File::GetUserPath(D_LOGS_IDX));
+
+	s_export_running = true;
+	s_export_thread = std::thread(exportThread);
+}
+
+void Stop()
+{
+	if (!s_export_running)
+		return;
+
+	// Wakes the thread for one last export
+	s_export_running = false;
+	s_export_event.Set();
+	s_export_thread.join();
+}
+}
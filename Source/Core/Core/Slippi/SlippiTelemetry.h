@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+// Low overhead telemetry for online play. Code paths record samples into fixed histograms, and
+// while started a background thread appends the histograms of each interval to a rolling file in
+// the logs folder as one JSON line. Each metric must only be recorded from one thread; its
+// buckets are relaxed atomics that the export thread reads without ever blocking the recorder.
+namespace SlippiTelemetry
+{
+enum class Metric
+{
+	RollbackDepth, // frames rolled back per savestate load (CPU thread)
+	CaptureTimeUs, // savestate capture time (CPU thread)
+	LoadTimeUs,    // savestate load time (CPU thread)
+	TimeAheadUs,   // time offset on sync frames when ahead of the opponent (CPU thread)
+	TimeBehindUs,  // time offset on sync frames when behind the opponent (CPU thread)
+	StallFrames,   // length of each halt on the rollback limit, in frames (CPU thread)
+	SkippedFrames, // frames halted by each time sync correction (CPU thread)
+	PingUs,        // round trip time of each pad ack (netplay thread)
+	Count,
+};
+
+void Record(Metric metric, u64 value);
+
+// Export runs while started. Does nothing unless enabled in the config
+void Start();
+void Stop();
+}
@@ -0,0 +1,115 @@
+#include "SlippiTimeSync.h"
+
+#include <algorithm>
+#include <cmath>
+
+// How much the real offset is expected to wander between two samples, as a variance in us^2
+static const double PROCESS_VARIANCE = 100.0 * 100.0;
+
+// Measurement noise is never assumed smaller than this, and starts at the upper value
+static const double MIN_NOISE_VARIANCE = 500.0 * 500.0;
+static const double INITIAL_NOISE_VARIANCE = 4000.0 * 4000.0;
+
+// Weight of the newest sample in the running jitter and RTT averages
+static const double NOISE_ALPHA = 0.05;
+static const double RTT_ALPHA = 0.1;
+
+// Innovations beyond this many standard deviations are clamped
+static const double OUTLIER_SIGMAS = 3.0;
+
+// Part of the remaining offset corrected on each update, and the most delay added per update
+static const double CORRECTION_GAIN = 0.5;
+static const s32 MAX_DELAY_US = SlippiTimeSync::FRAME_US;
+
+SlippiTimeSync::SlippiTimeSync()
+{
+	Reset();
+}
+
+void SlippiTimeSync::Reset()
+{
+	std::lock_guard<std::mutex> lk(syncMutex);
+
+	offsetUs = 0;
+	offsetVariance = 0;
+	noiseVariance = INITIAL_NOISE_VARIANCE;
+	sampleCount = 0;
+	rttUs = 0;
+	rttSampleCount = 0;
+}
+
+void SlippiTimeSync::AddRemoteFrame(s32 remoteFrame, s32 localFrame, u64 localFrameTimeUs, u64 receiveTimeUs)
+{
+	std::lock_guard<std::mutex> lk(syncMutex);
+
+	// Guess our local time when the opponent sent the frame, and compare it to when we sent ours
+	double sendTimeUs = (double)receiveTimeUs - rttUs / 2;
+	double sample = sendTimeUs - (double)localFrameTimeUs + (double)FRAME_US * (localFrame - remoteFrame);
+
+	if (sampleCount++ == 0)
+	{
+		offsetUs = sample;
+		offsetVariance = noiseVariance;
+		return;
+	}
+
+	offsetVariance += PROCESS_VARIANCE;
+
+	double innovation = sample - offsetUs;
+	double spread = OUTLIER_SIGMAS * std::sqrt(offsetVariance + noiseVariance);
+	innovation = std::max(-spread, std::min(spread, innovation));
+
+	noiseVariance = std::max(MIN_NOISE_VARIANCE,
+	                         (1 - NOISE_ALPHA) * noiseVariance + NOISE_ALPHA * innovation * innovation);
+
+	double gain = offsetVariance / (offsetVariance + noiseVariance);
+	offsetUs += gain * innovation;
+	offsetVariance *= 1 - gain;
+}
+
+void SlippiTimeSync::AddRttSample(u64 sampleUs)
+{
+	std::lock_guard<std::mutex> lk(syncMutex);
+
+	if (rttSampleCount++ == 0)
+		rttUs = (double)sampleUs;
+	else
+		rttUs += RTT_ALPHA * ((double)sampleUs - rttUs);
+}
+
+SlippiTimeSync::ssCorrection SlippiTimeSync::Update(s32 frame)
+{
+	std::lock_guard<std::mutex> lk(syncMutex);
+
+	ssCorrection correction = {0, 0};
+	if (sampleCount == 0 || offsetUs <= DEADBAND_US)
+		return correction;
+
+	if (offsetUs > SKIP_THRESHOLD_US)
+	{
+		// Too far ahead to stretch frames in reasonable time. On early frames, support skipping more
+		int maxSkipFrames = frame <= 120 ? 5 : 1;
+		correction.skipFrames = std::min(maxSkipFrames, (int)((offsetUs - SKIP_THRESHOLD_US) / FRAME_US) + 1);
+		offsetUs -= correction.skipFrames * FRAME_US;
+		return correction;
+	}
+
+	double delayUs = std::min((double)MAX_DELAY_US, (offsetUs - DEADBAND_US / 2) * CORRECTION_GAIN);
+	correction.delayUs = (u32)delayUs;
+
+	// The estimate follows the correction right away instead of waiting for new samples to show it
+	offsetUs -= correction.delayUs;
+	return correction;
+}
+
+s32 SlippiTimeSync::GetOffsetUs() const
+{
+	std::lock_guard<std::mutex> lk(syncMutex);
+	return (s32)offsetUs;
+}
+
+u64 SlippiTimeSync::GetRttUs() const
+{
+	std::lock_guard<std::mutex> lk(syncMutex);
+	return (u64)rttUs;
+}
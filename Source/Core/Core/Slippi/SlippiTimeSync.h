@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+
+#include "Common/CommonTypes.h"
+
+// Estimates how far ahead of the opponent the local game runs, and decides how to pace the local
+// frame limiter to stay in sync with them. Every received pad gives a noisy sample of the offset
+// between both clocks; a one state Kalman filter smooths them with a measurement noise that
+// follows the link's jitter, and samples far outside the expected spread are clamped so a single
+// late packet can't move the estimate much. Samples come from the netplay thread and corrections
+// are taken on the CPU thread.
+class SlippiTimeSync
+{
+  public:
+	static const s32 FRAME_US = 16683;
+
+	// Offsets within this are left alone so both sides don't chase each other's noise
+	static const s32 DEADBAND_US = 1000;
+
+	// Offsets above this are corrected by skipping whole frames, like at the start of a game
+	static const s32 SKIP_THRESHOLD_US = 3 * FRAME_US;
+
+	typedef struct
+	{
+		// Real time to stretch the frame limiter by
+		u32 delayUs;
+		// Whole frames to halt for
+		int skipFrames;
+	} ssCorrection;
+
+	SlippiTimeSync();
+
+	void Reset();
+
+	// A pad for remoteFrame arrived at receiveTimeUs. localFrame is the latest frame we sent and
+	// localFrameTimeUs the time we sent it
+	void AddRemoteFrame(s32 remoteFrame, s32 localFrame, u64 localFrameTimeUs, u64 receiveTimeUs);
+	void AddRttSample(u64 sampleUs);
+
+	// Called on time sync frames. Returns how to slow down to get back in sync; the returned
+	// correction is assumed to be applied
+	ssCorrection Update(s32 frame);
+
+	// Current estimate of how far ahead of the opponent we are, in us
+	s32 GetOffsetUs() const;
+	u64 GetRttUs() const;
+
+  private:
+	double offsetUs = 0;
+	double offsetVariance = 0;
+	double noiseVariance = 0;
+	double rttUs = 0;
+	int sampleCount = 0;
+	int rttSampleCount = 0;
+
+	mutable std::mutex syncMutex;
+};
@@ -2,6 +2,8 @@
 // Licensed under GPLv2+
 // Refer to the license.txt file included.
 
+#include <algorithm>
+#include <atomic>
 #include <lzo/lzo1x.h>
 #include <map>
 #include <mutex>
@@ -48,12 +50,26 @@ static const u32 IN_LEN = 128 * 1024u;
 
 static const u32 OUT_LEN = IN_LEN + (IN_LEN / 16) + 64 + 3;
 
-static unsigned char __LZO_MMODEL out[OUT_LEN];
+// Compressed states are split into chunks which are compressed and decompressed in parallel.
+// The container follows StateHeader and starts with a magic where the old format had the
+// length of its first LZO block, which can never be this large, so old states still load.
+static const u32 CHUNKED_STATE_MAGIC = 0x53435344;  // "DSCS"
+static const u8 CHUNKED_STATE_VERSION = 1;
+// The chunks are LZO1X-1 compressed. The container records it so other codecs can be added
+static const u8 CHUNKED_STATE_CODEC_LZO1X_1 = 0;
+static const u32 CHUNK_SIZE = 1024 * 1024u;
 
-#define HEAP_ALLOC(var, size)                                                                      \
-  lzo_align_t __LZO_MMODEL var[((size) + (sizeof(lzo_align_t) - 1)) / sizeof(lzo_align_t)]
-
-static HEAP_ALLOC(wrkmem, LZO1X_1_MEM_COMPRESS);
+struct ChunkedStateHeader
+{
+	u32 magic;
+	u8 version;
+	u8 codec;
+	u16 reserved;
+	u32 chunk_size;
+	u32 chunk_count;
+	// Followed by u64 chunk_offsets[chunk_count + 1], relative to the end of the table.
+	// Chunk i is stored in [chunk_offsets[i], chunk_offsets[i + 1]).
+};
 
 static std::string g_last_filename;
 
@@ -70,6 +86,10 @@ static Common::Event g_compressAndDumpStateSyncEvent;
 
 static std::thread g_save_thread;
 
+// Size of the last snapshot taken with SaveToBuffer, and the game it belongs to
+static std::string g_snapshot_game_id;
+static size_t g_snapshot_size = 0;
+
 // Don't forget to increase this after doing changes on the savestate system
 static const u32 STATE_VERSION = 68;  // Last changed in PR 4638
 
@@ -103,6 +123,51 @@ void EnableCompression(bool compression)
 	g_use_compression = compression;
 }
 
+// Calls func(chunk, scratch) for every chunk, spread over all cores. Each thread gets its own
+// scratch buffer for LZO work memory.
+template <typename Func>
+static void ForEachChunk(u32 chunk_count, Func func)
+{
+	const u32 thread_count = std::min(std::max(1u, std::thread::hardware_concurrency()), chunk_count);
+	std::atomic<u32> next_chunk(0);
+
+	auto worker = [&]() {
+		std::vector<u8> scratch;
+		for (u32 i = next_chunk++; i < chunk_count; i = next_chunk++)
+			func(i, scratch);
+	};
+
+	std::vector<std::thread> threads;
+	for (u32 i = 1; i < thread_count; i++)
+		threads.emplace_back(worker);
+	worker();
+
+	for (std::thread& thread : threads)
+		thread.join();
+}
+
+static bool CompressChunk(const u8* src, u32 src_len, std::vector<u8>& dst,
+	std::vector<u8>& scratch)
+{
+	if (scratch.size() < LZO1X_1_MEM_COMPRESS)
+		scratch.resize(LZO1X_1_MEM_COMPRESS);
+
+	dst.resize(src_len + (src_len / 16) + 64 + 3);
+	lzo_uint dst_len = 0;
+	if (lzo1x_1_compress(src, src_len, dst.data(), &dst_len, scratch.data()) != LZO_E_OK)
+		return false;
+
+	dst.resize(dst_len);
+	return true;
+}
+
+static bool DecompressChunk(const u8* src, size_t src_len, u8* dst, u32 dst_len)
+{
+	lzo_uint new_len = dst_len;
+	return lzo1x_decompress_safe(src, (lzo_uint)src_len, dst, &new_len, nullptr) == LZO_E_OK &&
+		new_len == dst_len;
+}
+
 // Returns true if state version matches current Dolphin state version, false otherwise.
 static bool DoStateVersion(PointerWrap& p, std::string* version_created_by)
 {
@@ -200,20 +265,47 @@ void LoadFromBuffer(std::vector<u8>& buffer)
 	Core::PauseAndLock(false, wasUnpaused);
 }
 
+// Serializes the state into arena in a single pass and returns its size. If the state doesn't fit
+// in capacity the rest of the pass only measures, and the returned size is larger than capacity.
+// The last size is kept for each game so callers can size their buffer before the next snapshot.
+static size_t DoSnapshot(u8* arena, size_t capacity)
+{
+	// An empty arena may be null, which PointerWrap would take as unbounded
+	u8* ptr = arena;
+	PointerWrap p(&ptr, arena + capacity,
+		capacity ? PointerWrap::MODE_WRITE : PointerWrap::MODE_MEASURE);
+	DoState(p);
+	const size_t state_size = static_cast<size_t>(ptr - arena);
+
+	g_snapshot_game_id = SConfig::GetInstance().GetGameID();
+	g_snapshot_size = state_size;
+
+	return state_size;
+}
+
+static size_t GetSnapshotSize()
+{
+	if (g_snapshot_game_id != SConfig::GetInstance().GetGameID())
+		return 0;
+	return g_snapshot_size;
+}
+
 void SaveToBuffer(std::vector<u8>& buffer)
 {
 	bool wasUnpaused = Core::PauseAndLock(true);
 
-	u8* ptr = nullptr;
-	PointerWrap p(&ptr, PointerWrap::MODE_MEASURE);
+	// Size for the last snapshot of this game so the common case is a single write pass. Shrinking
+	// keeps the capacity, so a caller that reuses its buffer stops allocating once it's big enough.
+	buffer.resize(std::max(buffer.size(), GetSnapshotSize()));
 
-	DoState(p);
-	const size_t buffer_size = reinterpret_cast<size_t>(ptr);
-	buffer.resize(buffer_size);
+	size_t state_size = DoSnapshot(buffer.data(), buffer.size());
+	if (state_size > buffer.size())
+	{
+		buffer.resize(state_size);
+		state_size = DoSnapshot(buffer.data(), buffer.size());
+	}
 
-	ptr = &buffer[0];
-	p.SetMode(PointerWrap::MODE_WRITE);
-	DoState(p);
+	buffer.resize(state_size);
 
 	Core::PauseAndLock(false, wasUnpaused);
 }
@@ -344,33 +436,36 @@ static void CompressAndDumpState(CompressAndDumpState_args save_args)
 
 	if (header.size != 0)  // non-zero header size means the state is compressed
 	{
-		lzo_uint i = 0;
-		while (true)
+		ChunkedStateHeader chunked_header = {};
+		chunked_header.magic = CHUNKED_STATE_MAGIC;
+		chunked_header.version = CHUNKED_STATE_VERSION;
+		chunked_header.codec = CHUNKED_STATE_CODEC_LZO1X_1;
+		chunked_header.chunk_size = CHUNK_SIZE;
+		chunked_header.chunk_count = (u32)((buffer_size + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+		std::vector<std::vector<u8>> chunks(chunked_header.chunk_count);
+		std::atomic<bool> failed(false);
+		ForEachChunk(chunked_header.chunk_count, [&](u32 i, std::vector<u8>& scratch) {
+			const size_t offset = (size_t)i * CHUNK_SIZE;
+			const u32 len = (u32)std::min<size_t>(CHUNK_SIZE, buffer_size - offset);
+			if (!CompressChunk(buffer_data + offset, len, chunks[i], scratch))
+				failed = true;
+		});
+
+		if (failed)
 		{
-			lzo_uint32 cur_len = 0;
-			lzo_uint out_len = 0;
-
-			if ((i + IN_LEN) >= buffer_size)
-			{
-				cur_len = (lzo_uint32)(buffer_size - i);
-			}
-			else
-			{
-				cur_len = IN_LEN;
-			}
-
-			if (lzo1x_1_compress(buffer_data + i, cur_len, out, &out_len, wrkmem) != LZO_E_OK)
-				PanicAlertT("Internal LZO Error - compression failed");
-
-			// The size of the data to write is 'out_len'
-			f.WriteArray((lzo_uint32*)&out_len, 1);
-			f.WriteBytes(out, out_len);
+			PanicAlertT("Internal Error - state compression failed");
+			return;
+		}
 
-			if (cur_len != IN_LEN)
-				break;
+		std::vector<u64> chunk_offsets(chunked_header.chunk_count + 1);
+		for (u32 i = 0; i < chunked_header.chunk_count; i++)
+			chunk_offsets[i + 1] = chunk_offsets[i] + chunks[i].size();
 
-			i += cur_len;
-		}
+		f.WriteArray(&chunked_header, 1);
+		f.WriteArray(chunk_offsets.data(), chunk_offsets.size());
+		for (const std::vector<u8>& chunk : chunks)
+			f.WriteBytes(chunk.data(), chunk.size());
 	}
 	else  // uncompressed
 	{
@@ -482,27 +577,103 @@ static void LoadFileStateData(const std::string& filename, std::vector<u8>& ret_
 
 		buffer.resize(header.size);
 
-		lzo_uint i = 0;
-		while (true)
+		ChunkedStateHeader chunked_header = {};
+		if (!f.ReadArray(&chunked_header.magic, 1))
 		{
-			lzo_uint32 cur_len = 0;  // number of bytes to read
-			lzo_uint new_len = 0;    // number of bytes to write
+			PanicAlertT("Failed to read state");
+			return;
+		}
 
-			if (!f.ReadArray(&cur_len, 1))
-				break;
+		if (chunked_header.magic == CHUNKED_STATE_MAGIC)
+		{
+			f.Seek(-(s64)sizeof(chunked_header.magic), SEEK_CUR);
+			if (!f.ReadArray(&chunked_header, 1))
+			{
+				PanicAlertT("Failed to read state");
+				return;
+			}
+
+			const u64 expected_chunks = ((u64)header.size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+			if (chunked_header.version != CHUNKED_STATE_VERSION ||
+				chunked_header.codec != CHUNKED_STATE_CODEC_LZO1X_1 ||
+				chunked_header.chunk_size != CHUNK_SIZE || chunked_header.chunk_count != expected_chunks)
+			{
+				PanicAlertT("Unsupported savestate container (version %u)", chunked_header.version);
+				return;
+			}
 
-			f.ReadBytes(out, cur_len);
-			const int res = lzo1x_decompress(out, cur_len, &buffer[i], &new_len, nullptr);
-			if (res != LZO_E_OK)
+			// The offset table and the chunks it points to have to be within the file, so that a
+			// damaged state can't make us allocate more than the file holds
+			std::vector<u64> chunk_offsets;
+			std::vector<u8> compressed;
+			bool valid = ((u64)chunked_header.chunk_count + 1) * sizeof(u64) <= f.GetSize() - f.Tell();
+			if (valid)
+			{
+				chunk_offsets.resize(chunked_header.chunk_count + 1);
+				valid = f.ReadArray(chunk_offsets.data(), chunk_offsets.size());
+			}
+			for (u32 i = 0; valid && i < chunked_header.chunk_count; i++)
+				valid = chunk_offsets[i] <= chunk_offsets[i + 1];
+			if (valid)
+				valid = chunk_offsets.back() <= f.GetSize() - f.Tell();
+			if (valid)
 			{
-				// This doesn't seem to happen anymore.
-				PanicAlertT("Internal LZO Error - decompression failed (%d) (%li, %li) \n"
-					"Try loading the state again",
-					res, i, new_len);
+				compressed.resize((size_t)chunk_offsets.back());
+				valid = f.ReadBytes(compressed.data(), compressed.size());
+			}
+
+			if (!valid)
+			{
+				PanicAlertT("Failed to read state");
 				return;
 			}
 
-			i += new_len;
+			std::atomic<bool> failed(false);
+			ForEachChunk(chunked_header.chunk_count, [&](u32 i, std::vector<u8>&) {
+				const size_t offset = (size_t)i * CHUNK_SIZE;
+				const u32 len = (u32)std::min<size_t>(CHUNK_SIZE, buffer.size() - offset);
+				if (!DecompressChunk(&compressed[(size_t)chunk_offsets[i]],
+					(size_t)(chunk_offsets[i + 1] - chunk_offsets[i]), &buffer[offset], len))
+				{
+					failed = true;
+				}
+			});
+
+			if (failed)
+			{
+				PanicAlertT("Internal Error - decompression failed\n"
+					"Try loading the state again");
+				return;
+			}
+		}
+		else
+		{
+			// Serial LZO blocks from before the chunked container
+			f.Seek(-(s64)sizeof(chunked_header.magic), SEEK_CUR);
+
+			std::vector<u8> out(OUT_LEN);
+			lzo_uint i = 0;
+			while (true)
+			{
+				lzo_uint32 cur_len = 0;  // number of bytes to read
+				lzo_uint new_len = 0;    // number of bytes to write
+
+				if (!f.ReadArray(&cur_len, 1))
+					break;
+
+				f.ReadBytes(out.data(), cur_len);
+				const int res = lzo1x_decompress(out.data(), cur_len, &buffer[i], &new_len, nullptr);
+				if (res != LZO_E_OK)
+				{
+					// This doesn't seem to happen anymore.
+					PanicAlertT("Internal LZO Error - decompression failed (%d) (%li, %li) \n"
+						"Try loading the state again",
+						res, i, new_len);
+					return;
+				}
+
+				i += new_len;
+			}
 		}
 	}
 	else  // uncompressed
@@ -8,11 +8,13 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cinttypes>
 #include <cstdio>
 #include <cstring>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 #include <zlib.h>
@@ -23,6 +25,7 @@
 #include "Common/Logging/Log.h"
 #include "Common/MsgHandler.h"
 #include "Common/StringUtil.h"
+#include "Common/Thread.h"
 #include "DiscIO/Blob.h"
 #include "DiscIO/CompressedBlob.h"
 #include "DiscIO/DiscScrubber.h"
@@ -55,6 +58,7 @@ CompressedBlobReader::CompressedBlobReader(File::IOFile file, const std::string&
   // I still add some safety margin.
   const u32 zlib_buffer_size = m_header.block_size + 64;
   m_zlib_buffer.resize(zlib_buffer_size);
+  m_read_ahead_zlib_buffer.resize(zlib_buffer_size);
 }
 
 std::unique_ptr<CompressedBlobReader> CompressedBlobReader::Create(File::IOFile file,
@@ -69,6 +73,15 @@ std::unique_ptr<CompressedBlobReader> CompressedBlobReader::Create(File::IOFile
 
 CompressedBlobReader::~CompressedBlobReader()
 {
+  if (m_read_ahead_thread.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_read_ahead_lock);
+      m_read_ahead_exit = true;
+    }
+    m_read_ahead_wake.notify_one();
+    m_read_ahead_thread.join();
+  }
 }
 
 // IMPORTANT: Calling this function invalidates all earlier pointers gotten from this function.
@@ -85,6 +98,87 @@ u64 CompressedBlobReader::GetBlockCompressedSize(u64 block_num) const
 }
 
 bool CompressedBlobReader::GetBlock(u64 block_num, u8* out_ptr)
+{
+  {
+    std::unique_lock<std::mutex> lk(m_read_ahead_lock);
+    // A block the read-ahead thread is decoding right now is waited for, not decoded twice
+    m_read_ahead_done.wait(lk, [&] { return m_read_ahead_busy != block_num; });
+
+    if (block_num == m_last_block + 1)
+      m_sequential_reads++;
+    else
+      m_sequential_reads = 0;
+    m_last_block = block_num;
+
+    // Blocks behind the reader won't be asked for again
+    m_read_ahead_blocks.erase(m_read_ahead_blocks.begin(),
+                              m_read_ahead_blocks.lower_bound(block_num));
+
+    auto it = m_read_ahead_blocks.find(block_num);
+    bool hit = it != m_read_ahead_blocks.end();
+    if (hit)
+    {
+      std::copy(it->second.begin(), it->second.end(), out_ptr);
+      m_read_ahead_blocks.erase(it);
+    }
+
+    if (hit || m_sequential_reads >= 2)
+    {
+      m_read_ahead_next = std::max(m_read_ahead_next, block_num + 1);
+      m_read_ahead_end = std::min<u64>(block_num + 1 + READ_AHEAD_BLOCKS, m_header.num_blocks);
+      if (!m_read_ahead_thread.joinable())
+        m_read_ahead_thread = std::thread(&CompressedBlobReader::ReadAheadThread, this);
+      m_read_ahead_wake.notify_one();
+    }
+    else
+    {
+      // Random access, stop reading ahead
+      m_read_ahead_next = m_read_ahead_end = 0;
+      m_read_ahead_blocks.clear();
+    }
+
+    if (hit)
+      return true;
+  }
+
+  return DecodeBlock(block_num, out_ptr, m_zlib_buffer, true);
+}
+
+void CompressedBlobReader::ReadAheadThread()
+{
+  Common::SetCurrentThreadName("GCZ read-ahead");
+
+  std::vector<u8> block(m_header.block_size);
+  std::unique_lock<std::mutex> lk(m_read_ahead_lock);
+  while (true)
+  {
+    m_read_ahead_wake.wait(
+        lk, [&] { return m_read_ahead_exit || m_read_ahead_next < m_read_ahead_end; });
+    if (m_read_ahead_exit)
+      return;
+
+    u64 block_num = m_read_ahead_next++;
+    if (m_read_ahead_blocks.count(block_num))
+      continue;
+
+    m_read_ahead_busy = block_num;
+    lk.unlock();
+    bool success = DecodeBlock(block_num, block.data(), m_read_ahead_zlib_buffer, false);
+    lk.lock();
+    m_read_ahead_busy = NO_BLOCK;
+
+    // The reader may have moved past it in the meantime
+    if (success && (m_last_block == NO_BLOCK || block_num > m_last_block))
+    {
+      m_read_ahead_blocks[block_num].swap(block);
+      block.resize(m_header.block_size);
+    }
+    m_read_ahead_done.notify_all();
+  }
+}
+
+bool CompressedBlobReader::DecodeBlock(u64 block_num, u8* out_ptr, std::vector<u8>& zlib_buffer,
+                                       bool report_errors)
 {
   bool uncompressed = false;
   u32 comp_block_size = (u32)GetBlockCompressedSize(block_num);
@@ -93,40 +187,59 @@ bool CompressedBlobReader::GetBlock(u64 block_num, u8* out_ptr)
   if (offset & (1ULL << 63))
   {
     if (comp_block_size != m_header.block_size)
+    {
+      if (!report_errors)
+        return false;
       PanicAlert("Uncompressed block with wrong size");
+    }
     uncompressed = true;
     offset &= ~(1ULL << 63);
   }
 
+  if (comp_block_size > zlib_buffer.size())
+  {
+    if (report_errors)
+      PanicAlert("We have a problem");
+    return false;
+  }
+
   // clear unused part of zlib buffer. maybe this can be deleted when it works fully.
-  memset(&m_zlib_buffer[comp_block_size], 0, m_zlib_buffer.size() - comp_block_size);
+  memset(&zlib_buffer[comp_block_size], 0, zlib_buffer.size() - comp_block_size);
 
-  m_file.Seek(offset, SEEK_SET);
-  if (!m_file.ReadBytes(m_zlib_buffer.data(), comp_block_size))
   {
-    PanicAlertT("The disc image \"%s\" is truncated, some of the data is missing.",
-                m_file_name.c_str());
-    m_file.Clear();
-    return false;
+    std::lock_guard<std::mutex> lk(m_file_lock);
+    m_file.Seek(offset, SEEK_SET);
+    if (!m_file.ReadBytes(zlib_buffer.data(), comp_block_size))
+    {
+      m_file.Clear();
+      if (report_errors)
+        PanicAlertT("The disc image \"%s\" is truncated, some of the data is missing.",
+                    m_file_name.c_str());
+      return false;
+    }
   }
 
   // First, check hash.
-  u32 block_hash = HashAdler32(m_zlib_buffer.data(), comp_block_size);
+  u32 block_hash = HashAdler32(zlib_buffer.data(), comp_block_size);
   if (block_hash != m_hashes[block_num])
+  {
+    if (!report_errors)
+      return false;
     PanicAlertT("The disc image \"%s\" is corrupt.\n"
                 "Hash of block %" PRIu64 " is %08x instead of %08x.",
                 m_file_name.c_str(), block_num, block_hash, m_hashes[block_num]);
+  }
 
   if (uncompressed)
   {
-    std::copy(m_zlib_buffer.begin(), m_zlib_buffer.begin() + comp_block_size, out_ptr);
+    std::copy(zlib_buffer.begin(), zlib_buffer.begin() + comp_block_size, out_ptr);
   }
   else
   {
     z_stream z = {};
-    z.next_in = m_zlib_buffer.data();
+    z.next_in = zlib_buffer.data();
     z.avail_in = comp_block_size;
-    if (z.avail_in > m_header.block_size)
+    if (z.avail_in > m_header.block_size && report_errors)
     {
       PanicAlert("We have a problem");
     }
@@ -135,22 +248,131 @@ bool CompressedBlobReader::GetBlock(u64 block_num, u8* out_ptr)
     inflateInit(&z);
     int status = inflate(&z, Z_FULL_FLUSH);
     u32 uncomp_size = m_header.block_size - z.avail_out;
+    inflateEnd(&z);
     if (status != Z_STREAM_END)
     {
       // this seem to fire wrongly from time to time
       // to be sure, don't use compressed isos :P
+      if (!report_errors)
+        return false;
       PanicAlert("Failure reading block %" PRIu64 " - out of data and not at end.", block_num);
     }
-    inflateEnd(&z);
     if (uncomp_size != m_header.block_size)
     {
-      PanicAlert("Wrong block size");
+      if (report_errors)
+        PanicAlert("Wrong block size");
       return false;
     }
   }
   return true;
 }
 
+namespace
+{
+struct CompressionJob
+{
+  std::vector<u8> in_buf;
+  std::vector<u8> out_buf;
+  int compressed_size = 0;
+  // Blocks that don't compress well are stored as they are
+  bool stored = false;
+};
+
+// Compresses batches of blocks on worker threads, each with its own zlib stream
+class ParallelCompressor
+{
+public:
+  ParallelCompressor(u32 num_threads, int block_size) : m_block_size(block_size)
+  {
+    for (u32 i = 0; i < num_threads; i++)
+      m_threads.emplace_back(&ParallelCompressor::WorkerThread, this);
+  }
+
+  ~ParallelCompressor()
+  {
+    {
+      std::lock_guard<std::mutex> lk(m_lock);
+      m_exit = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads)
+      thread.join();
+  }
+
+  // Returns once every job of the batch is done
+  bool Run(CompressionJob* jobs, u32 count)
+  {
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_jobs = jobs;
+    m_count = count;
+    m_next = 0;
+    m_done = 0;
+    m_wake.notify_all();
+    m_finished.wait(lk, [&] { return m_done == m_count; });
+    m_count = 0;
+    return !m_failed;
+  }
+
+private:
+  void WorkerThread()
+  {
+    Common::SetCurrentThreadName("GCZ compression");
+
+    z_stream z = {};
+    bool initialized = deflateInit(&z, 9) == Z_OK;
+
+    std::unique_lock<std::mutex> lk(m_lock);
+    while (true)
+    {
+      m_wake.wait(lk, [&] { return m_exit || m_next < m_count; });
+      if (m_exit)
+        break;
+
+      CompressionJob& job = m_jobs[m_next++];
+      lk.unlock();
+      bool success = initialized && Compress(&z, job);
+      lk.lock();
+
+      if (!success)
+        m_failed = true;
+      if (++m_done == m_count)
+        m_finished.notify_one();
+    }
+
+    if (initialized)
+      deflateEnd(&z);
+  }
+
+  bool Compress(z_stream* z, CompressionJob& job)
+  {
+    if (deflateReset(z) != Z_OK)
+      return false;
+
+    z->next_in = job.in_buf.data();
+    z->avail_in = m_block_size;
+    z->next_out = job.out_buf.data();
+    z->avail_out = m_block_size;
+
+    int status = deflate(z, Z_FINISH);
+    job.compressed_size = m_block_size - z->avail_out;
+    job.stored = (status != Z_STREAM_END) || (z->avail_out < 10);
+    return true;
+  }
+
+  const int m_block_size;
+  std::vector<std::thread> m_threads;
+  std::mutex m_lock;
+  std::condition_variable m_wake;
+  std::condition_variable m_finished;
+  CompressionJob* m_jobs = nullptr;
+  u32 m_count = 0;
+  u32 m_next = 0;
+  u32 m_done = 0;
+  bool m_failed = false;
+  bool m_exit = false;
+};
+}
+
 bool CompressFileToBlob(const std::string& infile_path, const std::string& outfile_path,
                         u32 sub_type, int block_size, CompressCB callback, void* arg)
 {
@@ -192,10 +414,6 @@ bool CompressFileToBlob(const std::string& infile_path, const std::string& outfi
     scrubbing = true;
   }
 
-  z_stream z = {};
-  if (deflateInit(&z, 9) != Z_OK)
-    return false;
-
   callback(GetStringT("Files opened, ready to compress."), 0, arg);
 
   CompressedBlobHeader header;
@@ -209,8 +427,6 @@ bool CompressFileToBlob(const std::string& infile_path, const std::string& outfi
 
   std::vector<u64> offsets(header.num_blocks);
   std::vector<u32> hashes(header.num_blocks);
-  std::vector<u8> out_buf(block_size);
-  std::vector<u8> in_buf(block_size);
 
   // seek past the header (we will write it at the end)
   outfile.Seek(sizeof(CompressedBlobHeader), SEEK_CUR);
@@ -224,9 +440,21 @@ bool CompressFileToBlob(const std::string& infile_path, const std::string& outfi
   int progress_monitor = std::max<int>(1, header.num_blocks / 1000);
   bool success = true;
 
-  for (u32 i = 0; i < header.num_blocks; i++)
+  // Blocks are read and written in order here, and compressed in batches on all cores
+  const u32 num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<CompressionJob> batch(num_threads * 4);
+  for (CompressionJob& job : batch)
   {
-    if (i % progress_monitor == 0)
+    job.in_buf.resize(block_size);
+    job.out_buf.resize(block_size);
+  }
+  ParallelCompressor compressor(num_threads, block_size);
+
+  for (u32 first = 0; first < header.num_blocks; first += (u32)batch.size())
+  {
+    const u32 count = std::min<u32>((u32)batch.size(), header.num_blocks - first);
+
+    if (first / progress_monitor != (first + count) / progress_monitor || first == 0)
     {
       const u64 inpos = infile.Tell();
       int ratio = 0;
@@ -234,9 +462,9 @@ bool CompressFileToBlob(const std::string& infile_path, const std::string& outfi
         ratio = (int)(100 * position / inpos);
 
       std::string temp =
-          StringFromFormat(GetStringT("%i of %i blocks. Compression ratio %i%%").c_str(), i,
+          StringFromFormat(GetStringT("%i of %i blocks. Compression ratio %i%%").c_str(), first,
                            header.num_blocks, ratio);
-      bool was_cancelled = !callback(temp, (float)i / (float)header.num_blocks, arg);
+      bool was_cancelled = !callback(temp, (float)first / (float)header.num_blocks, arg);
       if (was_cancelled)
       {
         success = false;
@@ -244,64 +472,64 @@ bool CompressFileToBlob(const std::string& infile_path, const std::string& outfi
       }
     }
 
-    offsets[i] = position;
-
-    size_t read_bytes;
-    if (scrubbing)
-      read_bytes = disc_scrubber.GetNextBlock(infile, in_buf.data());
-    else
-      infile.ReadArray(in_buf.data(), header.block_size, &read_bytes);
-    if (read_bytes < header.block_size)
-      std::fill(in_buf.begin() + read_bytes, in_buf.begin() + header.block_size, 0);
-
-    int retval = deflateReset(&z);
-    z.next_in = in_buf.data();
-    z.avail_in = header.block_size;
-    z.next_out = out_buf.data();
-    z.avail_out = block_size;
+    for (u32 i = 0; i < count; i++)
+    {
+      std::vector<u8>& in_buf = batch[i].in_buf;
+      size_t read_bytes;
+      if (scrubbing)
+        read_bytes = disc_scrubber.GetNextBlock(infile, in_buf.data());
+      else
+        infile.ReadArray(in_buf.data(), header.block_size, &read_bytes);
+      if (read_bytes < header.block_size)
+        std::fill(in_buf.begin() + read_bytes, in_buf.begin() + header.block_size, 0);
+    }
 
-    if (retval != Z_OK)
+    if (!compressor.Run(batch.data(), count))
     {
       ERROR_LOG(DISCIO, "Deflate failed");
       success = false;
       break;
     }
 
-    int status = deflate(&z, Z_FINISH);
-    int comp_size = block_size - z.avail_out;
-
-    u8* write_buf;
-    int write_size;
-    if ((status != Z_STREAM_END) || (z.avail_out < 10))
-    {
-      // PanicAlert("%i %i Store %i", i*block_size, position, comp_size);
-      // let's store uncompressed
-      write_buf = in_buf.data();
-      offsets[i] |= 0x8000000000000000ULL;
-      write_size = block_size;
-      num_stored++;
-    }
-    else
+    for (u32 i = 0; i < count; i++)
     {
-      // let's store compressed
-      // PanicAlert("Comp %i to %i", block_size, comp_size);
-      write_buf = out_buf.data();
-      write_size = comp_size;
-      num_compressed++;
-    }
+      const CompressionJob& job = batch[i];
+      offsets[first + i] = position;
 
-    if (!outfile.WriteBytes(write_buf, write_size))
-    {
-      PanicAlertT("Failed to write the output file \"%s\".\n"
-                  "Check that you have enough space available on the target drive.",
-                  outfile_path.c_str());
-      success = false;
-      break;
-    }
+      const u8* write_buf;
+      int write_size;
+      if (job.stored)
+      {
+        // let's store uncompressed
+        write_buf = job.in_buf.data();
+        offsets[first + i] |= 0x8000000000000000ULL;
+        write_size = block_size;
+        num_stored++;
+      }
+      else
+      {
+        // let's store compressed
+        write_buf = job.out_buf.data();
+        write_size = job.compressed_size;
+        num_compressed++;
+      }
+
+      if (!outfile.WriteBytes(write_buf, write_size))
+      {
+        PanicAlertT("Failed to write the output file \"%s\".\n"
+                    "Check that you have enough space available on the target drive.",
+                    outfile_path.c_str());
+        success = false;
+        break;
+      }
 
-    position += write_size;
+      position += write_size;
 
-    hashes[i] = HashAdler32(write_buf, write_size);
+      hashes[first + i] = HashAdler32(write_buf, write_size);
+    }
+
+    if (!success)
+      break;
   }
 
   header.compressed_data_size = position;
@@ -321,9 +549,6 @@ bool CompressFileToBlob(const std::string& infile_path, const std::string& outfi
     outfile.WriteArray(hashes.data(), header.num_blocks);
   }
 
-  // Cleanup
-  deflateEnd(&z);
-
   if (success)
   {
     callback(GetStringT("Done compressing disc image."), 1.0f, arg);
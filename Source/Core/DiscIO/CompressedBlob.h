@@ -13,8 +13,12 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -57,6 +61,11 @@ public:
 private:
   CompressedBlobReader(File::IOFile file, const std::string& filename);
 
+  // Reads, checks and decompresses one block. The read-ahead thread doesn't report errors,
+  // blocks it fails on are decoded again by GetBlock, which does.
+  bool DecodeBlock(u64 block_num, u8* out_ptr, std::vector<u8>& zlib_buffer, bool report_errors);
+  void ReadAheadThread();
+
   CompressedBlobHeader m_header;
   std::vector<u64> m_block_pointers;
   std::vector<u32> m_hashes;
@@ -65,6 +74,25 @@ private:
   u64 m_file_size;
   std::vector<u8> m_zlib_buffer;
   std::string m_file_name;
+  std::mutex m_file_lock;
+
+  // Sequential reads, like streamed audio and movies, get the next blocks decompressed
+  // ahead of time on a helper thread
+  static constexpr u32 READ_AHEAD_BLOCKS = 8;
+  static constexpr u64 NO_BLOCK = ~0ULL;
+  std::thread m_read_ahead_thread;
+  std::mutex m_read_ahead_lock;
+  std::condition_variable m_read_ahead_wake;
+  std::condition_variable m_read_ahead_done;
+  bool m_read_ahead_exit = false;
+  // Blocks [next, end) are still to be decoded ahead
+  u64 m_read_ahead_next = 0;
+  u64 m_read_ahead_end = 0;
+  u64 m_read_ahead_busy = NO_BLOCK;
+  std::map<u64, std::vector<u8>> m_read_ahead_blocks;
+  std::vector<u8> m_read_ahead_zlib_buffer;
+  u64 m_last_block = NO_BLOCK;
+  u32 m_sequential_reads = 0;
 };
 
 }  // namespace
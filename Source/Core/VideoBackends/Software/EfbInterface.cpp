@@ -18,6 +18,7 @@ static u8 efb[EFB_WIDTH*EFB_HEIGHT * 6];
 namespace EfbInterface
 {
 u32 perf_values[PQ_NUM_MEMBERS];
+u32 perf_quad_pixels[PQ_NUM_MEMBERS];
 
 static inline u32 GetColorOffset(u16 x, u16 y)
 {
@@ -29,6 +30,20 @@ static inline u32 GetDepthOffset(u16 x, u16 y)
 	return (x + y * EFB_WIDTH) * 3 + DEPTH_BUFFER_START;
 }
 
+// Pixels are 3 bytes and only those are touched. A wider access would also read and write back
+// the first byte of the next pixel, which may be in a tile another thread is shading.
+static inline u32 ReadPixel(u32 offset)
+{
+	return efb[offset] | (efb[offset + 1] << 8) | (efb[offset + 2] << 16);
+}
+
+static inline void WritePixel(u32 offset, u32 val)
+{
+	efb[offset] = (u8)val;
+	efb[offset + 1] = (u8)(val >> 8);
+	efb[offset + 2] = (u8)(val >> 16);
+}
+
 static void SetPixelAlphaOnly(u32 offset, u8 a)
 {
 	switch (bpmem.zcontrol.pixel_format)
@@ -41,10 +56,9 @@ static void SetPixelAlphaOnly(u32 offset, u8 a)
 	case PEControl::RGBA6_Z24:
 	{
 		u32 a32 = a;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xffffffc0;
+		u32 val = ReadPixel(offset) & 0xffffc0;
 		val |= (a32 >> 2) & 0x0000003f;
-		*dst = val;
+		WritePixel(offset, val);
 	}
 	break;
 	default:
@@ -60,31 +74,24 @@ static void SetPixelColorOnly(u32 offset, u8 *rgb)
 	case PEControl::Z24:
 	{
 		u32 src = *(u32*)rgb;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= src >> 8;
-		*dst = val;
+		WritePixel(offset, src >> 8);
 	}
 	break;
 	case PEControl::RGBA6_Z24:
 	{
 		u32 src = *(u32*)rgb;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff00003f;
+		u32 val = ReadPixel(offset) & 0x0000003f;
 		val |= (src >> 4) & 0x00000fc0; // blue
 		val |= (src >> 6) & 0x0003f000; // green
 		val |= (src >> 8) & 0x00fc0000; // red
-		*dst = val;
+		WritePixel(offset, val);
 	}
 	break;
 	case PEControl::RGB565_Z16:
 	{
 		INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
 		u32 src = *(u32*)rgb;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= src >> 8;
-		*dst = val;
+		WritePixel(offset, src >> 8);
 	}
 	break;
 	default:
@@ -100,32 +107,24 @@ static void SetPixelAlphaColor(u32 offset, u8 *color)
 	case PEControl::Z24:
 	{
 		u32 src = *(u32*)color;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= src >> 8;
-		*dst = val;
+		WritePixel(offset, src >> 8);
 	}
 	break;
 	case PEControl::RGBA6_Z24:
 	{
 		u32 src = *(u32*)color;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= (src >> 2) & 0x0000003f; // alpha
+		u32 val = (src >> 2) & 0x0000003f; // alpha
 		val |= (src >> 4) & 0x00000fc0; // blue
 		val |= (src >> 6) & 0x0003f000; // green
 		val |= (src >> 8) & 0x00fc0000; // red
-		*dst = val;
+		WritePixel(offset, val);
 	}
 	break;
 	case PEControl::RGB565_Z16:
 	{
 		INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
 		u32 src = *(u32*)color;
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= src >> 8;
-		*dst = val;
+		WritePixel(offset, src >> 8);
 	}
 	break;
 	default:
@@ -140,15 +139,15 @@ static void GetPixelColor(u32 offset, u8 *color)
 	case PEControl::RGB8_Z24:
 	case PEControl::Z24:
 	{
-		u32 src = *(u32*)&efb[offset];
+		u32 src = ReadPixel(offset);
 		u32 *dst = (u32*)color;
-		u32 val = 0xff | ((src & 0x00ffffff) << 8);
+		u32 val = 0xff | (src << 8);
 		*dst = val;
 	}
 	break;
 	case PEControl::RGBA6_Z24:
 	{
-		u32 src = *(u32*)&efb[offset];
+		u32 src = ReadPixel(offset);
 		color[ALP_C] = Convert6To8(src & 0x3f);
 		color[BLU_C] = Convert6To8((src >> 6) & 0x3f);
 		color[GRN_C] = Convert6To8((src >> 12) & 0x3f);
@@ -158,9 +157,9 @@ static void GetPixelColor(u32 offset, u8 *color)
 	case PEControl::RGB565_Z16:
 	{
 		INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
-		u32 src = *(u32*)&efb[offset];
+		u32 src = ReadPixel(offset);
 		u32 *dst = (u32*)color;
-		u32 val = 0xff | ((src & 0x00ffffff) << 8);
+		u32 val = 0xff | (src << 8);
 		*dst = val;
 	}
 	break;
@@ -177,19 +176,13 @@ static void SetPixelDepth(u32 offset, u32 depth)
 	case PEControl::RGBA6_Z24:
 	case PEControl::Z24:
 	{
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= depth & 0x00ffffff;
-		*dst = val;
+		WritePixel(offset, depth);
 	}
 	break;
 	case PEControl::RGB565_Z16:
 	{
 		INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
-		u32 *dst = (u32*)&efb[offset];
-		u32 val = *dst & 0xff000000;
-		val |= depth & 0x00ffffff;
-		*dst = val;
+		WritePixel(offset, depth);
 	}
 	break;
 	default:
@@ -207,13 +200,13 @@ static u32 GetPixelDepth(u32 offset)
 	case PEControl::RGBA6_Z24:
 	case PEControl::Z24:
 	{
-		depth = (*(u32*)&efb[offset]) & 0x00ffffff;
+		depth = ReadPixel(offset);
 	}
 	break;
 	case PEControl::RGB565_Z16:
 	{
 		INFO_LOG(VIDEO, "RGB565_Z16 is not supported correctly yet");
-		depth = (*(u32*)&efb[offset]) & 0x00ffffff;
+		depth = ReadPixel(offset);
 	}
 	break;
 	default:
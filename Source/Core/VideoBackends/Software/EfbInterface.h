@@ -60,17 +60,24 @@ u8* GetPixelPointer(u16 x, u16 y, bool depth);
 void CopyToXFB(yuv422_packed* xfb_in_ram, u32 fbWidth, u32 fbHeight, const EFBRectangle& sourceRc, float Gamma);
 void BypassXFB(u8* texture, u32 fbWidth, u32 fbHeight, const EFBRectangle& sourceRc, float Gamma);
 
+// The rasterizer shades the EFB in tiles of TILE_SIZE x TILE_SIZE pixels on several threads.
+// A tile is owned by the thread shading it, which is the only one reading or writing its pixels
+// until the draw call is done, so blending and depth tests don't need any locking. For this to
+// hold, the EFB accessors only ever touch the 3 bytes of the pixel they are given.
+const int TILE_SIZE = 32;
+const int TILES_WIDE = (EFB_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
+const int TILES_HIGH = (EFB_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
+
 extern u32 perf_values[PQ_NUM_MEMBERS];
-inline void IncPerfCounterQuadCount(PerfQueryType type)
+extern u32 perf_quad_pixels[PQ_NUM_MEMBERS];
+inline void AddPerfCounterPixels(PerfQueryType type, u32 count)
 {
 	// NOTE: hardware doesn't process individual pixels but quads instead.
 	// Current software renderer architecture works on pixels though, so
 	// we have this "quad" hack here to only increment the registers on
 	// every fourth rendered pixel
-	static u32 quad[PQ_NUM_MEMBERS];
-	if (++quad[type] != 3)
-		return;
-	quad[type] = 0;
-	++perf_values[type];
+	perf_quad_pixels[type] += count;
+	perf_values[type] += perf_quad_pixels[type] / 3;
+	perf_quad_pixels[type] %= 3;
 }
 }
@@ -4,8 +4,11 @@
 
 #include <algorithm>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
 #include "Common/CommonTypes.h"
+#include "Common/ThreadPool.h"
 #include "VideoBackends/Software/EfbInterface.h"
 #include "VideoBackends/Software/NativeVertexFormat.h"
 #include "VideoBackends/Software/Rasterizer.h"
@@ -20,27 +23,102 @@ namespace Rasterizer
 {
 static constexpr int BLOCK_SIZE = 2;
 
-static Slope ZSlope;
-static Slope WSlope;
-static Slope ColorSlopes[2][4];
-static Slope TexSlopes[8][3];
+static_assert(BLOCK_SIZE * BLOCK_SIZE <= Tev::SPAN_SIZE, "A block must fit in a tev span");
+
+static_assert(EfbInterface::TILE_SIZE % BLOCK_SIZE == 0, "Blocks must not cross tiles");
+
+// Everything needed to draw a triangle, worked out once when it is set up
+struct TriangleSetup
+{
+	Slope ZSlope;
+	Slope WSlope;
+	Slope ColorSlopes[2][4];
+	Slope TexSlopes[8][3];
+
+	s32 vertex0X;
+	s32 vertex0Y;
+	float vertexOffsetX;
+	float vertexOffsetY;
+
+	// 28.4 fixed-point deltas and half-edge constants
+	s32 DX12, DX23, DX31;
+	s32 DY12, DY23, DY31;
+	s32 C1, C2, C3;
+
+	// Bounding rectangle, clipped to the scissor
+	s32 minx, maxx, miny, maxy;
+};
+
+// A thread's state for drawing pixels
+struct RasterContext
+{
+	Tev tev;
+	RasterBlock rasterBlock;
+	u32 rasterizedPixels;
+};
 
-static s32 vertex0X;
-static s32 vertex0Y;
-static float vertexOffsetX;
-static float vertexOffsetY;
+static Slope ZSlope;
 
 static s32 scissorLeft = 0;
 static s32 scissorTop = 0;
 static s32 scissorRight = 0;
 static s32 scissorBottom = 0;
 
-static Tev tev;
-static RasterBlock rasterBlock;
+static s16 tevRegs[4][4];
+static s16 tevKonsts[4][4];
+
+// Triangles of the current draw call, drawn by Flush. Each tile has the indices of the
+// triangles touching it in the order they were submitted.
+static std::vector<TriangleSetup> triangles;
+static std::vector<u32> tileTriangles[EfbInterface::TILES_WIDE * EfbInterface::TILES_HIGH];
+static std::vector<int> usedTiles;
+
+// Used for the bounding box, which is drawn right away on this thread
+static RasterContext bboxContext;
+
+static std::mutex countersLock;
+
+static void InitContext(RasterContext& context)
+{
+	context.tev.Init();
+	for (int reg = 0; reg < 4; reg++)
+	{
+		for (int comp = 0; comp < 4; comp++)
+		{
+			context.tev.SetRegColor(reg, comp, false, tevRegs[reg][comp]);
+			context.tev.SetRegColor(reg, comp, true, tevKonsts[reg][comp]);
+		}
+	}
+	context.rasterizedPixels = 0;
+}
+
+// Adds the context's pixel counts and bounding box to the global ones
+static void FlushCounters(RasterContext& context)
+{
+	std::lock_guard<std::mutex> lk(countersLock);
+	Tev& tev = context.tev;
+
+	ADDSTAT(stats.thisFrame.rasterizedPixels, context.rasterizedPixels);
+	ADDSTAT(stats.thisFrame.tevPixelsIn, tev.PixelsIn);
+	ADDSTAT(stats.thisFrame.tevPixelsOut, tev.PixelsOut);
+	for (int type = 0; type < PQ_NUM_MEMBERS; type++)
+	{
+		if (tev.PerfPixels[type])
+			EfbInterface::AddPerfCounterPixels((PerfQueryType)type, tev.PerfPixels[type]);
+	}
+
+	BoundingBox::coords[BoundingBox::LEFT] = std::min(tev.BoundingBoxCoords[BoundingBox::LEFT], BoundingBox::coords[BoundingBox::LEFT]);
+	BoundingBox::coords[BoundingBox::RIGHT] = std::max(tev.BoundingBoxCoords[BoundingBox::RIGHT], BoundingBox::coords[BoundingBox::RIGHT]);
+	BoundingBox::coords[BoundingBox::TOP] = std::min(tev.BoundingBoxCoords[BoundingBox::TOP], BoundingBox::coords[BoundingBox::TOP]);
+	BoundingBox::coords[BoundingBox::BOTTOM] = std::max(tev.BoundingBoxCoords[BoundingBox::BOTTOM], BoundingBox::coords[BoundingBox::BOTTOM]);
+
+	context.rasterizedPixels = 0;
+	tev.ResetCounters();
+}
 
 void Init()
 {
-	tev.Init();
+	InitContext(bboxContext);
 
 	// Set initial z reference plane in the unlikely case that zfreeze is enabled when drawing the first primitive.
 	// TODO: This is just a guess!
@@ -94,48 +172,61 @@ void SetScissor()
 
 void SetTevReg(int reg, int comp, bool konst, s16 color)
 {
-	tev.SetRegColor(reg, comp, konst, color);
+	if (konst)
+		tevKonsts[reg][comp] = color;
+	else
+		tevRegs[reg][comp] = color;
+
+	bboxContext.tev.SetRegColor(reg, comp, konst, color);
 }
 
-static void Draw(s32 x, s32 y, s32 xi, s32 yi)
+// Interpolates a pixel's inputs for the tev, returns false when early depth testing rejects it
+static bool SetupPixel(RasterContext& context, const TriangleSetup& tri, s32 x, s32 y, s32 xi, s32 yi,
+                       s32* position, u8 (*color)[4], Tev::TextureCoordinateType* uv)
 {
-	INCSTAT(stats.thisFrame.rasterizedPixels);
+	Tev& tev = context.tev;
+	const RasterBlockPixel& pixel = context.rasterBlock.Pixel[xi][yi];
+
+	context.rasterizedPixels++;
 
-	float dx = vertexOffsetX + (float)(x - vertex0X);
-	float dy = vertexOffsetY + (float)(y - vertex0Y);
+	float dx = tri.vertexOffsetX + (float)(x - tri.vertex0X);
+	float dy = tri.vertexOffsetY + (float)(y - tri.vertex0Y);
 
-	s32 z = (s32)MathUtil::Clamp<float>(ZSlope.GetValue(dx, dy), 0.0f, 16777215.0f);
+	s32 z = (s32)MathUtil::Clamp<float>(tri.ZSlope.GetValue(dx, dy), 0.0f, 16777215.0f);
 
 	if (!BoundingBox::active && bpmem.UseEarlyDepthTest() && g_ActiveConfig.bZComploc)
 	{
 		// TODO: Test if perf regs are incremented even if test is disabled
-		EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_INPUT_ZCOMPLOC);
+		tev.PerfPixels[PQ_ZCOMP_INPUT_ZCOMPLOC]++;
 		if (bpmem.zmode.testenable)
 		{
 			// early z
 			if (!EfbInterface::ZCompare(x, y, z))
-				return;
+				return false;
 		}
-		EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_OUTPUT_ZCOMPLOC);
+		tev.PerfPixels[PQ_ZCOMP_OUTPUT_ZCOMPLOC]++;
 	}
 
-	RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
+	position[0] = x;
+	position[1] = y;
+	position[2] = z;
 
-	tev.Position[0] = x;
-	tev.Position[1] = y;
-	tev.Position[2] = z;
+	// Channels and tex coords the draw call doesn't have read as zero, rather than as whatever
+	// the previous pixel shaded by this Tev left there
+	memset(color, 0, sizeof(u8) * 2 * 4);
+	memset(uv, 0, sizeof(Tev::TextureCoordinateType) * 8);
 
 	//  colors
 	for (unsigned int i = 0; i < bpmem.genMode.numcolchans.Value(); i++)
 	{
 		for (int comp = 0; comp < 4; comp++)
 		{
-			u16 color = (u16)ColorSlopes[i][comp].GetValue(dx, dy);
+			u16 colorValue = (u16)tri.ColorSlopes[i][comp].GetValue(dx, dy);
 
 			// clamp color value to 0
-			u16 mask = ~(color >> 8);
+			u16 mask = ~(colorValue >> 8);
 
-			tev.Color[i][comp] = color & mask;
+			color[i][comp] = colorValue & mask;
 		}
 	}
 
@@ -143,10 +234,19 @@ static void Draw(s32 x, s32 y, s32 xi, s32 yi)
 	for (unsigned int i = 0; i < bpmem.genMode.numtexgens.Value(); i++)
 	{
 		// multiply by 128 because TEV stores UVs as s17.7
-		tev.Uv[i].s = (s32)(pixel.Uv[i][0] * 128);
-		tev.Uv[i].t = (s32)(pixel.Uv[i][1] * 128);
+		uv[i].s = (s32)(pixel.Uv[i][0] * 128);
+		uv[i].t = (s32)(pixel.Uv[i][1] * 128);
 	}
 
+	return true;
+}
+
+// Gives the tev the LODs of the current raster block
+static void SetupLOD(RasterContext& context)
+{
+	Tev& tev = context.tev;
+	const RasterBlock& rasterBlock = context.rasterBlock;
+
 	for (unsigned int i = 0; i < bpmem.genMode.numindstages.Value(); i++)
 	{
 		tev.IndirectLod[i] = rasterBlock.IndirectLod[i];
@@ -158,20 +258,29 @@ static void Draw(s32 x, s32 y, s32 xi, s32 yi)
 		tev.TextureLod[i] = rasterBlock.TextureLod[i];
 		tev.TextureLinear[i] = rasterBlock.TextureLinear[i];
 	}
+}
+
+static void Draw(RasterContext& context, const TriangleSetup& tri, s32 x, s32 y, s32 xi, s32 yi)
+{
+	Tev& tev = context.tev;
+
+	if (!SetupPixel(context, tri, x, y, xi, yi, tev.Position, tev.Color, tev.Uv))
+		return;
 
+	SetupLOD(context);
 	tev.Draw();
 }
 
-static void InitTriangle(float X1, float Y1, s32 xi, s32 yi)
+static void InitTriangle(TriangleSetup* tri, float X1, float Y1, s32 xi, s32 yi)
 {
-	vertex0X = xi;
-	vertex0Y = yi;
+	tri->vertex0X = xi;
+	tri->vertex0Y = yi;
 
 	// adjust a little less than 0.5
 	const float adjust = 0.495f;
 
-	vertexOffsetX = ((float)xi - X1) + adjust;
-	vertexOffsetY = ((float)yi - Y1) + adjust;
+	tri->vertexOffsetX = ((float)xi - X1) + adjust;
+	tri->vertexOffsetY = ((float)yi - Y1) + adjust;
 }
 
 static void InitSlope(Slope *slope, float f1, float f2, float f3, float DX31, float DX12, float DY12, float DY31)
@@ -186,7 +295,7 @@ static void InitSlope(Slope *slope, float f1, float f2, float f3, float DX31, fl
 	slope->f0 = f1;
 }
 
-static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoord)
+static inline void CalculateLOD(const RasterBlock& rasterBlock, s32* lodp, bool* linear, u32 texmap, u32 texcoord)
 {
 	const FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
 	const u8 subTexmap = texmap & 3;
@@ -199,17 +308,17 @@ static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoor
 	float sDelta, tDelta;
 	if (tm0.diag_lod)
 	{
-		float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
-		float *uv1 = rasterBlock.Pixel[1][1].Uv[texcoord];
+		const float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
+		const float *uv1 = rasterBlock.Pixel[1][1].Uv[texcoord];
 
 		sDelta = fabsf(uv0[0] - uv1[0]);
 		tDelta = fabsf(uv0[1] - uv1[1]);
 	}
 	else
 	{
-		float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
-		float *uv1 = rasterBlock.Pixel[1][0].Uv[texcoord];
-		float *uv2 = rasterBlock.Pixel[0][1].Uv[texcoord];
+		const float *uv0 = rasterBlock.Pixel[0][0].Uv[texcoord];
+		const float *uv1 = rasterBlock.Pixel[1][0].Uv[texcoord];
+		const float *uv2 = rasterBlock.Pixel[0][1].Uv[texcoord];
 
 		sDelta = std::max(fabsf(uv0[0] - uv1[0]), fabsf(uv0[0] - uv2[0]));
 		tDelta = std::max(fabsf(uv0[1] - uv1[1]), fabsf(uv0[1] - uv2[1]));
@@ -234,18 +343,20 @@ static inline void CalculateLOD(s32* lodp, bool* linear, u32 texmap, u32 texcoor
 	*lodp = lod;
 }
 
-static void BuildBlock(s32 blockX, s32 blockY)
+static void BuildBlock(RasterContext& context, const TriangleSetup& tri, s32 blockX, s32 blockY)
 {
+	RasterBlock& rasterBlock = context.rasterBlock;
+
 	for (s32 yi = 0; yi < BLOCK_SIZE; yi++)
 	{
 		for (s32 xi = 0; xi < BLOCK_SIZE; xi++)
 		{
 			RasterBlockPixel& pixel = rasterBlock.Pixel[xi][yi];
 
-			float dx = vertexOffsetX + (float)(xi + blockX - vertex0X);
-			float dy = vertexOffsetY + (float)(yi + blockY - vertex0Y);
+			float dx = tri.vertexOffsetX + (float)(xi + blockX - tri.vertex0X);
+			float dy = tri.vertexOffsetY + (float)(yi + blockY - tri.vertex0Y);
 
-			float invW = 1.0f / WSlope.GetValue(dx, dy);
+			float invW = 1.0f / tri.WSlope.GetValue(dx, dy);
 			pixel.InvW = invW;
 
 			// tex coords
@@ -254,13 +365,13 @@ static void BuildBlock(s32 blockX, s32 blockY)
 				float projection = invW;
 				if (xfmem.texMtxInfo[i].projection)
 				{
-					float q = TexSlopes[i][2].GetValue(dx, dy) * invW;
+					float q = tri.TexSlopes[i][2].GetValue(dx, dy) * invW;
 					if (q != 0.0f)
 						projection = invW / q;
 				}
 
-				pixel.Uv[i][0] = TexSlopes[i][0].GetValue(dx, dy) * projection;
-				pixel.Uv[i][1] = TexSlopes[i][1].GetValue(dx, dy) * projection;
+				pixel.Uv[i][0] = tri.TexSlopes[i][0].GetValue(dx, dy) * projection;
+				pixel.Uv[i][1] = tri.TexSlopes[i][1].GetValue(dx, dy) * projection;
 			}
 		}
 	}
@@ -273,7 +384,7 @@ static void BuildBlock(s32 blockX, s32 blockY)
 		u32 texcoord = indref & 3;
 		indref >>= 3;
 
-		CalculateLOD(&rasterBlock.IndirectLod[i], &rasterBlock.IndirectLinear[i], texmap, texcoord);
+		CalculateLOD(rasterBlock, &rasterBlock.IndirectLod[i], &rasterBlock.IndirectLinear[i], texmap, texcoord);
 	}
 
 	for (unsigned int i = 0; i <= bpmem.genMode.numtevstages; i++)
@@ -285,12 +396,12 @@ static void BuildBlock(s32 blockX, s32 blockY)
 			u32 texmap = order.getTexMap(stageOdd);
 			u32 texcoord = order.getTexCoord(stageOdd);
 
-			CalculateLOD(&rasterBlock.TextureLod[i], &rasterBlock.TextureLinear[i], texmap, texcoord);
+			CalculateLOD(rasterBlock, &rasterBlock.TextureLod[i], &rasterBlock.TextureLinear[i], texmap, texcoord);
 		}
 	}
 }
 
-static inline void PrepareBlock(s32 blockX, s32 blockY)
+static inline void PrepareBlock(const TriangleSetup& tri, s32 blockX, s32 blockY)
 {
 	static s32 x = -1;
 	static s32 y = -1;
@@ -302,10 +413,199 @@ static inline void PrepareBlock(s32 blockX, s32 blockY)
 	{
 		x = blockX;
 		y = blockY;
-		BuildBlock(x, y);
+		BuildBlock(bboxContext, tri, x, y);
 	}
 }
 
+// Draws a pixel for the bounding box right away
+static void DrawBoundingBoxPixel(const TriangleSetup& tri, s32 x, s32 y)
+{
+	// Build the new raster block every other pixel
+	PrepareBlock(tri, x, y);
+	Draw(bboxContext, tri, x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+	FlushCounters(bboxContext);
+}
+
+// Draws the blocks of a triangle inside the given rectangle, which must start on a block
+static void DrawTriangleBlocks(RasterContext& context, const TriangleSetup& tri, s32 left, s32 top, s32 right, s32 bottom)
+{
+	Tev& tev = context.tev;
+
+	const s32 DX12 = tri.DX12;
+	const s32 DX23 = tri.DX23;
+	const s32 DX31 = tri.DX31;
+
+	const s32 DY12 = tri.DY12;
+	const s32 DY23 = tri.DY23;
+	const s32 DY31 = tri.DY31;
+
+	// Fixed-pos32 deltas
+	const s32 FDX12 = DX12 * 16;
+	const s32 FDX23 = DX23 * 16;
+	const s32 FDX31 = DX31 * 16;
+
+	const s32 FDY12 = DY12 * 16;
+	const s32 FDY23 = DY23 * 16;
+	const s32 FDY31 = DY31 * 16;
+
+	const s32 C1 = tri.C1;
+	const s32 C2 = tri.C2;
+	const s32 C3 = tri.C3;
+
+	// Start in corner of 8x8 block
+	s32 minx = std::max(tri.minx & ~(BLOCK_SIZE - 1), left);
+	s32 miny = std::max(tri.miny & ~(BLOCK_SIZE - 1), top);
+	s32 maxx = std::min(tri.maxx, right);
+	s32 maxy = std::min(tri.maxy, bottom);
+
+	// Loop through blocks
+	for (s32 y = miny; y < maxy; y += BLOCK_SIZE)
+	{
+		for (s32 x = minx; x < maxx; x += BLOCK_SIZE)
+		{
+			// Corners of block
+			s32 x0 = x << 4;
+			s32 x1 = (x + BLOCK_SIZE - 1) << 4;
+			s32 y0 = y << 4;
+			s32 y1 = (y + BLOCK_SIZE - 1) << 4;
+
+			// Evaluate half-space functions
+			bool a00 = C1 + DX12 * y0 - DY12 * x0 > 0;
+			bool a10 = C1 + DX12 * y0 - DY12 * x1 > 0;
+			bool a01 = C1 + DX12 * y1 - DY12 * x0 > 0;
+			bool a11 = C1 + DX12 * y1 - DY12 * x1 > 0;
+			int a = (a00 << 0) | (a10 << 1) | (a01 << 2) | (a11 << 3);
+
+			bool b00 = C2 + DX23 * y0 - DY23 * x0 > 0;
+			bool b10 = C2 + DX23 * y0 - DY23 * x1 > 0;
+			bool b01 = C2 + DX23 * y1 - DY23 * x0 > 0;
+			bool b11 = C2 + DX23 * y1 - DY23 * x1 > 0;
+			int b = (b00 << 0) | (b10 << 1) | (b01 << 2) | (b11 << 3);
+
+			bool c00 = C3 + DX31 * y0 - DY31 * x0 > 0;
+			bool c10 = C3 + DX31 * y0 - DY31 * x1 > 0;
+			bool c01 = C3 + DX31 * y1 - DY31 * x0 > 0;
+			bool c11 = C3 + DX31 * y1 - DY31 * x1 > 0;
+			int c = (c00 << 0) | (c10 << 1) | (c01 << 2) | (c11 << 3);
+
+			// Skip block when outside an edge
+			if (a == 0x0 || b == 0x0 || c == 0x0)
+				continue;
+
+			BuildBlock(context, tri, x, y);
+
+			// The block's pixels are shaded together as a span
+			int count = 0;
+
+			// Accept whole block when totally covered
+			if (a == 0xF && b == 0xF && c == 0xF)
+			{
+				for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
+				{
+					for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
+					{
+						if (SetupPixel(context, tri, x + ix, y + iy, ix, iy, tev.SpanPosition[count], tev.SpanColor[count], tev.SpanUv[count]))
+							count++;
+					}
+				}
+			}
+			else // Partially covered block
+			{
+				s32 CY1 = C1 + DX12 * y0 - DY12 * x0;
+				s32 CY2 = C2 + DX23 * y0 - DY23 * x0;
+				s32 CY3 = C3 + DX31 * y0 - DY31 * x0;
+
+				for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
+				{
+					s32 CX1 = CY1;
+					s32 CX2 = CY2;
+					s32 CX3 = CY3;
+
+					for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
+					{
+						if (CX1 > 0 && CX2 > 0 && CX3 > 0)
+						{
+							if (SetupPixel(context, tri, x + ix, y + iy, ix, iy, tev.SpanPosition[count], tev.SpanColor[count], tev.SpanUv[count]))
+								count++;
+						}
+
+						CX1 -= FDY12;
+						CX2 -= FDY23;
+						CX3 -= FDY31;
+					}
+
+					CY1 += FDX12;
+					CY2 += FDX23;
+					CY3 += FDX31;
+				}
+			}
+
+			if (count)
+			{
+				SetupLOD(context);
+				tev.DrawSpan(count);
+			}
+		}
+	}
+}
+
+// Adds a triangle to the tiles it may touch
+static void BinTriangle(const TriangleSetup& tri)
+{
+	const u32 index = (u32)triangles.size();
+	triangles.push_back(tri);
+
+	const int tileLeft = (tri.minx & ~(BLOCK_SIZE - 1)) / EfbInterface::TILE_SIZE;
+	const int tileTop = (tri.miny & ~(BLOCK_SIZE - 1)) / EfbInterface::TILE_SIZE;
+	const int tileRight = (tri.maxx - 1) / EfbInterface::TILE_SIZE;
+	const int tileBottom = (tri.maxy - 1) / EfbInterface::TILE_SIZE;
+
+	for (int tileY = tileTop; tileY <= tileBottom; tileY++)
+	{
+		for (int tileX = tileLeft; tileX <= tileRight; tileX++)
+		{
+			int tile = tileY * EfbInterface::TILES_WIDE + tileX;
+			if (tileTriangles[tile].empty())
+				usedTiles.push_back(tile);
+			tileTriangles[tile].push_back(index);
+		}
+	}
+}
+
+static void DrawTile(RasterContext& context, int tile)
+{
+	const s32 left = (tile % EfbInterface::TILES_WIDE) * EfbInterface::TILE_SIZE;
+	const s32 top = (tile / EfbInterface::TILES_WIDE) * EfbInterface::TILE_SIZE;
+
+	for (u32 index : tileTriangles[tile])
+		DrawTriangleBlocks(context, triangles[index], left, top, left + EfbInterface::TILE_SIZE, top + EfbInterface::TILE_SIZE);
+}
+
+void Flush(bool parallel)
+{
+	if (triangles.empty())
+		return;
+
+	auto drawTiles = [](int lower, int upper) {
+		RasterContext context;
+		InitContext(context);
+		for (int i = lower; i < upper; i++)
+			DrawTile(context, usedTiles[i]);
+		FlushCounters(context);
+	};
+
+	// The tev stage dumps go through buffers shared by all pixels
+	if (!parallel || g_ActiveConfig.bDumpTevStages || g_ActiveConfig.bDumpTevTextureFetches)
+		drawTiles(0, (int)usedTiles.size());
+	else
+		Common::ParallelWorker::Loop(drawTiles, 0, (int)usedTiles.size());
+
+	for (int tile : usedTiles)
+		tileTriangles[tile].clear();
+	usedTiles.clear();
+	triangles.clear();
+}
+
 void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVertexData *v2)
 {
 	INCSTAT(stats.thisFrame.numTrianglesDrawn);
@@ -331,6 +631,14 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 	const s32 DY23 = Y2 - Y3;
 	const s32 DY31 = Y3 - Y1;
 
+	TriangleSetup tri;
+	tri.DX12 = DX12;
+	tri.DX23 = DX23;
+	tri.DX31 = DX31;
+	tri.DY12 = DY12;
+	tri.DY23 = DY23;
+	tri.DY31 = DY31;
+
 	// Fixed-pos32 deltas
 	const s32 FDX12 = DX12 * 16;
 	const s32 FDX23 = DX23 * 16;
@@ -363,10 +671,10 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 	float fltdy12 = flty1 - v1->screenPosition.y;
 	float fltdy31 = v2->screenPosition.y - flty1;
 
-	InitTriangle(fltx1, flty1, (X1 + 0xF) >> 4, (Y1 + 0xF) >> 4);
+	InitTriangle(&tri, fltx1, flty1, (X1 + 0xF) >> 4, (Y1 + 0xF) >> 4);
 
 	float w[3] = {1.0f / v0->projectedPosition.w, 1.0f / v1->projectedPosition.w, 1.0f / v2->projectedPosition.w};
-	InitSlope(&WSlope, w[0], w[1], w[2], fltdx31, fltdx12, fltdy12, fltdy31);
+	InitSlope(&tri.WSlope, w[0], w[1], w[2], fltdx31, fltdx12, fltdy12, fltdy31);
 
 	// TODO: The zfreeze emulation is not quite correct, yet!
 	// Many things might prevent us from reaching this line (culling, clipping, scissoring).
@@ -374,17 +682,18 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 	// We're currently sloppy at this since we abort early if any of the culling/clipping/scissoring tests fail.
 	if (!bpmem.genMode.zfreeze || !g_ActiveConfig.bZFreeze)
 		InitSlope(&ZSlope, v0->screenPosition[2], v1->screenPosition[2], v2->screenPosition[2], fltdx31, fltdx12, fltdy12, fltdy31);
+	tri.ZSlope = ZSlope;
 
 	for (unsigned int i = 0; i < bpmem.genMode.numcolchans; i++)
 	{
 		for (int comp = 0; comp < 4; comp++)
-			InitSlope(&ColorSlopes[i][comp], v0->color[i][comp], v1->color[i][comp], v2->color[i][comp], fltdx31, fltdx12, fltdy12, fltdy31);
+			InitSlope(&tri.ColorSlopes[i][comp], v0->color[i][comp], v1->color[i][comp], v2->color[i][comp], fltdx31, fltdx12, fltdy12, fltdy31);
 	}
 
 	for (unsigned int i = 0; i < bpmem.genMode.numtexgens; i++)
 	{
 		for (int comp = 0; comp < 3; comp++)
-			InitSlope(&TexSlopes[i][comp], v0->texCoords[i][comp] * w[0], v1->texCoords[i][comp] * w[1], v2->texCoords[i][comp] * w[2], fltdx31, fltdx12, fltdy12, fltdy31);
+			InitSlope(&tri.TexSlopes[i][comp], v0->texCoords[i][comp] * w[0], v1->texCoords[i][comp] * w[1], v2->texCoords[i][comp] * w[2], fltdx31, fltdx12, fltdy12, fltdy31);
 	}
 
 	// Half-edge constants
@@ -397,89 +706,19 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 	if (DY23 < 0 || (DY23 == 0 && DX23 > 0)) C2++;
 	if (DY31 < 0 || (DY31 == 0 && DX31 > 0)) C3++;
 
-	if (!BoundingBox::active)
-	{
-		// Start in corner of 8x8 block
-		minx &= ~(BLOCK_SIZE - 1);
-		miny &= ~(BLOCK_SIZE - 1);
-		// Loop through blocks
-		for (s32 y = miny; y < maxy; y += BLOCK_SIZE)
-		{
-			for (s32 x = minx; x < maxx; x += BLOCK_SIZE)
-			{
-				// Corners of block
-				s32 x0 = x << 4;
-				s32 x1 = (x + BLOCK_SIZE - 1) << 4;
-				s32 y0 = y << 4;
-				s32 y1 = (y + BLOCK_SIZE - 1) << 4;
-
-				// Evaluate half-space functions
-				bool a00 = C1 + DX12 * y0 - DY12 * x0 > 0;
-				bool a10 = C1 + DX12 * y0 - DY12 * x1 > 0;
-				bool a01 = C1 + DX12 * y1 - DY12 * x0 > 0;
-				bool a11 = C1 + DX12 * y1 - DY12 * x1 > 0;
-				int a = (a00 << 0) | (a10 << 1) | (a01 << 2) | (a11 << 3);
-
-				bool b00 = C2 + DX23 * y0 - DY23 * x0 > 0;
-				bool b10 = C2 + DX23 * y0 - DY23 * x1 > 0;
-				bool b01 = C2 + DX23 * y1 - DY23 * x0 > 0;
-				bool b11 = C2 + DX23 * y1 - DY23 * x1 > 0;
-				int b = (b00 << 0) | (b10 << 1) | (b01 << 2) | (b11 << 3);
-
-				bool c00 = C3 + DX31 * y0 - DY31 * x0 > 0;
-				bool c10 = C3 + DX31 * y0 - DY31 * x1 > 0;
-				bool c01 = C3 + DX31 * y1 - DY31 * x0 > 0;
-				bool c11 = C3 + DX31 * y1 - DY31 * x1 > 0;
-				int c = (c00 << 0) | (c10 << 1) | (c01 << 2) | (c11 << 3);
-
-				// Skip block when outside an edge
-				if (a == 0x0 || b == 0x0 || c == 0x0)
-					continue;
-
-				BuildBlock(x, y);
-
-				// Accept whole block when totally covered
-				if (a == 0xF && b == 0xF && c == 0xF)
-				{
-					for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
-					{
-						for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
-						{
-							Draw(x + ix, y + iy, ix, iy);
-						}
-					}
-				}
-				else // Partially covered block
-				{
-					s32 CY1 = C1 + DX12 * y0 - DY12 * x0;
-					s32 CY2 = C2 + DX23 * y0 - DY23 * x0;
-					s32 CY3 = C3 + DX31 * y0 - DY31 * x0;
+	tri.C1 = C1;
+	tri.C2 = C2;
+	tri.C3 = C3;
 
-					for (s32 iy = 0; iy < BLOCK_SIZE; iy++)
-					{
-						s32 CX1 = CY1;
-						s32 CX2 = CY2;
-						s32 CX3 = CY3;
+	tri.minx = minx;
+	tri.maxx = maxx;
+	tri.miny = miny;
+	tri.maxy = maxy;
 
-						for (s32 ix = 0; ix < BLOCK_SIZE; ix++)
-						{
-							if (CX1 > 0 && CX2 > 0 && CX3 > 0)
-							{
-								Draw(x + ix, y + iy, ix, iy);
-							}
-
-							CX1 -= FDY12;
-							CX2 -= FDY23;
-							CX3 -= FDY31;
-						}
-
-						CY1 += FDX12;
-						CY2 += FDX23;
-						CY3 += FDX31;
-					}
-				}
-			}
-		}
+	if (!BoundingBox::active)
+	{
+		// Drawn by Flush, together with the rest of the draw call
+		BinTriangle(tri);
 	}
 	else
 	{
@@ -531,9 +770,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 			{
 				if (CX1 > 0 && CX2 > 0 && CX3 > 0)
 				{
-					// Build the new raster block every other pixel
-					PrepareBlock(x, y);
-					Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+					DrawBoundingBoxPixel(tri, x, y);
 
 					if (y >= BoundingBox::coords[BoundingBox::TOP])
 						break;
@@ -572,8 +809,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 			{
 				if (CY1 > 0 && CY2 > 0 && CY3 > 0)
 				{
-					PrepareBlock(x, y);
-					Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+					DrawBoundingBoxPixel(tri, x, y);
 
 					if (x >= BoundingBox::coords[BoundingBox::LEFT])
 						break;
@@ -611,9 +847,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 			{
 				if (CX1 > 0 && CX2 > 0 && CX3 > 0)
 				{
-					// Build the new raster block every other pixel
-					PrepareBlock(x, y);
-					Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+					DrawBoundingBoxPixel(tri, x, y);
 
 					if (y <= BoundingBox::coords[BoundingBox::BOTTOM])
 						break;
@@ -652,9 +886,7 @@ void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVer
 			{
 				if (CY1 > 0 && CY2 > 0 && CY3 > 0)
 				{
-					// Build the new raster block every other pixel
-					PrepareBlock(x, y);
-					Draw(x, y, x & (BLOCK_SIZE - 1), y & (BLOCK_SIZE - 1));
+					DrawBoundingBoxPixel(tri, x, y);
 
 					if (x <= BoundingBox::coords[BoundingBox::RIGHT])
 						break;
@@ -12,8 +12,14 @@ namespace Rasterizer
 {
 void Init();
 
+// Sets up the triangle and bins it into the EFB tiles it touches, the pixels are drawn by Flush
 void DrawTriangleFrontFace(OutputVertexData *v0, OutputVertexData *v1, OutputVertexData *v2);
 
+// Draws the binned triangles, with the tiles shaded in parallel unless parallel is false.
+// Triangles keep their order within each tile, so the output is the same as drawing them one
+// after another.
+void Flush(bool parallel = true);
+
 void SetScissor();
 
 void SetTevReg(int reg, int comp, bool konst, s16 color);
@@ -24,7 +30,7 @@ struct Slope
 	float dfdy;
 	float f0;
 
-	float GetValue(float dx, float dy)
+	float GetValue(float dx, float dy) const
 	{
 		return f0 + (dfdx * dx) + (dfdy * dy);
 	}
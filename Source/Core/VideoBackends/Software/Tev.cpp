@@ -3,9 +3,11 @@
 // Refer to the license.txt file included.
 
 #include <cmath>
+#include <cstring>
 
 #include "Common/ChunkFile.h"
 #include "Common/CommonTypes.h"
+#include "Common/Intrinsics.h"
 #include "VideoBackends/Software/DebugUtil.h"
 #include "VideoBackends/Software/EfbInterface.h"
 #include "VideoBackends/Software/Tev.h"
@@ -13,7 +15,6 @@
 
 #include "VideoCommon/BoundingBox.h"
 #include "VideoCommon/PerfQueryBase.h"
-#include "VideoCommon/Statistics.h"
 #include "VideoCommon/VideoConfig.h"
 #include "VideoCommon/XFMemory.h"
 
@@ -66,6 +67,38 @@ void Tev::Init()
 	m_AlphaInputLUT[6] = &StageKonst[ALP_C]; // konst
 	m_AlphaInputLUT[7] = &Zero16[ALP_C]; // zero
 
+	for (int i = 0; i < SPAN_SIZE; i++)
+	{
+		SpanFixedConstants[0][i] = 0;
+		SpanFixedConstants[1][i] = 128;
+		SpanFixedConstants[2][i] = 255;
+	}
+
+	for (int comp = 0; comp < 3; comp++)
+	{
+		int reg_comp = BLU_C + comp;
+		for (int reg = 0; reg < 4; reg++)
+		{
+			m_SpanColorInputLUT[reg * 2][comp] = SpanReg[reg][reg_comp]; // prev, c0, c1, c2.rgb
+			m_SpanColorInputLUT[reg * 2 + 1][comp] = SpanReg[reg][ALP_C]; // prev, c0, c1, c2.aaa
+		}
+		m_SpanColorInputLUT[8][comp] = SpanTexColor[reg_comp]; // tex.rgb
+		m_SpanColorInputLUT[9][comp] = SpanTexColor[ALP_C]; // tex.aaa
+		m_SpanColorInputLUT[10][comp] = SpanRasColor[reg_comp]; // ras.rgb
+		m_SpanColorInputLUT[11][comp] = SpanRasColor[ALP_C]; // ras.aaa
+		m_SpanColorInputLUT[12][comp] = SpanFixedConstants[2]; // one
+		m_SpanColorInputLUT[13][comp] = SpanFixedConstants[1]; // half
+		m_SpanColorInputLUT[14][comp] = SpanStageKonst[reg_comp]; // konst
+		m_SpanColorInputLUT[15][comp] = SpanFixedConstants[0]; // zero
+	}
+
+	for (int reg = 0; reg < 4; reg++)
+		m_SpanAlphaInputLUT[reg] = SpanReg[reg][ALP_C]; // prev, c0, c1, c2
+	m_SpanAlphaInputLUT[4] = SpanTexColor[ALP_C]; // tex
+	m_SpanAlphaInputLUT[5] = SpanRasColor[ALP_C]; // ras
+	m_SpanAlphaInputLUT[6] = SpanStageKonst[ALP_C]; // konst
+	m_SpanAlphaInputLUT[7] = SpanFixedConstants[0]; // zero
+
 	for (int comp = 0; comp < 4; comp++)
 	{
 		m_KonstLUT[0][comp] = &FixedConstants[8];
@@ -124,6 +157,21 @@ void Tev::Init()
 	m_ScaleRShiftLUT[1] = 0;
 	m_ScaleRShiftLUT[2] = 0;
 	m_ScaleRShiftLUT[3] = 1;
+
+	ResetCounters();
+}
+
+void Tev::ResetCounters()
+{
+	PixelsIn = 0;
+	PixelsOut = 0;
+	for (u32& pixels : PerfPixels)
+		pixels = 0;
+
+	BoundingBoxCoords[BoundingBox::LEFT] = 0xFFFF;
+	BoundingBoxCoords[BoundingBox::RIGHT] = 0;
+	BoundingBoxCoords[BoundingBox::TOP] = 0xFFFF;
+	BoundingBoxCoords[BoundingBox::BOTTOM] = 0;
 }
 
 static inline s16 Clamp255(s16 in)
@@ -188,6 +236,52 @@ void Tev::SetRasColor(int colorChan, int swaptable)
 	}
 }
 
+void Tev::SetSpanRasColor(int colorChan, int swaptable, int count)
+{
+	switch (colorChan)
+	{
+	case 0: // Color0
+	case 1: // Color1
+	{
+		int swapRed = bpmem.tevksel[swaptable].swap1;
+		int swapGreen = bpmem.tevksel[swaptable].swap2;
+		int swapBlue = bpmem.tevksel[swaptable + 1].swap1;
+		int swapAlpha = bpmem.tevksel[swaptable + 1].swap2;
+		for (int i = 0; i < count; i++)
+		{
+			const u8 *color = SpanColor[i][colorChan];
+			SpanRasColor[RED_C][i] = color[swapRed];
+			SpanRasColor[GRN_C][i] = color[swapGreen];
+			SpanRasColor[BLU_C][i] = color[swapBlue];
+			SpanRasColor[ALP_C][i] = color[swapAlpha];
+		}
+	}
+	break;
+	case 5: // alpha bump
+	case 6: // alpha bump normalized
+	{
+		for (int i = 0; i < count; i++)
+		{
+			u8 alphaBump = SpanAlphaBump[i];
+			if (colorChan == 6)
+				alphaBump |= alphaBump >> 5;
+			for (int comp = 0; comp < 4; comp++)
+				SpanRasColor[comp][i] = alphaBump;
+		}
+	}
+	break;
+	default: // zero
+	{
+		for (int comp = 0; comp < 4; comp++)
+		{
+			for (int i = 0; i < count; i++)
+				SpanRasColor[comp][i] = 0;
+		}
+	}
+	break;
+	}
+}
+
 void Tev::DrawColorRegular(TevStageCombiner::ColorCombiner &cc, const InputRegType inputs[4])
 {
 	for (int i = 0; i < 3; i++)
@@ -391,10 +485,10 @@ static inline s32 WrapIndirectCoord(s32 coord, int wrapMode)
 	}
 }
 
-void Tev::Indirect(unsigned int stageNum, s32 s, s32 t)
+void Tev::Indirect(unsigned int stageNum, s32 s, s32 t, const u8 (*indirectTex)[4], TextureCoordinateType* texCoord, u8* alphaBump)
 {
 	TevStageIndirect &indirect = bpmem.tevind[stageNum];
-	u8 *indmap = IndirectTex[indirect.bt];
+	const u8 *indmap = indirectTex[indirect.bt];
 
 	s32 indcoord[3];
 
@@ -402,16 +496,16 @@ void Tev::Indirect(unsigned int stageNum, s32 s, s32 t)
 	switch (indirect.bs)
 	{
 	case ITBA_OFF:
-		AlphaBump = 0;
+		*alphaBump = 0;
 		break;
 	case ITBA_S:
-		AlphaBump = indmap[TextureSampler::ALP_SMP];
+		*alphaBump = indmap[TextureSampler::ALP_SMP];
 		break;
 	case ITBA_T:
-		AlphaBump = indmap[TextureSampler::BLU_SMP];
+		*alphaBump = indmap[TextureSampler::BLU_SMP];
 		break;
 	case ITBA_U:
-		AlphaBump = indmap[TextureSampler::GRN_SMP];
+		*alphaBump = indmap[TextureSampler::GRN_SMP];
 		break;
 	}
 
@@ -429,25 +523,25 @@ void Tev::Indirect(unsigned int stageNum, s32 s, s32 t)
 		indcoord[0] = indmap[TextureSampler::ALP_SMP] + bias[0];
 		indcoord[1] = indmap[TextureSampler::BLU_SMP] + bias[1];
 		indcoord[2] = indmap[TextureSampler::GRN_SMP] + bias[2];
-		AlphaBump = AlphaBump & 0xf8;
+		*alphaBump &= 0xf8;
 		break;
 	case ITF_5:
 		indcoord[0] = (indmap[TextureSampler::ALP_SMP] & 0x1f) + bias[0];
 		indcoord[1] = (indmap[TextureSampler::BLU_SMP] & 0x1f) + bias[1];
 		indcoord[2] = (indmap[TextureSampler::GRN_SMP] & 0x1f) + bias[2];
-		AlphaBump = AlphaBump & 0xe0;
+		*alphaBump &= 0xe0;
 		break;
 	case ITF_4:
 		indcoord[0] = (indmap[TextureSampler::ALP_SMP] & 0x0f) + bias[0];
 		indcoord[1] = (indmap[TextureSampler::BLU_SMP] & 0x0f) + bias[1];
 		indcoord[2] = (indmap[TextureSampler::GRN_SMP] & 0x0f) + bias[2];
-		AlphaBump = AlphaBump & 0xf0;
+		*alphaBump &= 0xf0;
 		break;
 	case ITF_3:
 		indcoord[0] = (indmap[TextureSampler::ALP_SMP] & 0x07) + bias[0];
 		indcoord[1] = (indmap[TextureSampler::BLU_SMP] & 0x07) + bias[1];
 		indcoord[2] = (indmap[TextureSampler::GRN_SMP] & 0x07) + bias[2];
-		AlphaBump = AlphaBump & 0xf8;
+		*alphaBump &= 0xf8;
 		break;
 	default:
 		PanicAlert("Tev::Indirect");
@@ -496,14 +590,137 @@ void Tev::Indirect(unsigned int stageNum, s32 s, s32 t)
 
 	if (indirect.fb_addprev)
 	{
-		TexCoord.s += (int)(WrapIndirectCoord(s, indirect.sw) + indtevtrans[0]);
-		TexCoord.t += (int)(WrapIndirectCoord(t, indirect.tw) + indtevtrans[1]);
+		texCoord->s += (int)(WrapIndirectCoord(s, indirect.sw) + indtevtrans[0]);
+		texCoord->t += (int)(WrapIndirectCoord(t, indirect.tw) + indtevtrans[1]);
 	}
 	else
 	{
-		TexCoord.s = (int)(WrapIndirectCoord(s, indirect.sw) + indtevtrans[0]);
-		TexCoord.t = (int)(WrapIndirectCoord(t, indirect.tw) + indtevtrans[1]);
+		texCoord->s = (int)(WrapIndirectCoord(s, indirect.sw) + indtevtrans[0]);
+		texCoord->t = (int)(WrapIndirectCoord(t, indirect.tw) + indtevtrans[1]);
+	}
+}
+
+// Applies the z texture, fog and the late depth test to a pixel that passed the alpha test.
+// Returns false when the depth test rejects the pixel.
+bool Tev::DepthAndFog(s32* position, const s16* texColor, u8* output)
+{
+	// z texture
+	if (bpmem.ztex2.op)
+	{
+		u32 ztex = bpmem.ztex1.bias;
+		switch (bpmem.ztex2.type)
+		{
+		case 0: // 8 bit
+			ztex += texColor[ALP_C];
+			break;
+		case 1: // 16 bit
+			ztex += texColor[ALP_C] << 8 | texColor[RED_C];
+			break;
+		case 2: // 24 bit
+			ztex += texColor[RED_C] << 16 | texColor[GRN_C] << 8 | texColor[BLU_C];
+			break;
+		}
+
+		if (bpmem.ztex2.op == ZTEXTURE_ADD)
+			ztex += position[2];
+
+		position[2] = ztex & 0x00ffffff;
+	}
+
+	// fog
+	if (bpmem.fog.c_proj_fsel.fsel)
+	{
+		float ze;
+
+		if (bpmem.fog.c_proj_fsel.proj == 0)
+		{
+			// perspective
+			// ze = A/(B - (Zs >> B_SHF))
+			s32 denom = bpmem.fog.b_magnitude - (position[2] >> bpmem.fog.b_shift);
+			//in addition downscale magnitude and zs to 0.24 bits
+			ze = (bpmem.fog.a.GetA() * 16777215.0f) / (float)denom;
+		}
+		else
+		{
+			// orthographic
+			// ze = a*Zs
+			//in addition downscale zs to 0.24 bits
+			ze = bpmem.fog.a.GetA() * ((float)position[2] / 16777215.0f);
+
+		}
+
+		if (bpmem.fogRange.Base.Enabled)
+		{
+			// TODO: This is untested and should definitely be checked against real hw.
+			// - No idea if offset is really normalized against the viewport width or against the projection matrix or yet something else
+			// - scaling of the "k" coefficient isn't clear either.
+
+			// First, calculate the offset from the viewport center (normalized to 0..1)
+			float offset = (position[0] - (bpmem.fogRange.Base.Center - 342)) / (float)xfmem.viewport.wd;
+
+			// Based on that, choose the index such that points which are far away from the z-axis use the 10th "k" value and such that central points use the first value.
+			float floatindex = 9.f - std::abs(offset) * 9.f;
+			floatindex = (floatindex < 0.f) ? 0.f : (floatindex > 9.f) ? 9.f : floatindex; // TODO: This shouldn't be necessary!
+
+			// Get the two closest integer indices, look up the corresponding samples
+			int indexlower = (int)floor(floatindex);
+			int indexupper = indexlower + 1;
+			// Look up coefficient... Seems like multiplying by 4 makes Fortune Street work properly (fog is too strong without the factor)
+			float klower = bpmem.fogRange.K[indexlower / 2].GetValue(indexlower % 2) * 4.f;
+			float kupper = bpmem.fogRange.K[indexupper / 2].GetValue(indexupper % 2) * 4.f;
+
+			// linearly interpolate the samples and multiple ze by the resulting adjustment factor
+			float factor = indexupper - floatindex;
+			float k = klower * factor + kupper * (1.f - factor);
+			float x_adjust = sqrt(offset*offset + k*k) / k;
+			ze *= x_adjust; // NOTE: This is basically dividing by a cosine (hidden behind GXInitFogAdjTable): 1/cos = c/b = sqrt(a^2+b^2)/b
+		}
+
+		ze -= bpmem.fog.c_proj_fsel.GetC();
+
+		// clamp 0 to 1
+		float fog = (ze < 0.0f) ? 0.0f : ((ze > 1.0f) ? 1.0f : ze);
+
+		switch (bpmem.fog.c_proj_fsel.fsel)
+		{
+		case 4: // exp
+			fog = 1.0f - pow(2.0f, -8.0f * fog);
+			break;
+		case 5: // exp2
+			fog = 1.0f - pow(2.0f, -8.0f * fog * fog);
+			break;
+		case 6: // backward exp
+			fog = 1.0f - fog;
+			fog = pow(2.0f, -8.0f * fog);
+			break;
+		case 7: // backward exp2
+			fog = 1.0f - fog;
+			fog = pow(2.0f, -8.0f * fog * fog);
+			break;
+		}
+
+		// lerp from output to fog color
+		u32 fogInt = (u32)(fog * 256);
+		u32 invFog = 256 - fogInt;
+
+		output[RED_C] = (output[RED_C] * invFog + fogInt * bpmem.fog.color.r) >> 8;
+		output[GRN_C] = (output[GRN_C] * invFog + fogInt * bpmem.fog.color.g) >> 8;
+		output[BLU_C] = (output[BLU_C] * invFog + fogInt * bpmem.fog.color.b) >> 8;
+	}
+
+	bool late_ztest = !bpmem.zcontrol.early_ztest || !g_ActiveConfig.bZComploc;
+	if (late_ztest && bpmem.zmode.testenable)
+	{
+		// TODO: Check against hw if these values get incremented even if depth testing is disabled
+		PerfPixels[PQ_ZCOMP_INPUT]++;
+
+		if (!EfbInterface::ZCompare(position[0], position[1], position[2]))
+			return false;
+
+		PerfPixels[PQ_ZCOMP_OUTPUT]++;
 	}
+
+	return true;
 }
 
 void Tev::Draw()
@@ -511,7 +728,16 @@ void Tev::Draw()
 	_assert_(Position[0] >= 0 && Position[0] < EFB_WIDTH);
 	_assert_(Position[1] >= 0 && Position[1] < EFB_HEIGHT);
 
-	INCSTAT(stats.thisFrame.tevPixelsIn);
+	PixelsIn++;
+
+	// Every pixel starts with the registers of the draw call, like in the hardware backends'
+	// shaders, so the output doesn't depend on the order the pixels are shaded in
+	memcpy(Reg, InitialReg, sizeof(Reg));
+	memset(TexColor, 0, sizeof(TexColor));
+	memset(IndirectTex, 0, sizeof(IndirectTex));
+	TexCoord.s = 0;
+	TexCoord.t = 0;
+	AlphaBump = 0;
 
 	for (unsigned int stageNum = 0; stageNum < bpmem.genMode.numindstages.Value(); stageNum++)
 	{
@@ -556,7 +782,7 @@ void Tev::Draw()
 		int texcoordSel = order.getTexCoord(stageOdd);
 		int texmap = order.getTexMap(stageOdd);
 
-		Indirect(stageNum, Uv[texcoordSel].s, Uv[texcoordSel].t);
+		Indirect(stageNum, Uv[texcoordSel].s, Uv[texcoordSel].t, IndirectTex, &TexCoord, &AlphaBump);
 
 		// sample texture
 		if (order.getEnable(stageOdd))
@@ -655,127 +881,14 @@ void Tev::Draw()
 	{
 		if (!TevAlphaTest(output[ALP_C]))
 			return;
-		// z texture
-		if (bpmem.ztex2.op)
-		{
-			u32 ztex = bpmem.ztex1.bias;
-			switch (bpmem.ztex2.type)
-			{
-			case 0: // 8 bit
-				ztex += TexColor[ALP_C];
-				break;
-			case 1: // 16 bit
-				ztex += TexColor[ALP_C] << 8 | TexColor[RED_C];
-				break;
-			case 2: // 24 bit
-				ztex += TexColor[RED_C] << 16 | TexColor[GRN_C] << 8 | TexColor[BLU_C];
-				break;
-			}
-
-			if (bpmem.ztex2.op == ZTEXTURE_ADD)
-				ztex += Position[2];
-
-			Position[2] = ztex & 0x00ffffff;
-		}
-
-		// fog
-		if (bpmem.fog.c_proj_fsel.fsel)
-		{
-			float ze;
-
-			if (bpmem.fog.c_proj_fsel.proj == 0)
-			{
-				// perspective
-				// ze = A/(B - (Zs >> B_SHF))
-				s32 denom = bpmem.fog.b_magnitude - (Position[2] >> bpmem.fog.b_shift);
-				//in addition downscale magnitude and zs to 0.24 bits
-				ze = (bpmem.fog.a.GetA() * 16777215.0f) / (float)denom;
-			}
-			else
-			{
-				// orthographic
-				// ze = a*Zs
-				//in addition downscale zs to 0.24 bits
-				ze = bpmem.fog.a.GetA() * ((float)Position[2] / 16777215.0f);
-
-			}
-
-			if (bpmem.fogRange.Base.Enabled)
-			{
-				// TODO: This is untested and should definitely be checked against real hw.
-				// - No idea if offset is really normalized against the viewport width or against the projection matrix or yet something else
-				// - scaling of the "k" coefficient isn't clear either.
-
-				// First, calculate the offset from the viewport center (normalized to 0..1)
-				float offset = (Position[0] - (bpmem.fogRange.Base.Center - 342)) / (float)xfmem.viewport.wd;
-
-				// Based on that, choose the index such that points which are far away from the z-axis use the 10th "k" value and such that central points use the first value.
-				float floatindex = 9.f - std::abs(offset) * 9.f;
-				floatindex = (floatindex < 0.f) ? 0.f : (floatindex > 9.f) ? 9.f : floatindex; // TODO: This shouldn't be necessary!
-
-				// Get the two closest integer indices, look up the corresponding samples
-				int indexlower = (int)floor(floatindex);
-				int indexupper = indexlower + 1;
-				// Look up coefficient... Seems like multiplying by 4 makes Fortune Street work properly (fog is too strong without the factor)
-				float klower = bpmem.fogRange.K[indexlower / 2].GetValue(indexlower % 2) * 4.f;
-				float kupper = bpmem.fogRange.K[indexupper / 2].GetValue(indexupper % 2) * 4.f;
-
-				// linearly interpolate the samples and multiple ze by the resulting adjustment factor
-				float factor = indexupper - floatindex;
-				float k = klower * factor + kupper * (1.f - factor);
-				float x_adjust = sqrt(offset*offset + k*k) / k;
-				ze *= x_adjust; // NOTE: This is basically dividing by a cosine (hidden behind GXInitFogAdjTable): 1/cos = c/b = sqrt(a^2+b^2)/b
-			}
-
-			ze -= bpmem.fog.c_proj_fsel.GetC();
-
-			// clamp 0 to 1
-			float fog = (ze < 0.0f) ? 0.0f : ((ze > 1.0f) ? 1.0f : ze);
-
-			switch (bpmem.fog.c_proj_fsel.fsel)
-			{
-			case 4: // exp
-				fog = 1.0f - pow(2.0f, -8.0f * fog);
-				break;
-			case 5: // exp2
-				fog = 1.0f - pow(2.0f, -8.0f * fog * fog);
-				break;
-			case 6: // backward exp
-				fog = 1.0f - fog;
-				fog = pow(2.0f, -8.0f * fog);
-				break;
-			case 7: // backward exp2
-				fog = 1.0f - fog;
-				fog = pow(2.0f, -8.0f * fog * fog);
-				break;
-			}
-
-			// lerp from output to fog color
-			u32 fogInt = (u32)(fog * 256);
-			u32 invFog = 256 - fogInt;
-
-			output[RED_C] = (output[RED_C] * invFog + fogInt * bpmem.fog.color.r) >> 8;
-			output[GRN_C] = (output[GRN_C] * invFog + fogInt * bpmem.fog.color.g) >> 8;
-			output[BLU_C] = (output[BLU_C] * invFog + fogInt * bpmem.fog.color.b) >> 8;
-		}
-	
-		bool late_ztest = !bpmem.zcontrol.early_ztest || !g_ActiveConfig.bZComploc;
-		if (late_ztest && bpmem.zmode.testenable)
-		{
-			// TODO: Check against hw if these values get incremented even if depth testing is disabled
-			EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_INPUT);
-
-			if (!EfbInterface::ZCompare(Position[0], Position[1], Position[2]))
-				return;
-
-			EfbInterface::IncPerfCounterQuadCount(PQ_ZCOMP_OUTPUT);
-		}
+		if (!DepthAndFog(Position, TexColor, output))
+			return;
 	}
 	// branchless bounding box update
-	BoundingBox::coords[BoundingBox::LEFT] = std::min((u16)Position[0], BoundingBox::coords[BoundingBox::LEFT]);
-	BoundingBox::coords[BoundingBox::RIGHT] = std::max((u16)Position[0], BoundingBox::coords[BoundingBox::RIGHT]);
-	BoundingBox::coords[BoundingBox::TOP] = std::min((u16)Position[1], BoundingBox::coords[BoundingBox::TOP]);
-	BoundingBox::coords[BoundingBox::BOTTOM] = std::max((u16)Position[1], BoundingBox::coords[BoundingBox::BOTTOM]);
+	BoundingBoxCoords[BoundingBox::LEFT] = std::min((u16)Position[0], BoundingBoxCoords[BoundingBox::LEFT]);
+	BoundingBoxCoords[BoundingBox::RIGHT] = std::max((u16)Position[0], BoundingBoxCoords[BoundingBox::RIGHT]);
+	BoundingBoxCoords[BoundingBox::TOP] = std::min((u16)Position[1], BoundingBoxCoords[BoundingBox::TOP]);
+	BoundingBoxCoords[BoundingBox::BOTTOM] = std::max((u16)Position[1], BoundingBoxCoords[BoundingBox::BOTTOM]);
 
 	// if we are only calculating the bounding box,
 	// there's no need to actually draw anything
@@ -802,12 +915,373 @@ void Tev::Draw()
 	}
 #endif
 
-	INCSTAT(stats.thisFrame.tevPixelsOut);
-	EfbInterface::IncPerfCounterQuadCount(PQ_BLEND_INPUT);
+	PixelsOut++;
+	PerfPixels[PQ_BLEND_INPUT]++;
 
 	EfbInterface::BlendTev(Position[0], Position[1], output);
 }
 
+void Tev::DrawSpanScalar(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		memcpy(Position, SpanPosition[i], sizeof(Position));
+		memcpy(Color, SpanColor[i], sizeof(Color));
+		memcpy(Uv, SpanUv[i], sizeof(Uv));
+		Draw();
+	}
+}
+
+#if defined(_M_X86) && !defined(_M_GENERIC)
+
+// SSE2 versions of the combiners and the alpha test, each lane is a pixel of the span.
+// The components are kept as s32, holding the same values as Draw's s16 registers.
+
+static inline __m128i LoadSpan(const s32* values)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+}
+
+static inline void StoreSpan(s32* values, __m128i v)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(values), v);
+}
+
+static inline __m128i SelectSpan(__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i ClampSpan(__m128i v, s32 low, s32 high)
+{
+	// truncate to s16 first, like storing to a register does
+	v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+
+	const __m128i lowv = _mm_set1_epi32(low);
+	const __m128i highv = _mm_set1_epi32(high);
+	v = SelectSpan(_mm_cmpgt_epi32(v, highv), highv, v);
+	return SelectSpan(_mm_cmplt_epi32(v, lowv), lowv, v);
+}
+
+struct SpanInputRegType
+{
+	__m128i a;
+	__m128i b;
+	__m128i c;
+	__m128i d;
+};
+
+// Loads the inputs the way InputRegType's bitfields store them: 8 unsigned bits for a, b and c,
+// 11 signed bits for d
+static inline SpanInputRegType LoadSpanInputs(const s32* a, const s32* b, const s32* c, const s32* d)
+{
+	const __m128i mask = _mm_set1_epi32(0xFF);
+
+	SpanInputRegType input;
+	input.a = _mm_and_si128(LoadSpan(a), mask);
+	input.b = _mm_and_si128(LoadSpan(b), mask);
+	input.c = _mm_and_si128(LoadSpan(c), mask);
+	input.d = _mm_srai_epi32(_mm_slli_epi32(LoadSpan(d), 21), 21);
+	return input;
+}
+
+// The regular combiner, alpha negates before dropping the fraction and color after
+static inline __m128i CombineSpan(const SpanInputRegType& input, int op, int bias, int lshift, int rshift, int round, bool alpha)
+{
+	// a * (256 - c) + b * c with a single multiply-add, all the factors fit in 16 bits
+	__m128i c = _mm_add_epi32(input.c, _mm_srli_epi32(input.c, 7));
+	__m128i ab = _mm_or_si128(input.a, _mm_slli_epi32(input.b, 16));
+	__m128i weights = _mm_or_si128(_mm_sub_epi32(_mm_set1_epi32(256), c), _mm_slli_epi32(c, 16));
+	__m128i temp = _mm_madd_epi16(ab, weights);
+
+	const __m128i lshiftv = _mm_cvtsi32_si128(lshift);
+	temp = _mm_sll_epi32(temp, lshiftv);
+	temp = _mm_add_epi32(temp, _mm_set1_epi32(round));
+	if (op && alpha)
+		temp = _mm_sub_epi32(_mm_setzero_si128(), temp);
+	temp = _mm_srai_epi32(temp, 8);
+	if (op && !alpha)
+		temp = _mm_sub_epi32(_mm_setzero_si128(), temp);
+
+	__m128i result = _mm_sll_epi32(_mm_add_epi32(input.d, _mm_set1_epi32(bias)), lshiftv);
+	result = _mm_add_epi32(result, temp);
+	return _mm_sra_epi32(result, _mm_cvtsi32_si128(rshift));
+}
+
+// Returns the lanes where the compare mode's condition holds for component comp
+static inline __m128i CompareSpan(int mode, const SpanInputRegType inputs[4], int comp)
+{
+	const SpanInputRegType& red = inputs[Tev::RED_C];
+	const SpanInputRegType& green = inputs[Tev::GRN_C];
+	const SpanInputRegType& blue = inputs[Tev::BLU_C];
+
+	switch (mode)
+	{
+	case TEVCMP_R8_GT:
+		return _mm_cmpgt_epi32(red.a, red.b);
+	case TEVCMP_R8_EQ:
+		return _mm_cmpeq_epi32(red.a, red.b);
+	case TEVCMP_GR16_GT:
+	case TEVCMP_GR16_EQ:
+	{
+		__m128i a = _mm_or_si128(_mm_slli_epi32(green.a, 8), red.a);
+		__m128i b = _mm_or_si128(_mm_slli_epi32(green.b, 8), red.b);
+		return mode == TEVCMP_GR16_GT ? _mm_cmpgt_epi32(a, b) : _mm_cmpeq_epi32(a, b);
+	}
+	case TEVCMP_BGR24_GT:
+	case TEVCMP_BGR24_EQ:
+	{
+		__m128i a = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(blue.a, 16), _mm_slli_epi32(green.a, 8)), red.a);
+		__m128i b = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(blue.b, 16), _mm_slli_epi32(green.b, 8)), red.b);
+		return mode == TEVCMP_BGR24_GT ? _mm_cmpgt_epi32(a, b) : _mm_cmpeq_epi32(a, b);
+	}
+	case TEVCMP_RGB8_GT: // also TEVCMP_A8_GT
+		return _mm_cmpgt_epi32(inputs[comp].a, inputs[comp].b);
+	case TEVCMP_RGB8_EQ: // also TEVCMP_A8_EQ
+		return _mm_cmpeq_epi32(inputs[comp].a, inputs[comp].b);
+	default:
+		return _mm_setzero_si128();
+	}
+}
+
+static inline __m128i AlphaCompareSpan(__m128i alpha, int ref, AlphaTest::CompareMode comp)
+{
+	const __m128i refv = _mm_set1_epi32(ref);
+	const __m128i all = _mm_set1_epi32(-1);
+
+	switch (comp)
+	{
+	case AlphaTest::ALWAYS:  return all;
+	case AlphaTest::NEVER:   return _mm_setzero_si128();
+	case AlphaTest::LEQUAL:  return _mm_xor_si128(_mm_cmpgt_epi32(alpha, refv), all);
+	case AlphaTest::LESS:    return _mm_cmplt_epi32(alpha, refv);
+	case AlphaTest::GEQUAL:  return _mm_xor_si128(_mm_cmplt_epi32(alpha, refv), all);
+	case AlphaTest::GREATER: return _mm_cmpgt_epi32(alpha, refv);
+	case AlphaTest::EQUAL:   return _mm_cmpeq_epi32(alpha, refv);
+	case AlphaTest::NEQUAL:  return _mm_xor_si128(_mm_cmpeq_epi32(alpha, refv), all);
+	default: return all;
+	}
+}
+
+// Returns a bit for every lane passing the alpha test
+static int TevAlphaTestSpan(__m128i alpha)
+{
+	alpha = _mm_and_si128(alpha, _mm_set1_epi32(0xFF));
+	__m128i comp0 = AlphaCompareSpan(alpha, bpmem.alpha_test.ref0, bpmem.alpha_test.comp0);
+	__m128i comp1 = AlphaCompareSpan(alpha, bpmem.alpha_test.ref1, bpmem.alpha_test.comp1);
+
+	__m128i result;
+	switch (bpmem.alpha_test.logic)
+	{
+	case 0: result = _mm_and_si128(comp0, comp1); break; // and
+	case 1: result = _mm_or_si128(comp0, comp1); break;  // or
+	case 2: result = _mm_xor_si128(comp0, comp1); break; // xor
+	case 3: result = _mm_xor_si128(_mm_xor_si128(comp0, comp1), _mm_set1_epi32(-1)); break; // xnor
+	default: result = _mm_set1_epi32(-1); break;
+	}
+
+	return _mm_movemask_ps(_mm_castsi128_ps(result));
+}
+
+void Tev::DrawSpan(int count)
+{
+	// The tev stage dumps and the bounding box go pixel by pixel
+	if (BoundingBox::active || (ALLOW_TEV_DUMPS && (g_ActiveConfig.bDumpTevStages || g_ActiveConfig.bDumpTevTextureFetches)))
+	{
+		DrawSpanScalar(count);
+		return;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		_assert_(SpanPosition[i][0] >= 0 && SpanPosition[i][0] < EFB_WIDTH);
+		_assert_(SpanPosition[i][1] >= 0 && SpanPosition[i][1] < EFB_HEIGHT);
+	}
+
+	PixelsIn += count;
+
+	for (int reg = 0; reg < 4; reg++)
+	{
+		for (int comp = 0; comp < 4; comp++)
+			StoreSpan(SpanReg[reg][comp], _mm_set1_epi32(InitialReg[reg][comp]));
+	}
+	memset(SpanTexColor, 0, sizeof(SpanTexColor));
+	memset(SpanIndirectTex, 0, sizeof(SpanIndirectTex));
+	memset(SpanTexCoord, 0, sizeof(SpanTexCoord));
+	memset(SpanAlphaBump, 0, sizeof(SpanAlphaBump));
+
+	s32 s[SPAN_SIZE];
+	s32 t[SPAN_SIZE];
+	u8 texels[SPAN_SIZE][4];
+
+	for (unsigned int stageNum = 0; stageNum < bpmem.genMode.numindstages.Value(); stageNum++)
+	{
+		int stageNum2 = stageNum >> 1;
+		int stageOdd = stageNum & 1;
+
+		u32 texcoordSel = bpmem.tevindref.getTexCoord(stageNum);
+		u32 texmap = bpmem.tevindref.getTexMap(stageNum);
+
+		const TEXSCALE& texscale = bpmem.texscale[stageNum2];
+		s32 scaleS = stageOdd ? texscale.ss1 : texscale.ss0;
+		s32 scaleT = stageOdd ? texscale.ts1 : texscale.ts0;
+
+		for (int i = 0; i < count; i++)
+		{
+			s[i] = SpanUv[i][texcoordSel].s >> scaleS;
+			t[i] = SpanUv[i][texcoordSel].t >> scaleT;
+		}
+
+		TextureSampler::SampleSpan(s, t, count, IndirectLod[stageNum], IndirectLinear[stageNum], texmap, texels);
+
+		for (int i = 0; i < count; i++)
+			memcpy(SpanIndirectTex[i][stageNum], texels[i], sizeof(texels[i]));
+	}
+
+	for (unsigned int stageNum = 0; stageNum <= bpmem.genMode.numtevstages.Value(); stageNum++)
+	{
+		int stageNum2 = stageNum >> 1;
+		int stageOdd = stageNum & 1;
+		TwoTevStageOrders &order = bpmem.tevorders[stageNum2];
+		TevKSel &kSel = bpmem.tevksel[stageNum2];
+
+		// stage combiners
+		TevStageCombiner::ColorCombiner &cc = bpmem.combiners[stageNum].colorC;
+		TevStageCombiner::AlphaCombiner &ac = bpmem.combiners[stageNum].alphaC;
+
+		int texcoordSel = order.getTexCoord(stageOdd);
+		int texmap = order.getTexMap(stageOdd);
+
+		for (int i = 0; i < count; i++)
+			Indirect(stageNum, SpanUv[i][texcoordSel].s, SpanUv[i][texcoordSel].t, SpanIndirectTex[i], &SpanTexCoord[i], &SpanAlphaBump[i]);
+
+		// sample texture, gathering the texels of all the pixels
+		if (order.getEnable(stageOdd))
+		{
+			for (int i = 0; i < count; i++)
+			{
+				s[i] = SpanTexCoord[i].s;
+				t[i] = SpanTexCoord[i].t;
+			}
+
+			TextureSampler::SampleSpan(s, t, count, TextureLod[stageNum], TextureLinear[stageNum], texmap, texels);
+
+			int swaptable = ac.tswap * 2;
+			int swapRed = bpmem.tevksel[swaptable].swap1;
+			int swapGreen = bpmem.tevksel[swaptable].swap2;
+			int swapBlue = bpmem.tevksel[swaptable + 1].swap1;
+			int swapAlpha = bpmem.tevksel[swaptable + 1].swap2;
+
+			for (int i = 0; i < count; i++)
+			{
+				SpanTexColor[RED_C][i] = texels[i][swapRed];
+				SpanTexColor[GRN_C][i] = texels[i][swapGreen];
+				SpanTexColor[BLU_C][i] = texels[i][swapBlue];
+				SpanTexColor[ALP_C][i] = texels[i][swapAlpha];
+			}
+		}
+
+		// set konst for this stage
+		int kc = kSel.getKC(stageOdd);
+		int ka = kSel.getKA(stageOdd);
+		StoreSpan(SpanStageKonst[RED_C], _mm_set1_epi32(*(m_KonstLUT[kc][RED_C])));
+		StoreSpan(SpanStageKonst[GRN_C], _mm_set1_epi32(*(m_KonstLUT[kc][GRN_C])));
+		StoreSpan(SpanStageKonst[BLU_C], _mm_set1_epi32(*(m_KonstLUT[kc][BLU_C])));
+		StoreSpan(SpanStageKonst[ALP_C], _mm_set1_epi32(*(m_KonstLUT[ka][ALP_C])));
+
+		// set color
+		SetSpanRasColor(order.getColorChan(stageOdd), ac.rswap * 2, count);
+
+		// combine inputs
+		SpanInputRegType inputs[4];
+		for (int i = 0; i < 3; i++)
+		{
+			inputs[BLU_C + i] = LoadSpanInputs(m_SpanColorInputLUT[cc.a][i], m_SpanColorInputLUT[cc.b][i],
+			                                   m_SpanColorInputLUT[cc.c][i], m_SpanColorInputLUT[cc.d][i]);
+		}
+		inputs[ALP_C] = LoadSpanInputs(m_SpanAlphaInputLUT[ac.a], m_SpanAlphaInputLUT[ac.b],
+		                               m_SpanAlphaInputLUT[ac.c], m_SpanAlphaInputLUT[ac.d]);
+
+		for (int i = BLU_C; i <= RED_C; i++)
+		{
+			__m128i result;
+			if (cc.bias != 3)
+			{
+				int round = (cc.shift == 3) ? 0 : (cc.op == 1) ? 127 : 128;
+				result = CombineSpan(inputs[i], cc.op, m_BiasLUT[cc.bias], m_ScaleLShiftLUT[cc.shift], m_ScaleRShiftLUT[cc.shift], round, false);
+			}
+			else
+			{
+				__m128i pass = CompareSpan((cc.shift << 1) | cc.op | 8, inputs, i);
+				result = _mm_add_epi32(inputs[i].d, _mm_and_si128(pass, inputs[i].c));
+			}
+
+			if (cc.clamp)
+				StoreSpan(SpanReg[cc.dest][i], ClampSpan(result, 0, 255));
+			else
+				StoreSpan(SpanReg[cc.dest][i], ClampSpan(result, -1024, 1023));
+		}
+
+		__m128i alpha;
+		if (ac.bias != 3)
+		{
+			int round = (ac.shift != 3) ? 0 : (ac.op == 1) ? 127 : 128;
+			alpha = CombineSpan(inputs[ALP_C], ac.op, m_BiasLUT[ac.bias], m_ScaleLShiftLUT[ac.shift], m_ScaleRShiftLUT[ac.shift], round, true);
+		}
+		else
+		{
+			__m128i pass = CompareSpan((ac.shift << 1) | ac.op | 8, inputs, ALP_C);
+			alpha = _mm_add_epi32(inputs[ALP_C].d, _mm_and_si128(pass, inputs[ALP_C].c));
+		}
+
+		if (ac.clamp)
+			StoreSpan(SpanReg[ac.dest][ALP_C], ClampSpan(alpha, 0, 255));
+		else
+			StoreSpan(SpanReg[ac.dest][ALP_C], ClampSpan(alpha, -1024, 1023));
+	}
+
+	// the results of the last tev stage are put onto the screen,
+	// regardless of the used destination register - TODO: Verify!
+	u32 color_index = bpmem.combiners[bpmem.genMode.numtevstages].colorC.dest;
+	u32 alpha_index = bpmem.combiners[bpmem.genMode.numtevstages].alphaC.dest;
+
+	int passed = TevAlphaTestSpan(LoadSpan(SpanReg[alpha_index][ALP_C]));
+
+	// the rest depends on the efb, so it goes pixel by pixel in the same order as Draw
+	for (int i = 0; i < count; i++)
+	{
+		if (!(passed & (1 << i)))
+			continue;
+
+		s32* position = SpanPosition[i];
+		u8 output[4] = {(u8)SpanReg[alpha_index][ALP_C][i], (u8)SpanReg[color_index][BLU_C][i], (u8)SpanReg[color_index][GRN_C][i], (u8)SpanReg[color_index][RED_C][i]};
+		s16 texColor[4] = {(s16)SpanTexColor[ALP_C][i], (s16)SpanTexColor[BLU_C][i], (s16)SpanTexColor[GRN_C][i], (s16)SpanTexColor[RED_C][i]};
+
+		if (!DepthAndFog(position, texColor, output))
+			continue;
+
+		// branchless bounding box update
+		BoundingBoxCoords[BoundingBox::LEFT] = std::min((u16)position[0], BoundingBoxCoords[BoundingBox::LEFT]);
+		BoundingBoxCoords[BoundingBox::RIGHT] = std::max((u16)position[0], BoundingBoxCoords[BoundingBox::RIGHT]);
+		BoundingBoxCoords[BoundingBox::TOP] = std::min((u16)position[1], BoundingBoxCoords[BoundingBox::TOP]);
+		BoundingBoxCoords[BoundingBox::BOTTOM] = std::max((u16)position[1], BoundingBoxCoords[BoundingBox::BOTTOM]);
+
+		PixelsOut++;
+		PerfPixels[PQ_BLEND_INPUT]++;
+
+		EfbInterface::BlendTev(position[0], position[1], output);
+	}
+}
+
+#else
+
+void Tev::DrawSpan(int count)
+{
+	DrawSpanScalar(count);
+}
+
+#endif
+
 void Tev::SetRegColor(int reg, int comp, bool konst, s16 color)
 {
 	if (konst)
@@ -816,7 +1290,7 @@ void Tev::SetRegColor(int reg, int comp, bool konst, s16 color)
 	}
 	else
 	{
-		Reg[reg][comp] = color;
+		InitialReg[reg][comp] = color;
 	}
 }
 
@@ -5,9 +5,21 @@
 #pragma once
 
 #include "VideoCommon/BPMemory.h"
+#include "VideoCommon/PerfQueryBase.h"
 
 class Tev
 {
+public:
+	struct TextureCoordinateType
+	{
+		signed s : 24;
+		signed t : 24;
+	};
+
+	// Number of pixels DrawSpan shades at once, a raster block
+	static constexpr int SPAN_SIZE = 4;
+
+private:
 	struct InputRegType
 	{
 		unsigned a : 8;
@@ -16,14 +28,9 @@ class Tev
 		signed   d : 11;
 	};
 
-	struct TextureCoordinateType
-	{
-		signed s : 24;
-		signed t : 24;
-	};
-
 	// color order: ABGR
 	s16 Reg[4][4];
+	s16 InitialReg[4][4];
 	s16 KonstantColors[4][4];
 	s16 TexColor[4];
 	s16 RasColor[4];
@@ -35,12 +42,25 @@ class Tev
 	u8 IndirectTex[4][4];
 	TextureCoordinateType TexCoord;
 
+	// DrawSpan's registers, stored as [component][pixel] so that one component of all the
+	// pixels of the span can be loaded into a vector at once
+	s32 SpanReg[4][4][SPAN_SIZE];
+	s32 SpanTexColor[4][SPAN_SIZE];
+	s32 SpanRasColor[4][SPAN_SIZE];
+	s32 SpanStageKonst[4][SPAN_SIZE];
+	s32 SpanFixedConstants[3][SPAN_SIZE]; // zero, half, one
+	u8 SpanAlphaBump[SPAN_SIZE];
+	u8 SpanIndirectTex[SPAN_SIZE][4][4];
+	TextureCoordinateType SpanTexCoord[SPAN_SIZE];
+
 	s16 *m_ColorInputLUT[16][3];
 	s16 *m_AlphaInputLUT[8];        // values must point to ABGR color
 	s16 *m_KonstLUT[32][4];
 	s16 m_BiasLUT[4];
 	u8 m_ScaleLShiftLUT[4];
 	u8 m_ScaleRShiftLUT[4];
+	s32 *m_SpanColorInputLUT[16][3];
+	s32 *m_SpanAlphaInputLUT[8];
 
 	// enumeration for color input LUT
 	enum
@@ -58,13 +78,18 @@ class Tev
 	};
 
 	void SetRasColor(int colorChan, int swaptable);
+	void SetSpanRasColor(int colorChan, int swaptable, int count);
 
 	void DrawColorRegular(TevStageCombiner::ColorCombiner& cc, const InputRegType inputs[4]);
 	void DrawColorCompare(TevStageCombiner::ColorCombiner& cc, const InputRegType inputs[4]);
 	void DrawAlphaRegular(TevStageCombiner::AlphaCombiner& ac, const InputRegType inputs[4]);
 	void DrawAlphaCompare(TevStageCombiner::AlphaCombiner& ac, const InputRegType inputs[4]);
 
-	void Indirect(unsigned int stageNum, s32 s, s32 t);
+	void Indirect(unsigned int stageNum, s32 s, s32 t, const u8 (*indirectTex)[4], TextureCoordinateType* texCoord, u8* alphaBump);
+
+	bool DepthAndFog(s32* position, const s16* texColor, u8* output);
+
+	void DrawSpanScalar(int count);
 
 public:
 	s32 Position[3];
@@ -75,6 +100,18 @@ public:
 	s32 TextureLod[16];
 	bool TextureLinear[16];
 
+	// Counted per Tev, the rasterizer adds them to the global counters since it
+	// may run several Tevs at once
+	u32 PixelsIn;
+	u32 PixelsOut;
+	u32 PerfPixels[PQ_NUM_MEMBERS];
+	u16 BoundingBoxCoords[4];
+
+	// Inputs of DrawSpan, the LODs are shared by all the pixels
+	s32 SpanPosition[SPAN_SIZE][3];
+	u8 SpanColor[SPAN_SIZE][2][4];
+	TextureCoordinateType SpanUv[SPAN_SIZE][8];
+
 	enum
 	{
 		ALP_C,
@@ -87,5 +124,10 @@ public:
 
 	void Draw();
 
+	// Shades the first count pixels of the span inputs, giving the same results as Draw
+	void DrawSpan(int count);
+
+	void ResetCounters();
+
 	void SetRegColor(int reg, int comp, bool konst, s16 color);
 };
@@ -59,51 +59,23 @@ static inline void AddTexel(u8 *inTexel, u32 *outTexel, u32 fract)
 	outTexel[3] += inTexel[3] * fract;
 }
 
-void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8 *sample)
+// Everything needed to fetch texels from one mip level, worked out once per level
+struct MipLevel
 {
-	int baseMip = 0;
-	bool mipLinear = false;
-
-#if (ALLOW_MIPMAP)
-	FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
-	TexMode0& tm0 = texUnit.texMode0[texmap & 3];
-
-	s32 lodFract = lod & 0xf;
-
-	if (lod > 0 && SamplerCommon::IsBpTexMode0MipmapsEnabled(tm0))
-	{
-		// use mipmap
-		baseMip = lod >> 4;
-		mipLinear = (lodFract && tm0.min_filter & 2);
-
-		// if using nearest mip filter and lodFract >= 0.5 round up to next mip
-		baseMip += (lodFract >> 3) & (tm0.min_filter & 1);
-	}
-
-	if (mipLinear)
-	{
-		u8 sampledTex[4];
-		u32 texel[4];
-
-		SampleMip(s, t, baseMip, linear, texmap, sampledTex);
-		SetTexel(sampledTex, texel, (16 - lodFract));
-
-		SampleMip(s, t, baseMip + 1, linear, texmap, sampledTex);
-		AddTexel(sampledTex, texel, lodFract);
-
-		sample[0] = (u8)(texel[0] >> 4);
-		sample[1] = (u8)(texel[1] >> 4);
-		sample[2] = (u8)(texel[2] >> 4);
-		sample[3] = (u8)(texel[3] >> 4);
-	}
-	else
-#endif
-	{
-		SampleMip(s, t, baseMip, linear, texmap, sample);
-	}
-}
-
-void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
+	const u8* imageSrc;
+	const u8* imageSrcOdd;
+	const u16* tlut;
+	TlutFormat tlutfmt;
+	u32 format;
+	int imageWidth;
+	int imageHeight;
+	int wrapS;
+	int wrapT;
+	int shift;
+	bool rgba8FromTmem;
+};
+
+static void SetupMip(MipLevel* level, s32 mip, u8 texmap)
 {
 	FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
 	u8 subTexmap = texmap & 3;
@@ -111,7 +83,7 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 	TexMode0& tm0 = texUnit.texMode0[subTexmap];
 	TexImage0& ti0 = texUnit.texImage0[subTexmap];
 	TexTLUT& texTlut = texUnit.texTlut[subTexmap];
-	TlutFormat tlutfmt = (TlutFormat)texTlut.tlut_format;
+	level->tlutfmt = (TlutFormat)texTlut.tlut_format;
 
 	u8 *imageSrc, *imageSrcOdd = nullptr;
 	if (texUnit.texImage1[subTexmap].image_type)
@@ -130,10 +102,11 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 	int imageHeight = ti0.height;
 
 	int tlutAddress = texTlut.tmem_offset << 9;
-	const u16* tlut = reinterpret_cast<const u16*>(&texMem[tlutAddress]);
+	level->tlut = reinterpret_cast<const u16*>(&texMem[tlutAddress]);
 
 	// reduce sample location and texture size to mip level
 	// move texture pointer to mip location
+	level->shift = mip;
 	if (mip)
 	{
 		int mipWidth = imageWidth + 1;
@@ -145,8 +118,6 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 
 		imageWidth >>= mip;
 		imageHeight >>= mip;
-		s >>= mip;
-		t >>= mip;
 
 		while (mip)
 		{
@@ -161,6 +132,32 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 		}
 	}
 
+	level->imageSrc = imageSrc;
+	level->imageSrcOdd = imageSrcOdd;
+	level->format = ti0.format;
+	level->imageWidth = imageWidth;
+	level->imageHeight = imageHeight;
+	level->wrapS = tm0.wrap_s;
+	level->wrapT = tm0.wrap_t;
+	level->rgba8FromTmem = ti0.format == GX_TF_RGBA8 && texUnit.texImage1[subTexmap].image_type;
+}
+
+static inline void DecodeTexel(const MipLevel& level, int s, int t, u8* texel)
+{
+	if (!level.rgba8FromTmem)
+		TexDecoder_DecodeTexel(texel, level.imageSrc, s, t, level.imageWidth, level.format, level.tlut, level.tlutfmt);
+	else
+		TexDecoder_DecodeTexelRGBA8FromTmem(texel, level.imageSrc, level.imageSrcOdd, s, t, level.imageWidth);
+}
+
+static void SampleLevel(const MipLevel& level, s32 s, s32 t, bool linear, u8 *sample)
+{
+	s >>= level.shift;
+	t >>= level.shift;
+
+	const int imageWidth = level.imageWidth;
+	const int imageHeight = level.imageHeight;
+
 	if (linear)
 	{
 		// offset linear sampling
@@ -181,39 +178,22 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 		u8 sampledTex[4];
 		u32 texel[4];
 
-		WrapCoord(&imageS, tm0.wrap_s, imageWidth);
-		WrapCoord(&imageT, tm0.wrap_t, imageHeight);
-		WrapCoord(&imageSPlus1, tm0.wrap_s, imageWidth);
-		WrapCoord(&imageTPlus1, tm0.wrap_t, imageHeight);
+		WrapCoord(&imageS, level.wrapS, imageWidth);
+		WrapCoord(&imageT, level.wrapT, imageHeight);
+		WrapCoord(&imageSPlus1, level.wrapS, imageWidth);
+		WrapCoord(&imageTPlus1, level.wrapT, imageHeight);
 
-		if (!(ti0.format == GX_TF_RGBA8 && texUnit.texImage1[subTexmap].image_type))
-		{
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageS, imageT, imageWidth, ti0.format, tlut, tlutfmt);
-			SetTexel(sampledTex, texel, (128 - fractS) * (128 - fractT));
-
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageSPlus1, imageT, imageWidth, ti0.format, tlut, tlutfmt);
-			AddTexel(sampledTex, texel, (fractS) * (128 - fractT));
-
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageS, imageTPlus1, imageWidth, ti0.format, tlut, tlutfmt);
-			AddTexel(sampledTex, texel, (128 - fractS) * (fractT));
-
-			TexDecoder_DecodeTexel(sampledTex, imageSrc, imageSPlus1, imageTPlus1, imageWidth, ti0.format, tlut, tlutfmt);
-			AddTexel(sampledTex, texel, (fractS) * (fractT));
-		}
-		else
-		{
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageS, imageT, imageWidth);
-			SetTexel(sampledTex, texel, (128 - fractS) * (128 - fractT));
+		DecodeTexel(level, imageS, imageT, sampledTex);
+		SetTexel(sampledTex, texel, (128 - fractS) * (128 - fractT));
 
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageSPlus1, imageT, imageWidth);
-			AddTexel(sampledTex, texel, (fractS) * (128 - fractT));
+		DecodeTexel(level, imageSPlus1, imageT, sampledTex);
+		AddTexel(sampledTex, texel, (fractS) * (128 - fractT));
 
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageS, imageTPlus1, imageWidth);
-			AddTexel(sampledTex, texel, (128 - fractS) * (fractT));
+		DecodeTexel(level, imageS, imageTPlus1, sampledTex);
+		AddTexel(sampledTex, texel, (128 - fractS) * (fractT));
 
-			TexDecoder_DecodeTexelRGBA8FromTmem(sampledTex, imageSrc, imageSrcOdd, imageSPlus1, imageTPlus1, imageWidth);
-			AddTexel(sampledTex, texel, (fractS) * (fractT));
-		}
+		DecodeTexel(level, imageSPlus1, imageTPlus1, sampledTex);
+		AddTexel(sampledTex, texel, (fractS) * (fractT));
 
 		sample[0] = (u8)(texel[0] >> 14);
 		sample[1] = (u8)(texel[1] >> 14);
@@ -227,14 +207,87 @@ void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
 		int imageT = t >> 7;
 
 		// nearest neighbor sampling
-		WrapCoord(&imageS, tm0.wrap_s, imageWidth);
-		WrapCoord(&imageT, tm0.wrap_t, imageHeight);
+		WrapCoord(&imageS, level.wrapS, imageWidth);
+		WrapCoord(&imageT, level.wrapT, imageHeight);
+
+		DecodeTexel(level, imageS, imageT, sample);
+	}
+}
+
+// Picks the mip level(s) to sample from, returns true when two levels are blended
+static bool SelectMip(s32 lod, u8 texmap, int* baseMip, s32* lodFract)
+{
+	*baseMip = 0;
+	*lodFract = 0;
+	bool mipLinear = false;
+
+#if (ALLOW_MIPMAP)
+	FourTexUnits& texUnit = bpmem.tex[(texmap >> 2) & 1];
+	TexMode0& tm0 = texUnit.texMode0[texmap & 3];
+
+	*lodFract = lod & 0xf;
+
+	if (lod > 0 && SamplerCommon::IsBpTexMode0MipmapsEnabled(tm0))
+	{
+		// use mipmap
+		*baseMip = lod >> 4;
+		mipLinear = (*lodFract && tm0.min_filter & 2);
 
-		if (!(ti0.format == GX_TF_RGBA8 && texUnit.texImage1[subTexmap].image_type))
-			TexDecoder_DecodeTexel(sample, imageSrc, imageS, imageT, imageWidth, ti0.format, tlut, tlutfmt);
-		else
-			TexDecoder_DecodeTexelRGBA8FromTmem(sample, imageSrc, imageSrcOdd, imageS, imageT, imageWidth);
+		// if using nearest mip filter and lodFract >= 0.5 round up to next mip
+		*baseMip += (*lodFract >> 3) & (tm0.min_filter & 1);
 	}
+#endif
+
+	return mipLinear;
+}
+
+void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8 *sample)
+{
+	SampleSpan(&s, &t, 1, lod, linear, texmap, reinterpret_cast<u8(*)[4]>(sample));
+}
+
+void SampleSpan(const s32* s, const s32* t, int count, s32 lod, bool linear, u8 texmap, u8 (*samples)[4])
+{
+	int baseMip;
+	s32 lodFract;
+	MipLevel level;
+
+	if (SelectMip(lod, texmap, &baseMip, &lodFract))
+	{
+		MipLevel nextLevel;
+		SetupMip(&level, baseMip, texmap);
+		SetupMip(&nextLevel, baseMip + 1, texmap);
+
+		for (int i = 0; i < count; i++)
+		{
+			u8 sampledTex[4];
+			u32 texel[4];
+
+			SampleLevel(level, s[i], t[i], linear, sampledTex);
+			SetTexel(sampledTex, texel, (16 - lodFract));
+
+			SampleLevel(nextLevel, s[i], t[i], linear, sampledTex);
+			AddTexel(sampledTex, texel, lodFract);
+
+			samples[i][0] = (u8)(texel[0] >> 4);
+			samples[i][1] = (u8)(texel[1] >> 4);
+			samples[i][2] = (u8)(texel[2] >> 4);
+			samples[i][3] = (u8)(texel[3] >> 4);
+		}
+	}
+	else
+	{
+		SetupMip(&level, baseMip, texmap);
+		for (int i = 0; i < count; i++)
+			SampleLevel(level, s[i], t[i], linear, samples[i]);
+	}
+}
+
+void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample)
+{
+	MipLevel level;
+	SetupMip(&level, mip, texmap);
+	SampleLevel(level, s, t, linear, sample);
 }
 
 }
@@ -12,6 +12,10 @@ void Sample(s32 s, s32 t, s32 lod, bool linear, u8 texmap, u8 *sample);
 
 void SampleMip(s32 s, s32 t, s32 mip, bool linear, u8 texmap, u8 *sample);
 
+// Samples count texels sharing one LOD, looking up the texture only once. Gives the same
+// texels as calling Sample for each of them.
+void SampleSpan(const s32* s, const s32* t, int count, s32 lod, bool linear, u8 texmap, u8 (*samples)[4]);
+
 enum
 {
 	RED_SMP,
@@ -6,8 +6,13 @@
 #define __STDC_CONSTANT_MACROS 1
 #endif
 
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -20,6 +25,7 @@ extern "C" {
 #include "Common/Logging/Log.h"
 #include "Common/MsgHandler.h"
 #include "Common/StringUtil.h"
+#include "Common/Thread.h"
 
 #include "Core/ConfigManager.h"
 #include "Core/HW/SystemTimers.h"
@@ -45,10 +51,7 @@ extern std::unique_ptr<SlippiPlaybackStatus> g_playbackStatus;
 static AVFormatContext* s_format_context = nullptr;
 static AVStream* s_stream = nullptr;
 static AVCodecContext* s_codec_context = nullptr;
-static AVFrame* s_src_frame = nullptr;
-static AVFrame* s_scaled_frame = nullptr;
 static AVPixelFormat s_pix_fmt = AV_PIX_FMT_BGR24;
-static SwsContext* s_sws_context = nullptr;
 static int s_width;
 static int s_height;
 static u64 s_last_frame;
@@ -59,6 +62,40 @@ static int s_file_index = 0;
 static int s_savestate_index = 0;
 static int s_last_savestate_index = 0;
 
+// AddFrame only copies frames into a ring of buffers. Colour conversion runs on a few worker
+// threads, and one more thread encodes and writes the converted frames in order. When the ring
+// is full, AddFrame waits for the encoder, so at most FRAME_RING_SIZE frames are in flight.
+static const int FRAME_RING_SIZE = 8;
+static const int FRAME_CONVERT_THREADS = 2;
+
+struct FrameSlot
+{
+	// Kept between frames, they all have the same size until the resolution changes
+	std::vector<u8> data;
+	AVFrame* scaled_frame = nullptr;
+	int width = 0;
+	int height = 0;
+	s64 pts = 0;
+	// The frame had no valid size, the last one is encoded again
+	bool repeat = false;
+	bool converted = false;
+};
+
+static FrameSlot s_ring[FRAME_RING_SIZE];
+// Sequence numbers of the next frame to queue, to convert and to encode
+static u64 s_ring_write = 0;
+static u64 s_ring_convert = 0;
+static u64 s_ring_encode = 0;
+static bool s_ring_exit = false;
+static std::mutex s_ring_lock;
+static std::condition_variable s_ring_changed;
+static std::vector<std::thread> s_convert_threads;
+static std::thread s_encode_thread;
+
+static bool StartPipeline();
+static void StopPipeline();
+static void FreePipeline();
+
 static void InitAVCodec()
 {
 	static bool first_run = true;
@@ -209,21 +246,6 @@ bool AVIDump::CreateVideoFile()
 		return false;
 	}
 
-	s_src_frame = av_frame_alloc();
-	s_scaled_frame = av_frame_alloc();
-
-	s_scaled_frame->format = s_codec_context->pix_fmt;
-	s_scaled_frame->width = s_width;
-	s_scaled_frame->height = s_height;
-
-#if LIBAVCODEC_VERSION_MAJOR >= 55
-	if (av_frame_get_buffer(s_scaled_frame, 1))
-		return false;
-#else
-	if (avcodec_default_get_buffer(s_codec_context, s_scaled_frame))
-		return false;
-#endif
-
 	if (!(s_stream = avformat_new_stream(s_format_context, codec)) ||
 		!AVStreamCopyContext(s_stream, s_codec_context))
 	{
@@ -239,6 +261,12 @@ bool AVIDump::CreateVideoFile()
 		return false;
 	}
 
+	if (!StartPipeline())
+	{
+		ERROR_LOG(VIDEO, "Could not allocate frames");
+		return false;
+	}
+
 	OSD::AddMessage(StringFromFormat("Dumping Frames to \"%s\" (%dx%d)", s_format_context->filename,
 		s_width, s_height));
 
@@ -302,6 +330,174 @@ static void WritePacket(AVPacket& pkt)
 	av_interleaved_write_frame(s_format_context, &pkt);
 }
 
+static void ConvertFrames()
+{
+	Common::SetCurrentThreadName("FrameDumpConvert");
+	SwsContext* sws_context = nullptr;
+
+	std::unique_lock<std::mutex> lk(s_ring_lock);
+	while (true)
+	{
+		s_ring_changed.wait(lk, [] { return s_ring_exit || s_ring_convert < s_ring_write; });
+		if (s_ring_convert == s_ring_write)
+			break;
+
+		FrameSlot& slot = s_ring[s_ring_convert++ % FRAME_RING_SIZE];
+		lk.unlock();
+
+		// The encoder may still hold a reference to the last frame in this buffer
+		if (!slot.repeat && av_frame_make_writable(slot.scaled_frame) >= 0)
+		{
+			// Convert image from {BGRA, RGBA} to desired pixel format
+			if ((sws_context = sws_getCachedContext(sws_context, slot.width, slot.height, s_pix_fmt,
+				s_width, s_height, s_codec_context->pix_fmt, SWS_BICUBIC, nullptr, nullptr, nullptr)))
+			{
+				const u8* src_data[4] = { slot.data.data(), nullptr, nullptr, nullptr };
+				int src_linesize[4] = { slot.width * 4, 0, 0, 0 };
+				sws_scale(sws_context, src_data, src_linesize, 0, slot.height,
+					slot.scaled_frame->data, slot.scaled_frame->linesize);
+			}
+		}
+
+		lk.lock();
+		slot.converted = true;
+		s_ring_changed.notify_all();
+	}
+
+	if (sws_context)
+		sws_freeContext(sws_context);
+}
+
+static void EncodeFrames()
+{
+	Common::SetCurrentThreadName("FrameDumpEncode");
+	// Frames without a valid size repeat this one
+	AVFrame* last_frame = av_frame_alloc();
+
+	std::unique_lock<std::mutex> lk(s_ring_lock);
+	while (true)
+	{
+		s_ring_changed.wait(lk, [] {
+			return (s_ring_exit && s_ring_encode == s_ring_write) ||
+				(s_ring_encode < s_ring_write && s_ring[s_ring_encode % FRAME_RING_SIZE].converted);
+		});
+		if (s_ring_encode == s_ring_write)
+			break;
+
+		FrameSlot& slot = s_ring[s_ring_encode % FRAME_RING_SIZE];
+		lk.unlock();
+
+		AVFrame* frame = slot.scaled_frame;
+		if (slot.repeat)
+			frame = last_frame;
+		frame->pts = slot.pts;
+
+		// Encode and write the image.
+		AVPacket pkt;
+		PreparePacket(&pkt);
+		int got_packet = 0;
+		int error = 0;
+		if (frame->buf[0])
+			error = SendFrameAndReceivePacket(s_codec_context, &pkt, frame, &got_packet);
+		if (!error && got_packet)
+		{
+			WritePacket(pkt);
+		}
+		if (error)
+			ERROR_LOG(VIDEO, "Error while encoding video: %d", error);
+
+		if (!slot.repeat)
+		{
+			av_frame_unref(last_frame);
+			av_frame_ref(last_frame, slot.scaled_frame);
+		}
+
+		lk.lock();
+		slot.converted = false;
+		s_ring_encode++;
+		s_ring_changed.notify_all();
+	}
+
+	av_frame_free(&last_frame);
+}
+
+static bool StartPipeline()
+{
+	for (FrameSlot& slot : s_ring)
+	{
+		slot.scaled_frame = av_frame_alloc();
+		slot.scaled_frame->format = s_codec_context->pix_fmt;
+		slot.scaled_frame->width = s_width;
+		slot.scaled_frame->height = s_height;
+
+#if LIBAVCODEC_VERSION_MAJOR >= 55
+		if (av_frame_get_buffer(slot.scaled_frame, 1))
+			return false;
+#else
+		if (avcodec_default_get_buffer(s_codec_context, slot.scaled_frame))
+			return false;
+#endif
+	}
+
+	s_ring_write = s_ring_convert = s_ring_encode = 0;
+	s_ring_exit = false;
+	for (int i = 0; i < FRAME_CONVERT_THREADS; i++)
+		s_convert_threads.emplace_back(ConvertFrames);
+	s_encode_thread = std::thread(EncodeFrames);
+	return true;
+}
+
+// Waits for the queued frames to be written
+static void StopPipeline()
+{
+	{
+		std::lock_guard<std::mutex> lk(s_ring_lock);
+		s_ring_exit = true;
+	}
+	s_ring_changed.notify_all();
+
+	for (std::thread& thread : s_convert_threads)
+		thread.join();
+	s_convert_threads.clear();
+	if (s_encode_thread.joinable())
+		s_encode_thread.join();
+}
+
+static void FreePipeline()
+{
+	for (FrameSlot& slot : s_ring)
+	{
+		av_frame_free(&slot.scaled_frame);
+		slot.data.clear();
+		slot.data.shrink_to_fit();
+	}
+}
+
+static void QueueFrame(const u8* data, int width, int height, int stride, s64 pts)
+{
+	std::unique_lock<std::mutex> lk(s_ring_lock);
+	s_ring_changed.wait(lk, [] { return s_ring_write - s_ring_encode < FRAME_RING_SIZE; });
+	FrameSlot& slot = s_ring[s_ring_write % FRAME_RING_SIZE];
+	lk.unlock();
+
+	// The caller's buffer is reused as soon as this returns
+	slot.pts = pts;
+	slot.repeat = width <= 0 || height <= 0;
+	if (!slot.repeat)
+	{
+		const size_t row_size = width * 4;
+		slot.width = width;
+		slot.height = height;
+		slot.data.resize(row_size * height);
+		for (int y = 0; y < height; y++)
+			memcpy(&slot.data[y * row_size], data + (s64)y * stride, row_size);
+	}
+
+	lk.lock();
+	s_ring_write++;
+	s_ring_changed.notify_all();
+}
+
 void AVIDump::AddFrame(const u8* data, int width, int height, int stride, const Frame& state)
 {
 #ifdef IS_PLAYBACK
@@ -320,26 +516,9 @@ void AVIDump::AddFrame(const u8* data, int width, int height, int stride, const
 	}
 
 	CheckResolution(width, height);
-	s_src_frame->data[0] = const_cast<u8*>(data);
-	s_src_frame->linesize[0] = stride;
-	s_src_frame->format = s_pix_fmt;
-	s_src_frame->width = s_width;
-	s_src_frame->height = s_height;
-
-	// Convert image from {BGR24, RGBA} to desired pixel format
-	if ((s_sws_context =
-		sws_getCachedContext(s_sws_context, width, height, s_pix_fmt, s_width, s_height,
-			s_codec_context->pix_fmt, SWS_BICUBIC, nullptr, nullptr, nullptr)))
-	{
-		sws_scale(s_sws_context, s_src_frame->data, s_src_frame->linesize, 0, height,
-			s_scaled_frame->data, s_scaled_frame->linesize);
-	}
+	if (!s_codec_context)
+		return;
 
-	// Encode and write the image.
-	AVPacket pkt;
-	PreparePacket(&pkt);
-	int got_packet = 0;
-	int error = 0;
 	u64 delta;
 	s64 last_pts;
 	// Check to see if the first frame being dumped is the first frame of output from the emulator.
@@ -362,19 +541,13 @@ void AVIDump::AddFrame(const u8* data, int width, int height, int stride, const
 		last_pts = (s_last_pts * s_codec_context->time_base.den) / state.ticks_per_second;
 	}
 	u64 pts_in_ticks = s_last_pts + delta;
-	s_scaled_frame->pts = (pts_in_ticks * s_codec_context->time_base.den) / state.ticks_per_second;
-	if (s_scaled_frame->pts != last_pts)
+	s64 pts = (pts_in_ticks * s_codec_context->time_base.den) / state.ticks_per_second;
+	if (pts != last_pts)
 	{
 		s_last_frame = state.ticks;
 		s_last_pts = pts_in_ticks;
-		error = SendFrameAndReceivePacket(s_codec_context, &pkt, s_scaled_frame, &got_packet);
-	}
-	if (!error && got_packet)
-	{
-		WritePacket(pkt);
+		QueueFrame(data, width, height, stride, pts);
 	}
-	if (error)
-		ERROR_LOG(VIDEO, "Error while encoding video: %d", error);
 }
 
 static void HandleDelayedPackets()
@@ -401,7 +574,11 @@ static void HandleDelayedPackets()
 
 void AVIDump::Stop()
 {
-	HandleDelayedPackets();
+	if (s_codec_context)
+	{
+		StopPipeline();
+		HandleDelayedPackets();
+	}
 	av_write_trailer(s_format_context);
 	CloseVideoFile();
 	s_file_index = 0;
@@ -411,8 +588,8 @@ void AVIDump::Stop()
 
 void AVIDump::CloseVideoFile()
 {
-	av_frame_free(&s_src_frame);
-	av_frame_free(&s_scaled_frame);
+	StopPipeline();
+	FreePipeline();
 
 	avcodec_free_context(&s_codec_context);
 
@@ -422,12 +599,6 @@ void AVIDump::CloseVideoFile()
 	}
 	avformat_free_context(s_format_context);
 	s_format_context = nullptr;
-
-	if (s_sws_context)
-	{
-		sws_freeContext(s_sws_context);
-		s_sws_context = nullptr;
-	}
 }
 
 void AVIDump::DoState()
@@ -4,6 +4,7 @@
 
 #include "Common/Common.h"
 #include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/VertexShaderManager.h"
 
 // CP state
@@ -25,6 +26,7 @@ void DoCPState(PointerWrap& p)
 	{
 		CopyPreprocessCPStateFromMain();
 		g_main_cp_state.bases_dirty = true;
+		IncrementCheckContextId();
 	}
 }
 
@@ -54,6 +56,8 @@ void LoadCPReg(u32 sub_cmd, u32 value)
 		state->vtx_desc.Hex |= value;
 		state->attr_dirty = 0xFF;
 		state->bases_dirty = true;
+		if (!is_preprocess)
+			IncrementCheckContextId();
 		break;
 
 	case 0x60:
@@ -61,24 +65,32 @@ void LoadCPReg(u32 sub_cmd, u32 value)
 		state->vtx_desc.Hex |= (u64)value << 17;
 		state->attr_dirty = 0xFF;
 		state->bases_dirty = true;
+		if (!is_preprocess)
+			IncrementCheckContextId();
 		break;
 
 	case 0x70:
 		_assert_((sub_cmd & 0x0F) < 8);
 		state->vtx_attr[sub_cmd & 7].g0.Hex = value;
 		state->attr_dirty |= 1 << (sub_cmd & 7);
+		if (!is_preprocess)
+			IncrementCheckContextId();
 		break;
 
 	case 0x80:
 		_assert_((sub_cmd & 0x0F) < 8);
 		state->vtx_attr[sub_cmd & 7].g1.Hex = value;
 		state->attr_dirty |= 1 << (sub_cmd & 7);
+		if (!is_preprocess)
+			IncrementCheckContextId();
 		break;
 
 	case 0x90:
 		_assert_((sub_cmd & 0x0F) < 8);
 		state->vtx_attr[sub_cmd & 7].g2.Hex = value;
 		state->attr_dirty |= 1 << (sub_cmd & 7);
+		if (!is_preprocess)
+			IncrementCheckContextId();
 		break;
 
 		// Pointers to vertex arrays in GC RAM
@@ -0,0 +1,39 @@
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#pragma once
+
+#include "Common/CommonTypes.h"
+
+struct VertexLoaderParameters;
+
+// Display list cache. A display list called again with the same contents and the same
+// vertex format state replays its draws from the vertex data converted the last time,
+// instead of running the vertex loaders over it again. Everything else in the list
+// (BP, CP and XF loads) is still decoded on every call.
+namespace DLCache
+{
+
+void Init();
+void Shutdown();
+void Clear();
+
+// Called once per frame, drops lists that have not been called for a while
+void ProgressiveCleanup();
+
+// True while a display list is decoded for the first time after a change
+bool IsRecording();
+
+// Called by the opcode decoder after every converted draw while recording.
+// The converted vertices are still at the vertex manager's current buffer pointer.
+void RecordDraw(const u8* opcode_start, const VertexLoaderParameters& parameters, u32 readsize, u32 writesize);
+
+}  // namespace
+
+// NOTE - outside the namespace on purpose.
+// Returns false if the list was not handled and must be interpreted by the caller
+bool HandleDisplayList(u32 address, u32 size, u32* cycles);
+
+// Called when the vertex format state changes, forces the next cached list to check it
+void IncrementCheckContextId();
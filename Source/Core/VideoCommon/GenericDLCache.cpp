@@ -1,52 +1,314 @@
-// Copyright (C) 2003-2009 Dolphin Project.
+// Copyright 2013 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
 
-// This program is free software: you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation, version 2.0.
+// A list is recorded on its second call with the same contents, the first one only stores
+// its hash so lists rebuilt every frame never pay for the recording. Draws are replayed
+// only when they read all their attributes from the list itself: indexed attributes
+// depend on vertex arrays that the list hash does not cover.
 
-// This program is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License 2.0 for more details.
+#include <cstring>
+#include <unordered_map>
+#include <vector>
 
-// A copy of the GPL 2.0 should have been included with the program.
-// If not, see http://www.gnu.org/licenses/
+#include "Common/CommonTypes.h"
+#include "Common/Hash.h"
+#include "Core/HW/Memmap.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/BoundingBox.h"
+#include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DataReader.h"
+#include "VideoCommon/DLCache.h"
+#include "VideoCommon/Fifo.h"
+#include "VideoCommon/OpcodeDecoding.h"
+#include "VideoCommon/RenderBase.h"
+#include "VideoCommon/Statistics.h"
+#include "VideoCommon/VertexLoaderBase.h"
+#include "VideoCommon/VertexLoaderManager.h"
+#include "VideoCommon/VertexManagerBase.h"
+#include "VideoCommon/VideoCommon.h"
+#include "VideoCommon/VideoConfig.h"
+#include "VideoCommon/XFMemory.h"
 
-// Official SVN repository and contact information can be found at
-// http://code.google.com/p/dolphin-emu/
+namespace DLCache
+{
+
+// Lists not called for this many frames are dropped
+static const int MAX_UNUSED_FRAMES = 300;
+static const int CLEANUP_INTERVAL = 60;
+// Converted vertex data kept for all lists, new lists are not recorded past it
+static const size_t MAX_CACHED_VERTEX_BYTES = 64 * 1024 * 1024;
 
-// TODO: Handle cache-is-full condition :p
+struct CachedDraw
+{
+	// Range of the draw command in the list
+	u32 opcode_start;
+	u32 opcode_end;
+	int vtx_attr_group;
+	int primitive;
+	NativeVertexFormat* format;
+	u32 components;
+	u32 stride;
+	u32 count;
+	// Offset of the converted vertices in the list's vertex data
+	u32 data_offset;
+};
 
+struct CachedDisplayList
+{
+	u64 hash = 0;
+	u64 context_hash = 0;
+	u32 context_id = 0;
+	u32 cycles = 0;
+	int last_frame = 0;
+	bool seen = false;
+	bool recorded = false;
+	// Not cacheable until its contents change
+	bool failed = false;
+	std::vector<CachedDraw> draws;
+	std::vector<u8> vertices;
+};
 
-#include "Common.h"
-#include "DLCache.h"
+static std::unordered_map<u64, CachedDisplayList> s_cache;
+static size_t s_cached_vertex_bytes = 0;
+static u32 s_check_context_id = 1;
+static int s_last_cleanup_frame = 0;
 
-namespace DLCache
+// List being recorded, if any
+static CachedDisplayList* s_recording = nullptr;
+static const u8* s_record_start = nullptr;
+static const u8* s_record_end = nullptr;
+static bool s_record_failed = false;
+
+// Everything the converted vertices of a draw without indexed attributes depend on,
+// besides the list itself
+static u64 ComputeContextHash()
 {
+	u32 context[4 + 8 * 3];
+	context[0] = g_main_cp_state.matrix_index_a.Hex;
+	context[1] = g_main_cp_state.matrix_index_b.Hex;
+	context[2] = g_main_cp_state.vtx_desc.Hex0;
+	context[3] = g_main_cp_state.vtx_desc.Hex1;
+	for (int i = 0; i < 8; i++)
+	{
+		context[4 + i * 3] = g_main_cp_state.vtx_attr[i].g0.Hex;
+		context[5 + i * 3] = g_main_cp_state.vtx_attr[i].g1.Hex;
+		context[6 + i * 3] = g_main_cp_state.vtx_attr[i].g2.Hex;
+	}
+	return GetHash64(reinterpret_cast<const u8*>(context), sizeof(context), 0);
+}
+
+static void ResetList(CachedDisplayList& list)
+{
+	s_cached_vertex_bytes -= list.vertices.size();
+	list.recorded = false;
+	list.failed = false;
+	list.draws.clear();
+	list.vertices.clear();
+	list.vertices.shrink_to_fit();
+}
+
+// Decodes part of a list like OpcodeDecoder::InterpretDisplayList
+static u32 RunCommands(u8* start, u8* end)
+{
+	u32 cycles = 0;
+	u8* old_pVideoData = g_VideoData.GetReadPosition();
+	u8* old_pVideoDataEnd = g_VideoData.GetEnd();
+	g_VideoData.SetReadPosition(start, end);
+	OpcodeDecoder::Run<false, false>(g_VideoData, &cycles);
+	g_VideoData.SetReadPosition(old_pVideoData, old_pVideoDataEnd);
+	return cycles;
+}
+
+static void ReplayDraw(const CachedDisplayList& list, const CachedDraw& draw)
+{
+	bool skip_draw = xfmem.viewport.wd == 0.0f
+		|| xfmem.viewport.ht == 0.0f
+		|| (bpmem.scissorBR.x + 1 - bpmem.scissorTL.x) == 0
+		|| (bpmem.scissorBR.y + 1 - bpmem.scissorTL.y) == 0;
+	if (skip_draw)
+		return;
+	VertexLoaderManager::AddCachedVertices(draw.vtx_attr_group, draw.primitive, draw.format,
+		draw.components, draw.stride, &list.vertices[draw.data_offset], draw.count);
+}
+
+static void Record(CachedDisplayList& list, u8* start, u32 size)
+{
+	ResetList(list);
+	s_recording = &list;
+	s_record_start = start;
+	s_record_end = start + size;
+	s_record_failed = false;
+
+	list.cycles = RunCommands(start, start + size);
+
+	s_recording = nullptr;
+	if (s_record_failed || s_cached_vertex_bytes + list.vertices.size() > MAX_CACHED_VERTEX_BYTES)
+	{
+		list.draws.clear();
+		list.vertices.clear();
+		list.vertices.shrink_to_fit();
+		list.failed = true;
+		return;
+	}
+	s_cached_vertex_bytes += list.vertices.size();
+	list.recorded = true;
+}
+
+static void Replay(const CachedDisplayList& list, u8* start, u32 size)
+{
+	// State commands between the cached draws are decoded from the list as usual
+	u32 offset = 0;
+	for (const CachedDraw& draw : list.draws)
+	{
+		if (draw.opcode_start > offset)
+			RunCommands(start + offset, start + draw.opcode_start);
+		ReplayDraw(list, draw);
+		offset = draw.opcode_end;
+	}
+	if (offset < size)
+		RunCommands(start + offset, start + size);
+}
 
 void Init()
 {
+	Clear();
 }
 
 void Shutdown()
 {
+	Clear();
 }
 
-void Clear() 
+void Clear()
 {
+	s_cache.clear();
+	s_cached_vertex_bytes = 0;
+	s_last_cleanup_frame = frameCount;
+	IncrementCheckContextId();
 }
 
 void ProgressiveCleanup()
 {
+	if (frameCount - s_last_cleanup_frame < CLEANUP_INTERVAL)
+		return;
+	s_last_cleanup_frame = frameCount;
+
+	for (auto it = s_cache.begin(); it != s_cache.end();)
+	{
+		if (frameCount - it->second.last_frame > MAX_UNUSED_FRAMES)
+		{
+			s_cached_vertex_bytes -= it->second.vertices.size();
+			it = s_cache.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+bool IsRecording()
+{
+	return s_recording != nullptr;
+}
+
+void RecordDraw(const u8* opcode_start, const VertexLoaderParameters& parameters, u32 readsize, u32 writesize)
+{
+	// Draws of nested lists belong to them, skipped draws have no converted vertices
+	if (opcode_start < s_record_start || opcode_start >= s_record_end || parameters.skip_draw || !writesize)
+		return;
+	for (int i = 0; i < 12; i++)
+	{
+		if (parameters.VtxDesc->GetVertexArrayStatus(i) >= 0x2)
+			return;
+	}
+
+	NativeVertexFormat* format = VertexLoaderManager::GetCurrentVertexFormat();
+	CachedDraw draw;
+	draw.opcode_start = u32(opcode_start - s_record_start);
+	// Command byte and vertex count
+	draw.opcode_end = draw.opcode_start + 1 + GX_DRAW_PRIMITIVES_SIZE + readsize;
+	draw.vtx_attr_group = parameters.vtx_attr_group;
+	draw.primitive = parameters.primitive;
+	draw.format = format;
+	draw.components = VertexLoaderManager::g_current_components;
+	draw.stride = format->GetVertexStride();
+	draw.count = writesize / draw.stride;
+	draw.data_offset = u32(s_recording->vertices.size());
+	s_recording->draws.push_back(draw);
+
+	const u8* vertices = g_vertex_manager->GetCurrentBufferPointer();
+	s_recording->vertices.insert(s_recording->vertices.end(), vertices, vertices + writesize);
 }
+
 }  // namespace
 
 // NOTE - outside the namespace on purpose.
-bool HandleDisplayList(u32 address, u32 size)
+bool HandleDisplayList(u32 address, u32 size, u32* cycles)
 {
-	return false;
+	using namespace DLCache;
+
+	if (!g_ActiveConfig.bDisplayListCache || g_ActiveConfig.backend_info.APIType == API_NONE)
+		return false;
+	// The deterministic GPU thread reads lists from its own copies, the FIFO recorder
+	// and the CPU bounding box need every vertex to go through the loaders
+	if (Fifo::UseDeterministicGPUThread() || g_bRecordFifoData
+		|| (g_ActiveConfig.iBBoxMode == BBoxCPU && BoundingBox::active))
+		return false;
+	// Nested lists are decoded normally and keep the outer list from being cached
+	if (s_recording)
+	{
+		s_record_failed = true;
+		return false;
+	}
+
+	u8* start = Memory::GetPointer(address);
+	if (start == nullptr || size == 0)
+		return false;
+
+	CachedDisplayList& list = s_cache[(u64(address) << 32) | size];
+	list.last_frame = frameCount;
+
+	u64 hash = GetHash64(start, size, 0);
+	if (!list.seen || list.hash != hash)
+	{
+		ResetList(list);
+		list.seen = true;
+		list.hash = hash;
+		return false;
+	}
+	if (list.failed)
+		return false;
+
+	u32 context_id = s_check_context_id;
+	if (!list.recorded || list.context_id != context_id)
+	{
+		u64 context_hash = ComputeContextHash();
+		if (!list.recorded || list.context_hash != context_hash)
+		{
+			// temporarily swap dl and non-dl (small "hack" for the stats)
+			Statistics::SwapDL();
+			Record(list, start, size);
+			INCSTAT(stats.thisFrame.numDListsCalled);
+			Statistics::SwapDL();
+			list.context_hash = context_hash;
+			list.context_id = context_id;
+			*cycles = list.cycles;
+			return true;
+		}
+		list.context_id = context_id;
+	}
+
+	Statistics::SwapDL();
+	Replay(list, start, size);
+	INCSTAT(stats.thisFrame.numDListsCalled);
+	Statistics::SwapDL();
+	*cycles = list.cycles;
+	return true;
 }
 
 void IncrementCheckContextId()
 {
+	DLCache::s_check_context_id++;
 }
@@ -15,6 +15,7 @@
 #include "VideoCommon/BoundingBox.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/CommandProcessor.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/GeometryShaderManager.h"
 #include "VideoCommon/TessellationShaderManager.h"
@@ -220,6 +221,7 @@ void VideoBackendBase::InitializeShared()
 	PixelEngine::Init();
 	BPInit();
 	VertexLoaderManager::Init();
+	DLCache::Init();
 	IndexGenerator::Init();
 	VertexShaderManager::Init();
 	GeometryShaderManager::Init();
@@ -249,6 +251,7 @@ void VideoBackendBase::ShutdownShared()
 
 void VideoBackendBase::CleanupShared()
 {
+	DLCache::Shutdown();
 	VertexLoaderManager::Shutdown();
 }
 
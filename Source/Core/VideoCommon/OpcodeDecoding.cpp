@@ -21,6 +21,7 @@
 #include "VideoCommon/CommandProcessor.h"
 #include "VideoCommon/CPMemory.h"
 #include "VideoCommon/DataReader.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/Fifo.h"
 #include "VideoCommon/OpcodeDecoding.h"
 #include "VideoCommon/Statistics.h"
@@ -43,6 +44,10 @@ __forceinline void ReadU32xn(u32 *bufx16)
 
 __forceinline u32 InterpretDisplayList(u32 address, u32 size)
 {
+	u32 cycles = 0;
+	if (HandleDisplayList(address, size, &cycles))
+		return cycles;
+
 	u8* startAddress;
 
 	if (Fifo::UseDeterministicGPUThread())
@@ -50,8 +55,6 @@ __forceinline u32 InterpretDisplayList(u32 address, u32 size)
 	else
 		startAddress = static_cast<u8*>(Memory::GetPointer(address));
 
-	u32 cycles = 0;
-
 	// Avoid the crash if Memory::GetPointer failed ..
 	if (startAddress != nullptr)
 	{
@@ -325,6 +328,8 @@ u8* Run(DataReader& reader, u32* cycles)
 						if (VertexLoaderManager::ConvertVertices(parameters, readsize, writesize))
 						{
 							totalCycles += GX_NOP_CYCLES + GX_DRAW_PRIMITIVES_CYCLES * parameters.count;
+							if (DLCache::IsRecording())
+								DLCache::RecordDraw(opcodeStart, parameters, readsize, writesize);
 							reader.ReadSkip(readsize);
 							g_vertex_manager->IncCurrentBufferPointer(writesize);
 						}
@@ -29,12 +29,24 @@ public:
 	~TextureScaler();
 
 	u32* Scale(u32* data, int width, int height);
+	// Scales with these settings instead of the active config
+	u32* Scale(u32* data, int width, int height, int type, int factor, bool deposterize);
 
 	enum
 	{
 		NONE = 0, XBRZ = 1, HYBRID = 2, BICUBIC = 3, HYBRID_BICUBIC = 4, JINC = 5, JINC_SHARPER = 6, SMOOTHSTEP = 7, THREE_POINT = 8, DDT = 9, DDT_SHARP = 10
 	};
 
+	// Instruction sets the filters can use. The SIMD versions round like the scalar ones, so
+	// every filter gives the same output bit for bit on all of them.
+	// The best one the CPU supports is used unless another one is set.
+	enum class SIMD
+	{
+		Scalar, SSE41, AVX2
+	};
+	static SIMD GetBestSIMD();
+	void SetSIMD(SIMD simd) { m_simd = simd; }
+
 private:
 
 	void ScaleXBRZ(int factor, u32* source, u32* dest, int width, int height);
@@ -57,4 +69,6 @@ private:
 	// maximum is (100 MB total for a 512 by 512 texture with scaling factor 5 and hybrid scaling)
 	// of course, scaling factor 5 is totally silly anyway
 	Common::SimpleBuf<u32> bufInput, bufDeposter, bufOutput, bufTmp1, bufTmp2, bufTmp3;
+
+	SIMD m_simd;
 };
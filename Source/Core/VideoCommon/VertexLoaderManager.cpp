@@ -3,14 +3,19 @@
 // Refer to the license.txt file included.
 // Modified for Ishiiruka by Tino
 
+#include <algorithm>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 
 #include "Core/ConfigManager.h"
 #include "Core/HW/Memmap.h"
 
+#include "Common/FileUtil.h"
+#include "Common/LinearDiskCache.h"
 #include "Common/ThreadPool.h"
 #include "Common/StringUtil.h"
 
@@ -30,6 +35,8 @@ typedef std::unordered_map<VertexLoaderUID, std::unique_ptr<VertexLoaderBase>> V
 namespace VertexLoaderManager
 {
 static VertexLoaderMap s_vertex_loader_map;
+// Vertex formats the game used in previous runs and how many vertices each one loaded
+static std::map<VertexLoaderUID, u64> s_loader_profile;
 static NativeVertexFormatMap s_native_vertex_map;
 static NativeVertexFormat* s_current_vtx_fmt;
 u32 g_current_components;
@@ -70,6 +77,131 @@ struct codeentry
 };
 }
 
+// Loader profile cache. Keeps the hottest vertex formats of each game so that their loaders are
+// compiled at boot instead of on the first draw using them, like the precompiled G_*_pvt tables
+// do for the games that have one.
+static const size_t LOADER_PROFILE_MAX_ENTRIES = 256;
+
+namespace
+{
+struct LoaderProfileKey
+{
+	u32 vid[4];
+};
+
+// The inverse of VertexLoaderUID. Bits the uid masks off come back as zero, which gives a loader
+// with the same uid
+void DecodeLoaderProfileKey(const LoaderProfileKey& key, TVtxDesc* desc, VAT* vat)
+{
+	desc->Hex = ((u64)key.vid[0] << 1) | (key.vid[2] >> 31);
+	vat->g0.Hex = key.vid[1];
+	vat->g1.Hex = key.vid[2] & 0x7FFFFFFFu;
+	vat->g2.Hex = key.vid[3];
+}
+
+class LoaderProfileReader : public LinearDiskCacheReader<LoaderProfileKey, u64>
+{
+public:
+	void Read(const LoaderProfileKey& key, const u64* value, u32 value_size) override
+	{
+		if (value_size != 1)
+			return;
+
+		TVtxDesc desc;
+		VAT vat;
+		DecodeLoaderProfileKey(key, &desc, &vat);
+
+		// Skip entries from a uid layout that doesn't round trip anymore
+		VertexLoaderUID uid(desc, vat);
+		for (u32 i = 0; i < 4; i++)
+		{
+			if (uid.GetElement(i) != key.vid[i])
+				return;
+		}
+
+		s_loader_profile[uid] += *value;
+	}
+};
+}
+
+static std::string GetLoaderProfileFilename()
+{
+	return StringFromFormat("%sIVL-%s.cache", File::GetUserPath(D_CACHE_IDX).c_str(), last_game_code.c_str());
+}
+
+static void LoadLoaderProfile()
+{
+	s_loader_profile.clear();
+	if (last_game_code.empty())
+		return;
+
+	LinearDiskCache<LoaderProfileKey, u64> cache;
+	LoaderProfileReader reader;
+	cache.OpenAndRead(GetLoaderProfileFilename(), reader);
+	cache.Close();
+
+	// Only the loaders are created here. Native vertex formats need the backend's vertex manager,
+	// which doesn't exist yet, so GetOrAddLoader fills them in on first use
+	for (const auto& entry : s_loader_profile)
+	{
+		LoaderProfileKey key;
+		for (u32 i = 0; i < 4; i++)
+			key.vid[i] = entry.first.GetElement(i);
+
+		TVtxDesc desc;
+		VAT vat;
+		DecodeLoaderProfileKey(key, &desc, &vat);
+		s_vertex_loader_map[entry.first] = VertexLoaderBase::CreateVertexLoader(desc, vat);
+	}
+
+	INFO_LOG(VIDEO, "Precompiled %zu vertex loaders for %s", s_loader_profile.size(), last_game_code.c_str());
+}
+
+static void SaveLoaderProfile()
+{
+	if (last_game_code.empty())
+		return;
+
+	// Halve the old counts so that formats the game stopped using age out
+	std::map<VertexLoaderUID, u64> counts;
+	for (const auto& entry : s_loader_profile)
+		counts[entry.first] = entry.second / 2;
+
+	for (const auto& entry : s_vertex_loader_map)
+	{
+		VertexLoaderBase* fallback = entry.second->GetFallback();
+		counts[entry.first] += entry.second->m_numLoadedVertices + (fallback ? fallback->m_numLoadedVertices : 0);
+	}
+
+	std::vector<std::pair<VertexLoaderUID, u64>> entries;
+	for (const auto& entry : counts)
+	{
+		if (entry.second > 0)
+			entries.push_back(entry);
+	}
+
+	std::sort(entries.begin(), entries.end(),
+		[](const std::pair<VertexLoaderUID, u64>& a, const std::pair<VertexLoaderUID, u64>& b) { return a.second > b.second; });
+	if (entries.size() > LOADER_PROFILE_MAX_ENTRIES)
+		entries.erase(entries.begin() + LOADER_PROFILE_MAX_ENTRIES, entries.end());
+
+	// Rewritten as a whole, the file would otherwise grow with every run
+	std::string filename = GetLoaderProfileFilename();
+	File::Delete(filename);
+
+	LinearDiskCache<LoaderProfileKey, u64> cache;
+	LoaderProfileReader reader;
+	cache.OpenAndRead(filename, reader);
+	for (const auto& entry : entries)
+	{
+		LoaderProfileKey key;
+		for (u32 i = 0; i < 4; i++)
+			key.vid[i] = entry.first.GetElement(i);
+		cache.Append(key, &entry.second, 1);
+	}
+	cache.Close();
+}
+
 static std::string To_HexString(u32 in)
 {
 	char hexString[2 * sizeof(u32) + 8];
@@ -190,13 +322,17 @@ void Init()
 	for (VertexLoaderBase*& vertexLoader : g_main_cp_state.vertex_loaders)
 		vertexLoader = nullptr;
 	last_game_code = SConfig::GetInstance().m_strGameID;
+	LoadLoaderProfile();
 }
 
 void Shutdown()
 {
 	if (s_vertex_loader_map.size() > 0 && g_ActiveConfig.bDumpVertexLoaders)
 		DumpLoadersCode();
+	if (s_vertex_loader_map.size() > 0)
+		SaveLoaderProfile();
 	s_vertex_loader_map.clear();
+	s_loader_profile.clear();
 	s_native_vertex_map.clear();
 }
 
@@ -239,6 +375,16 @@ void MarkAllDirty()
 	g_preprocess_cp_state.bases_dirty = true;
 }
 
+static void SetNativeVertexFormats(VertexLoaderBase* loader)
+{
+	loader->m_native_vertex_format = GetNativeVertexFormat(loader->m_native_vtx_decl);
+	VertexLoaderBase * fallback = loader->GetFallback();
+	if (fallback)
+	{
+		fallback->m_native_vertex_format = GetNativeVertexFormat(fallback->m_native_vtx_decl);
+	}
+}
+
 inline VertexLoaderBase *GetOrAddLoader(const TVtxDesc &VtxDesc, const VAT &VtxAttr)
 {
 	VertexLoaderUID uid(VtxDesc, VtxAttr);
@@ -247,16 +393,18 @@ inline VertexLoaderBase *GetOrAddLoader(const TVtxDesc &VtxDesc, const VAT &VtxA
 	{
 		s_vertex_loader_map[uid] = VertexLoaderBase::CreateVertexLoader(VtxDesc, VtxAttr);
 		VertexLoaderBase* loader = s_vertex_loader_map[uid].get();
-		loader->m_native_vertex_format = GetNativeVertexFormat(loader->m_native_vtx_decl);
-		VertexLoaderBase * fallback = loader->GetFallback();
-		if (fallback)
-		{
-			fallback->m_native_vertex_format = GetNativeVertexFormat(fallback->m_native_vtx_decl);
-		}
+		SetNativeVertexFormats(loader);
 		INCSTAT(stats.numVertexLoaders);
 		return loader;
 	}
-	return iter->second.get();
+	VertexLoaderBase* loader = iter->second.get();
+	// Loaders created from the profile at boot
+	if (!loader->m_native_vertex_format)
+	{
+		SetNativeVertexFormats(loader);
+		INCSTAT(stats.numVertexLoaders);
+	}
+	return loader;
 }
 
 void GetVertexSizeAndComponents(const VertexLoaderParameters &parameters, u32 &vertexsize, u32 &components)
@@ -313,6 +461,24 @@ bool ConvertVertices(VertexLoaderParameters &parameters, u32 &readsize, u32 &wri
 	return true;
 }
 
+void AddCachedVertices(int vtx_attr_group, int primitive, NativeVertexFormat* format, u32 components, u32 stride, const u8* data, u32 count)
+{
+	// The loader for the group is left as it is, a dirty group still gets refreshed by the next converted draw
+	g_main_cp_state.last_id = vtx_attr_group;
+	if (s_current_vtx_fmt != nullptr && s_current_vtx_fmt != format)
+	{
+		g_vertex_manager->Flush();
+	}
+	s_current_vtx_fmt = format;
+	g_current_components = components;
+	g_vertex_manager->PrepareForAdditionalData(primitive, count, stride);
+	memcpy(g_vertex_manager->GetCurrentBufferPointer(), data, count * stride);
+	IndexGenerator::AddIndices(primitive, count);
+	g_vertex_manager->IncCurrentBufferPointer(count * stride);
+	ADDSTAT(stats.thisFrame.numPrims, count);
+	INCSTAT(stats.thisFrame.numPrimitiveJoins);
+}
+
 int GetVertexSize(const VertexLoaderParameters &parameters)
 {
 	if (parameters.needloaderrefresh)
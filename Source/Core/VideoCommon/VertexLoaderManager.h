@@ -24,6 +24,9 @@ int GetVertexSize(const VertexLoaderParameters &parameters);
 
 bool ConvertVertices(VertexLoaderParameters &parameters, u32 &readsize, u32 &writesize);
 
+// Adds vertices converted by an earlier ConvertVertices call, used by the display list cache
+void AddCachedVertices(int vtx_attr_group, int primitive, NativeVertexFormat* format, u32 components, u32 stride, const u8* data, u32 count);
+
 void GetVertexSizeAndComponents(const VertexLoaderParameters &parameters, u32 &vertexsize, u32 &components);
 
 // For debugging
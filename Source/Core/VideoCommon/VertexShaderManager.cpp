@@ -15,6 +15,7 @@
 #include "VideoCommon/VertexShaderManager.h"
 #include "VideoCommon/BPMemory.h"
 #include "VideoCommon/CPMemory.h"
+#include "VideoCommon/DLCache.h"
 #include "VideoCommon/XFMemory.h"
 #include "VideoCommon/VideoCommon.h"
 #include "VideoCommon/VideoConfig.h"
@@ -715,6 +716,7 @@ void VertexShaderManager::SetTexMatrixChangedA(u32 Value)
 		g_vertex_manager->Flush();
 		s_tex_matrices_changed[0] = true;
 		g_main_cp_state.matrix_index_a.Hex = Value;
+		IncrementCheckContextId();
 	}
 }
 
@@ -725,6 +727,7 @@ void VertexShaderManager::SetTexMatrixChangedB(u32 Value)
 		g_vertex_manager->Flush();
 		s_tex_matrices_changed[1] = true;
 		g_main_cp_state.matrix_index_b.Hex = Value;
+		IncrementCheckContextId();
 	}
 }
 
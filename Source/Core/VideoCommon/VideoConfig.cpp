@@ -204,6 +204,7 @@ void VideoConfig::Load(const std::string& ini_file)
 	hacks->Get("EnableGPUTextureDecoding", &bEnableGPUTextureDecoding, false);
 	hacks->Get("EnableComputeTextureEncoding", &bEnableComputeTextureEncoding, false);
 	hacks->Get("PredictiveFifo", &bPredictiveFifo, false);
+	hacks->Get("DisplayListCache", &bDisplayListCache, false);
 	hacks->Get("BoundingBoxMode", &iBBoxMode, (int)BBoxMode::BBoxNone);
 	hacks->Get("LastStoryEFBToRam", &bLastStoryEFBToRam, false);
 	hacks->Get("ForceLogicOpBlend", &bForceLogicOpBlend, false);
@@ -349,6 +350,7 @@ void VideoConfig::GameIniLoad()
 	CHECK_SETTING("Video_Hacks", "BoundingBoxMode", iBBoxMode);
 	CHECK_SETTING("Video_Hacks", "LastStoryEFBToRam", bLastStoryEFBToRam);
 	CHECK_SETTING("Video_Hacks", "VertexRounding", bVertexRounding);
+	CHECK_SETTING("Video_Hacks", "DisplayListCache", bDisplayListCache);
 
 	CHECK_SETTING("Video", "ProjectionHack", iPhackvalue[0]);
 	CHECK_SETTING("Video", "PH_SZNear", iPhackvalue[1]);
@@ -553,6 +555,7 @@ void VideoConfig::Save(const std::string& ini_file)
 	hacks->Set("EnableGPUTextureDecoding", bEnableGPUTextureDecoding);
 	hacks->Set("EnableComputeTextureEncoding", bEnableComputeTextureEncoding);
 	hacks->Set("PredictiveFifo", bPredictiveFifo);
+	hacks->Set("DisplayListCache", bDisplayListCache);
 	hacks->Set("BoundingBoxMode", iBBoxMode);
 	hacks->Set("LastStoryEFBToRam", bLastStoryEFBToRam);
 	hacks->Set("ForceLogicOpBlend", bForceLogicOpBlend);
@@ -171,6 +171,7 @@ struct VideoConfig final
 	bool bPerfQueriesEnable;
 	bool bFullAsyncShaderCompilation;
 	bool bPredictiveFifo;
+	bool bDisplayListCache;
 	bool bWaitForShaderCompilation;
 	bool bEnableGPUTextureDecoding;
 	bool bEnableComputeTextureEncoding;
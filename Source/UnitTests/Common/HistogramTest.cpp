@@ -0,0 +1,51 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+
+#include "Common/Histogram.h"
+
+TEST(Histogram, Empty)
+{
+  Common::Histogram h;
+
+  EXPECT_EQ(0u, h.Count());
+  EXPECT_EQ(0u, h.Max());
+  EXPECT_EQ(0u, h.Percentile(99));
+}
+
+TEST(Histogram, BucketsCoverValues)
+{
+  for (u64 value : {0ULL, 1ULL, 7ULL, 8ULL, 9ULL, 15ULL, 16ULL, 1000ULL, 16683ULL, ~0ULL})
+  {
+    size_t index = Common::Histogram::BucketIndex(value);
+    EXPECT_LE(value, Common::Histogram::BucketUpperBound(index));
+    if (index > 0)
+    {
+      EXPECT_GT(value, Common::Histogram::BucketUpperBound(index - 1));
+    }
+  }
+}
+
+TEST(Histogram, Percentiles)
+{
+  Common::Histogram h;
+  for (u64 i = 1; i <= 100; i++)
+    h.Add(i);
+
+  EXPECT_EQ(100u, h.Count());
+  EXPECT_EQ(100u, h.Max());
+  EXPECT_EQ(50u, h.Mean());
+
+  // Reported values are bucket upper bounds, within 25% of the exact percentile
+  EXPECT_GE(h.Percentile(50), 50u);
+  EXPECT_LE(h.Percentile(50), 63u);
+  EXPECT_GE(h.Percentile(99), 99u);
+  EXPECT_LE(h.Percentile(99), 100u);
+  EXPECT_EQ(1u, h.Percentile(0));
+
+  h.Reset();
+  EXPECT_EQ(0u, h.Count());
+  EXPECT_EQ(0u, h.Percentile(50));
+}
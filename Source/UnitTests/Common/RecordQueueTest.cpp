@@ -0,0 +1,124 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "Common/RecordQueue.h"
+
+TEST(RecordQueue, Simple)
+{
+  Common::RecordQueue q(64);
+
+  EXPECT_TRUE(q.Empty());
+  EXPECT_EQ(56u, q.MaxRecordSize());
+
+  const u8 payload[] = {1, 2, 3};
+  EXPECT_TRUE(q.Push(7, payload, sizeof(payload)));
+  EXPECT_FALSE(q.Empty());
+  EXPECT_EQ(16u, q.Size());
+
+  u32 tag, size;
+  const u8* data;
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(7u, tag);
+  EXPECT_EQ(3u, size);
+  EXPECT_EQ(0, memcmp(payload, data, size));
+  q.Pop();
+  EXPECT_TRUE(q.Empty());
+  EXPECT_FALSE(q.Front(&tag, &data, &size));
+
+  // Empty records only carry a tag
+  EXPECT_TRUE(q.Push(2, nullptr, 0));
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(2u, tag);
+  EXPECT_EQ(0u, size);
+  q.Pop();
+}
+
+TEST(RecordQueue, FullAndWrap)
+{
+  Common::RecordQueue q(64);
+  std::vector<u8> payload(64, 0xAB);
+
+  // Two 32 byte records fill the buffer
+  EXPECT_TRUE(q.Push(0, payload.data(), 24));
+  EXPECT_TRUE(q.Push(1, payload.data(), 24));
+  EXPECT_FALSE(q.Push(2, payload.data(), 1));
+  EXPECT_FALSE(q.Push(3, payload.data(), 57));
+
+  u32 tag, size;
+  const u8* data;
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(0u, tag);
+  q.Pop();
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(1u, tag);
+  q.Pop();
+  EXPECT_TRUE(q.Empty());
+
+  // Leave a single 16 byte record in use at offset 32
+  EXPECT_TRUE(q.Push(4, payload.data(), 24));
+  EXPECT_TRUE(q.Push(5, payload.data(), 8));
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(4u, tag);
+  q.Pop();
+
+  // 24 bytes don't fit in the 16 left at the end, so the record goes to the start
+  for (u8 i = 0; i < 16; i++)
+    payload[i] = i;
+  EXPECT_TRUE(q.Push(6, payload.data(), 16));
+  EXPECT_FALSE(q.Push(7, payload.data(), 1));
+
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(5u, tag);
+  q.Pop();
+  ASSERT_TRUE(q.Front(&tag, &data, &size));
+  EXPECT_EQ(6u, tag);
+  EXPECT_EQ(16u, size);
+  EXPECT_EQ(0, memcmp(payload.data(), data, size));
+  q.Pop();
+  EXPECT_TRUE(q.Empty());
+}
+
+TEST(RecordQueue, MultiThreaded)
+{
+  Common::RecordQueue q(1024);
+
+  auto inserter = [&q]() {
+    u8 payload[64];
+    for (u32 i = 0; i < 100000; ++i)
+    {
+      const u32 size = i % sizeof(payload);
+      for (u32 j = 0; j < size; ++j)
+        payload[j] = static_cast<u8>(i + j);
+      while (!q.Push(i, payload, size))
+        std::this_thread::yield();
+    }
+  };
+
+  auto popper = [&q]() {
+    for (u32 i = 0; i < 100000; ++i)
+    {
+      u32 tag, size;
+      const u8* data;
+      while (!q.Front(&tag, &data, &size))
+        std::this_thread::yield();
+      EXPECT_EQ(i, tag);
+      EXPECT_EQ(i % 64, size);
+      for (u32 j = 0; j < size; ++j)
+        EXPECT_EQ(static_cast<u8>(i + j), data[j]);
+      q.Pop();
+    }
+  };
+
+  std::thread popper_thread(popper);
+  std::thread inserter_thread(inserter);
+
+  popper_thread.join();
+  inserter_thread.join();
+
+  EXPECT_TRUE(q.Empty());
+}
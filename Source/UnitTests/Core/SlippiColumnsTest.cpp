@@ -0,0 +1,307 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstdio>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+#include "Common/FileUtil.h"
+#include "SlippiColumns.h"
+
+namespace
+{
+const u16 GAME_INIT_SIZE = 418;
+const u16 PRE_FRAME_UPDATE_SIZE = 63;
+const u16 POST_FRAME_UPDATE_SIZE = 7;
+const u16 GAME_END_SIZE = 1;
+const u32 FIXTURE_FRAMES = 3;
+
+// Builds a raw replay, big endian like the game writes it
+class ReplayWriter
+{
+public:
+  void Byte(u8 value) { m_data.push_back(value); }
+  void Half(u16 value)
+  {
+    Byte(value >> 8);
+    Byte(value & 0xFF);
+  }
+  void Word(u32 value)
+  {
+    Half(value >> 16);
+    Half(value & 0xFFFF);
+  }
+  void Float(float value)
+  {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    Word(bits);
+  }
+  void Zeros(size_t count) { m_data.insert(m_data.end(), count, 0); }
+
+  const std::vector<u8>& Data() const { return m_data; }
+
+private:
+  std::vector<u8> m_data;
+};
+
+float LocationX(s32 frame, u8 port)
+{
+  return frame * 2.0f + port;
+}
+
+u32 Buttons(s32 frame, u8 port)
+{
+  return (u32)(frame - Slippi::GAME_FIRST_FRAME) << 8 | port;
+}
+
+// Ports 0 and 1 play on stage 31 as characters 2 and 20. Port 1 is missing from the second
+// frame, the way a lost frame would be
+std::string FixtureReplay()
+{
+  ReplayWriter w;
+  w.Byte(Slippi::EVENT_PAYLOAD_SIZES);
+  w.Byte(1 + 4 * 3);
+  w.Byte(Slippi::EVENT_GAME_INIT);
+  w.Half(GAME_INIT_SIZE);
+  w.Byte(Slippi::EVENT_PRE_FRAME_UPDATE);
+  w.Half(PRE_FRAME_UPDATE_SIZE);
+  w.Byte(Slippi::EVENT_POST_FRAME_UPDATE);
+  w.Half(POST_FRAME_UPDATE_SIZE);
+  w.Byte(Slippi::EVENT_GAME_END);
+  w.Half(GAME_END_SIZE);
+
+  const u8 characters[] = {2, 20};
+  w.Byte(Slippi::EVENT_GAME_INIT);
+  w.Byte(3);
+  w.Zeros(3);
+  for (int i = 0; i < Slippi::GAME_INFO_HEADER_SIZE; i++)
+  {
+    u32 word = 0;
+    if (i == 3)
+      word = 31;
+    for (u8 port = 0; port < Slippi::PORT_COUNT; port++)
+    {
+      // Player type 3 leaves the port empty
+      if (i == 24 + 9 * port)
+        word = port < 2 ? characters[port] << 24 : 3 << 16;
+    }
+    w.Word(word);
+  }
+  w.Zeros(GAME_INIT_SIZE - 4 - Slippi::GAME_INFO_HEADER_SIZE * 4);
+
+  for (u32 i = 0; i < FIXTURE_FRAMES; i++)
+  {
+    s32 frame = Slippi::GAME_FIRST_FRAME + i;
+    for (u8 port = 0; port < 2; port++)
+    {
+      if (port == 1 && i == 1)
+        continue;
+
+      w.Byte(Slippi::EVENT_PRE_FRAME_UPDATE);
+      w.Word(frame);
+      w.Byte(port);
+      w.Byte(0);
+      w.Word(0);                        // random seed
+      w.Half(0x100 + i);                // animation
+      w.Float(LocationX(frame, port));  // location x
+      w.Float(-1.0f);                   // location y
+      w.Float(1.0f);                    // facing direction
+      w.Float(0.5f);                    // joystick x
+      w.Float(0.0f);                    // joystick y
+      w.Float(0.0f);                    // c-stick x
+      w.Float(0.0f);                    // c-stick y
+      w.Float(0.0f);                    // trigger
+      w.Word(Buttons(frame, port));     // buttons
+      w.Half(0x0100);                   // physical buttons
+      w.Float(0.0f);                    // l trigger
+      w.Float(0.0f);                    // r trigger
+      w.Byte(0);                        // raw stick x
+      w.Float(10.0f * i);               // percent
+
+      w.Byte(Slippi::EVENT_POST_FRAME_UPDATE);
+      w.Word(frame);
+      w.Byte(port);
+      w.Byte(0);
+      w.Byte(0);  // internal character id
+    }
+  }
+
+  w.Byte(Slippi::EVENT_GAME_END);
+  w.Byte(2);
+
+  return std::string(w.Data().begin(), w.Data().end());
+}
+
+// Reads back what the column file holds, in host byte order
+class ColumnReader
+{
+public:
+  explicit ColumnReader(const std::string& data) : m_data(data) {}
+
+  template <typename T>
+  T Read()
+  {
+    T value{};
+    if (m_pos + sizeof(T) > m_data.size())
+    {
+      ADD_FAILURE() << "Column file ends at " << m_data.size();
+      m_pos = m_data.size();
+      return value;
+    }
+
+    memcpy(&value, &m_data[m_pos], sizeof(T));
+    m_pos += sizeof(T);
+    return value;
+  }
+
+  template <typename T>
+  std::vector<T> ReadColumn(u32 count)
+  {
+    std::vector<T> column;
+    for (u32 i = 0; i < count; i++)
+      column.push_back(Read<T>());
+    return column;
+  }
+
+  std::string ReadString(u32 length)
+  {
+    std::string value = m_data.substr(m_pos, length);
+    m_pos += value.size();
+    return value;
+  }
+
+  bool AtEnd() const { return m_pos == m_data.size(); }
+
+private:
+  const std::string& m_data;
+  size_t m_pos = 0;
+};
+
+void CheckRecord(ColumnReader& reader, const std::string& path)
+{
+  u32 pathLength = reader.Read<u32>();
+  EXPECT_EQ(path, reader.ReadString(pathLength));
+  EXPECT_EQ(31, reader.Read<u16>());
+  EXPECT_EQ(0x3, reader.Read<u8>());
+  EXPECT_EQ(2, reader.Read<u8>());
+  EXPECT_EQ(20, reader.Read<u8>());
+  EXPECT_EQ(0, reader.Read<u8>());
+  EXPECT_EQ(0, reader.Read<u8>());
+  EXPECT_EQ(Slippi::GAME_FIRST_FRAME, reader.Read<s32>());
+  u32 frameCount = reader.Read<u32>();
+  ASSERT_EQ(FIXTURE_FRAMES, frameCount);
+
+  for (u8 port = 0; port < 2; port++)
+  {
+    SCOPED_TRACE(testing::Message() << "port " << (int)port);
+
+    // Port 1's missing frame is zero filled
+    auto present = [&](u32 i) { return port == 0 || i != 1; };
+
+    std::vector<float> locationX = reader.ReadColumn<float>(frameCount);
+    std::vector<float> locationY = reader.ReadColumn<float>(frameCount);
+    std::vector<float> facingDirection = reader.ReadColumn<float>(frameCount);
+    std::vector<float> percent = reader.ReadColumn<float>(frameCount);
+    std::vector<u16> animation = reader.ReadColumn<u16>(frameCount);
+    std::vector<float> joystickX = reader.ReadColumn<float>(frameCount);
+    reader.ReadColumn<float>(frameCount * 4);  // joystick y, c-stick and trigger
+    std::vector<u32> buttons = reader.ReadColumn<u32>(frameCount);
+    std::vector<u16> physicalButtons = reader.ReadColumn<u16>(frameCount);
+
+    for (u32 i = 0; i < frameCount; i++)
+    {
+      s32 frame = Slippi::GAME_FIRST_FRAME + i;
+      bool exists = present(i);
+      EXPECT_EQ(exists ? LocationX(frame, port) : 0.0f, locationX[i]);
+      EXPECT_EQ(exists ? -1.0f : 0.0f, locationY[i]);
+      EXPECT_EQ(exists ? 1.0f : 0.0f, facingDirection[i]);
+      EXPECT_EQ(exists ? 10.0f * i : 0.0f, percent[i]);
+      EXPECT_EQ(exists ? 0x100 + i : 0, animation[i]);
+      EXPECT_EQ(exists ? 0.5f : 0.0f, joystickX[i]);
+      EXPECT_EQ(exists ? Buttons(frame, port) : 0, buttons[i]);
+      EXPECT_EQ(exists ? 0x0100 : 0, physicalButtons[i]);
+    }
+  }
+}
+
+class SlippiColumnsTest : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_dir = File::CreateTempDir();
+    ASSERT_FALSE(m_dir.empty());
+    ASSERT_TRUE(File::WriteStringToFile(FixtureReplay(), m_dir + "/a.slp"));
+    ASSERT_TRUE(File::WriteStringToFile(FixtureReplay(), m_dir + "/b.slp"));
+  }
+
+  void TearDown() override { File::DeleteDirRecursively(m_dir); }
+
+  std::string WriteColumns(const std::vector<std::string>& paths, unsigned int threadCount,
+                           size_t* skipped)
+  {
+    std::string outputPath = m_dir + "/columns.bin";
+    FILE* output = fopen(outputPath.c_str(), "wb");
+    EXPECT_NE(nullptr, output);
+    if (!output)
+      return "";
+
+    *skipped = Slippi::writeColumnFile(output, paths, threadCount);
+    fclose(output);
+
+    std::string data;
+    EXPECT_TRUE(File::ReadFileToString(outputPath, data));
+    return data;
+  }
+
+  std::string m_dir;
+};
+}  // namespace
+
+TEST_F(SlippiColumnsTest, WritesFixtureColumns)
+{
+  const std::string path = m_dir + "/a.slp";
+  size_t skipped = 0;
+  std::string data = WriteColumns({path}, 1, &skipped);
+  EXPECT_EQ(0u, skipped);
+
+  ColumnReader reader(data);
+  EXPECT_EQ(std::string(Slippi::COLUMN_FILE_MAGIC, 4), reader.ReadString(4));
+  EXPECT_EQ(Slippi::COLUMN_FILE_VERSION, reader.Read<u32>());
+  CheckRecord(reader, path);
+  EXPECT_TRUE(reader.AtEnd());
+}
+
+// Records come in the order the replays were given, however many threads parse them, and
+// unreadable replays are left out
+TEST_F(SlippiColumnsTest, RecordsFollowInputOrder)
+{
+  std::vector<std::string> paths;
+  for (int i = 0; i < 8; i++)
+  {
+    paths.push_back(m_dir + (i % 2 ? "/a.slp" : "/b.slp"));
+    if (i == 3)
+      paths.push_back(m_dir + "/missing.slp");
+  }
+
+  size_t skipped = 0;
+  std::string first = WriteColumns(paths, 4, &skipped);
+  EXPECT_EQ(1u, skipped);
+
+  ColumnReader reader(first);
+  reader.ReadString(8);
+  for (const std::string& path : paths)
+  {
+    if (path != m_dir + "/missing.slp")
+      CheckRecord(reader, path);
+  }
+  EXPECT_TRUE(reader.AtEnd());
+
+  for (int run = 0; run < 3; run++)
+    EXPECT_EQ(first, WriteColumns(paths, 4, &skipped));
+}
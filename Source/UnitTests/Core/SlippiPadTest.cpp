@@ -0,0 +1,136 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "Core/Slippi/SlippiPad.h"
+
+static void MakePad(int32_t frame, u8* pad)
+{
+  for (int i = 0; i < SLIPPI_PAD_DATA_SIZE; i++)
+    pad[i] = (u8)(frame * 7 + i);
+}
+
+TEST(SlippiPadRing, PushAndTrim)
+{
+  SlippiPadRing ring;
+  ring.Reset(1, 2);
+  EXPECT_EQ(1, ring.OldestFrame());
+  EXPECT_EQ(2, ring.LatestFrame());
+
+  // Reports come newest first, and frames already held are skipped
+  u8 pads[3 * SLIPPI_PAD_DATA_SIZE];
+  for (int i = 0; i < 3; i++)
+    MakePad(5 - i, &pads[i * SLIPPI_PAD_DATA_SIZE]);
+  EXPECT_TRUE(ring.Push(5, pads, 3));
+  EXPECT_EQ(5, ring.LatestFrame());
+  EXPECT_TRUE(ring.Push(5, pads, 3));
+  EXPECT_EQ(5, ring.LatestFrame());
+
+  for (int32_t frame = 3; frame <= 5; frame++)
+  {
+    u8 expected[SLIPPI_PAD_DATA_SIZE];
+    MakePad(frame, expected);
+    EXPECT_EQ(0, memcmp(expected, ring.Get(frame), SLIPPI_PAD_DATA_SIZE));
+  }
+
+  // The latest frame is always kept
+  ring.Trim(4);
+  EXPECT_EQ(4, ring.OldestFrame());
+  ring.Trim(100);
+  EXPECT_EQ(5, ring.OldestFrame());
+  ring.Trim(2);
+  EXPECT_EQ(5, ring.OldestFrame());
+}
+
+TEST(SlippiPadRing, GapAndFull)
+{
+  SlippiPadRing ring;
+
+  u8 pad[SLIPPI_PAD_DATA_SIZE];
+  MakePad(3, pad);
+  EXPECT_TRUE(ring.Push(3, pad, 1));
+  EXPECT_EQ(0, memcmp(pad, ring.Get(1), SLIPPI_PAD_DATA_SIZE));
+  EXPECT_EQ(0, memcmp(pad, ring.Get(2), SLIPPI_PAD_DATA_SIZE));
+
+  // Slots are only reused once the reader trims past them
+  EXPECT_FALSE(ring.Push(SLIPPI_PAD_RING_SIZE, pad, 1));
+  EXPECT_TRUE(ring.Push(SLIPPI_PAD_RING_SIZE - 1, pad, 1));
+  ring.Trim(2);
+  EXPECT_TRUE(ring.Push(SLIPPI_PAD_RING_SIZE + 1, pad, 1));
+  EXPECT_FALSE(ring.Push(SLIPPI_PAD_RING_SIZE + 2, pad, 1));
+}
+
+TEST(SlippiPadRing, MultiThreaded)
+{
+  SlippiPadRing ring;
+  const int32_t lastFrame = 100000;
+
+  std::thread writer([&ring, lastFrame]() {
+    u8 pad[SLIPPI_PAD_DATA_SIZE];
+    for (int32_t frame = 1; frame <= lastFrame; frame++)
+    {
+      MakePad(frame, pad);
+      while (!ring.Push(frame, pad, 1))
+        std::this_thread::yield();
+    }
+  });
+
+  int32_t frame = 1;
+  while (frame <= lastFrame)
+  {
+    if (ring.LatestFrame() < frame)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    u8 expected[SLIPPI_PAD_DATA_SIZE];
+    MakePad(frame, expected);
+    ASSERT_EQ(0, memcmp(expected, ring.Get(frame), SLIPPI_PAD_DATA_SIZE));
+    ring.Trim(++frame);
+  }
+
+  writer.join();
+}
+
+TEST(SlippiPad, DeltaEncoding)
+{
+  // Newest first: a few changing reports, then a long held input
+  const int count = 40;
+  u8 pads[count * SLIPPI_PAD_DATA_SIZE];
+  for (int i = 0; i < count; i++)
+    MakePad(i < 5 ? i : 5, &pads[i * SLIPPI_PAD_DATA_SIZE]);
+
+  u8 encoded[SLIPPI_PAD_DELTA_MAX_SIZE(count)];
+  size_t size = SlippiPadDeltaEncode(pads, count, encoded);
+  EXPECT_LT(size, (size_t)(10 * SLIPPI_PAD_DATA_SIZE));
+
+  u8 decoded[count * SLIPPI_PAD_DATA_SIZE];
+  EXPECT_EQ(size, SlippiPadDeltaDecode(encoded, size, count, decoded));
+  EXPECT_EQ(0, memcmp(pads, decoded, sizeof(pads)));
+
+  // Decoding only the newest reports stops early, and truncated data is rejected
+  EXPECT_NE(0u, SlippiPadDeltaDecode(encoded, size, 3, decoded));
+  EXPECT_EQ(0, memcmp(pads, decoded, 3 * SLIPPI_PAD_DATA_SIZE));
+  EXPECT_EQ(0u, SlippiPadDeltaDecode(encoded, size - 1, count, decoded));
+}
+
+TEST(SlippiPad, DeltaEncodingWorstCase)
+{
+  const int count = SLIPPI_PAD_RING_SIZE;
+  u8 pads[count * SLIPPI_PAD_DATA_SIZE];
+  for (int i = 0; i < count * SLIPPI_PAD_DATA_SIZE; i++)
+    pads[i] = (u8)(i * 37 + 1);
+
+  u8 encoded[SLIPPI_PAD_DELTA_MAX_SIZE(count)];
+  size_t size = SlippiPadDeltaEncode(pads, count, encoded);
+  EXPECT_LE(size, sizeof(encoded));
+
+  u8 decoded[count * SLIPPI_PAD_DATA_SIZE];
+  EXPECT_EQ(size, SlippiPadDeltaDecode(encoded, size, count, decoded));
+  EXPECT_EQ(0, memcmp(pads, decoded, sizeof(pads)));
+}
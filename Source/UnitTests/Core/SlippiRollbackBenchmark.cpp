@@ -0,0 +1,784 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Headless benchmark of the online rollback path. A local client runs a synthetic game on the
+// emulated RAM and captures and loads savestates the way the game drives CMD_CAPTURE_SAVESTATE
+// and CMD_LOAD_SAVESTATE. It plays against a remote client that only sends inputs. Both are real
+// SlippiNetplayClients on loopback, talking through a relay that adds latency and drops packets.
+// After the match the final memory is checked against a replay of the confirmed inputs without
+// rollbacks. Capture/load timings and rollback counts are printed for every link.
+//
+// The links run in real time, so they are disabled by default. Run them with
+// --gtest_also_run_disabled_tests --gtest_filter=SlippiRollbackBenchmark.*
+// A short match over a simulated link runs by default. It plays out the same on every run, so
+// its rollback counts are checked too.
+//
+// SLIPPI_ROLLBACK_BENCH=<latency ms>,<jitter ms>,<loss %>,<frames> runs one more link at 60 fps.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <enet/enet.h>
+#include <functional>
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <xxhash.h>
+
+#include "Common/CommonFuncs.h"
+#include "Common/CommonTypes.h"
+#include "Common/Histogram.h"
+#include "Common/Timer.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "Core/Slippi/SlippiNetplay.h"
+#include "Core/Slippi/SlippiPad.h"
+#include "Core/Slippi/SlippiSavestate.h"
+
+namespace
+{
+// Same as the EXI device. StartSlippiGame fills in the remote pads of the first INPUT_DELAY frames
+const s32 INPUT_DELAY = 2;
+const int ROLLBACK_MAX_FRAMES = 7;
+const u32 FRAME_US = 16683;
+
+struct LinkConfig
+{
+  u32 latencyUs;  // one way
+  u32 jitterUs;   // random extra latency, up to this
+  u32 lossPercent;
+};
+
+struct BenchmarkConfig
+{
+  const char* name;
+  LinkConfig link;
+  s32 frames;
+  u32 frameUs;
+  bool trackWrites;  // false finds changed chunks by comparing them instead
+};
+
+struct BenchmarkResult
+{
+  Common::Histogram captureUs;
+  Common::Histogram loadUs;
+  u64 rollbacks = 0;
+  u64 rollbackFrames = 0;
+  s32 maxRollbackDepth = 0;
+  u64 stallFrames = 0;
+  u64 simulatedFrames = 0;
+};
+
+u64 Mix(u64 x)
+{
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+u64 Read64(const u8* ptr)
+{
+  u64 value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+void Write64(u8* ptr, u64 value)
+{
+  memcpy(ptr, &value, sizeof(value));
+}
+
+// Inputs of a player, held for a few frames at a time like real ones so that predictions are
+// sometimes right
+u64 GeneratePad(int player, s32 frame)
+{
+  s32 changeFrame = frame;
+  while (changeFrame > 0 && Mix((u64)player << 32 | (u32)changeFrame) % 6 != 0)
+    changeFrame--;
+
+  return Mix(((u64)player << 32 | (u32)changeFrame) ^ 0x51199151);
+}
+
+// Stand-in for the game: every frame rewrites a set of player/item sized structs and scatters
+// small writes over the heap, all depending on the inputs and on what memory held before. Only
+// touches the heap, which SlippiSavestate backs up in full.
+namespace SyntheticGame
+{
+const u32 ENTITY_BASE = 0x80C00000;
+const u32 ENTITY_COUNT = 64;
+const u32 ENTITY_SIZE = 0x800;
+const u32 ENTITY_STRIDE = 0x3000;
+const u32 SCATTER_BASE = 0x80D00000;
+const u32 SCATTER_SIZE = 0x200000;
+const u32 SCATTER_WRITES = 192;
+
+// Counts every simulated frame, resimulated ones included. Kept through loads by preserving it
+const SlippiSavestate::PreserveBlock COUNTER_BLOCK = {0x80BE0000, 8};
+
+void Reset()
+{
+  u8* ram = Memory::GetPointer(0x80000000);
+  for (u32 offset = 0; offset < Memory::RAM_SIZE; offset += 8)
+    Write64(&ram[offset], Mix(offset));
+
+  Write64(Memory::GetPointer(COUNTER_BLOCK.address), 0);
+}
+
+void SimulateFrame(s32 frame, u64 localPad, u64 remotePad)
+{
+  u64 seed = Mix((u64)frame) ^ Mix(localPad) ^ Mix(remotePad * 3);
+
+  for (u32 i = 0; i < ENTITY_COUNT; i++)
+  {
+    u8* entity = Memory::GetPointer(ENTITY_BASE + i * ENTITY_STRIDE);
+    u64 state = Mix(Read64(entity) ^ seed ^ i);
+    for (u32 offset = 0; offset < ENTITY_SIZE; offset += 8)
+      Write64(&entity[offset], Read64(&entity[offset]) * 6364136223846793005ULL + state);
+
+    seed ^= state;
+  }
+
+  u64 x = seed;
+  for (u32 i = 0; i < SCATTER_WRITES; i++)
+  {
+    x = Mix(x);
+    u8* ptr = Memory::GetPointer(SCATTER_BASE + (u32)(x % (SCATTER_SIZE / 32)) * 32);
+    for (u32 offset = 0; offset < 32; offset += 8)
+      Write64(&ptr[offset], Read64(&ptr[offset]) ^ Mix(x + offset));
+  }
+
+  u8* counter = Memory::GetPointer(COUNTER_BLOCK.address);
+  Write64(counter, Read64(counter) + 1);
+}
+
+u64 Hash()
+{
+  u64 hash = XXH64(Memory::GetPointer(ENTITY_BASE), ENTITY_COUNT * ENTITY_STRIDE, 0);
+  return XXH64(Memory::GetPointer(SCATTER_BASE), SCATTER_SIZE, hash);
+}
+
+u64 SimulatedFrames()
+{
+  return Read64(Memory::GetPointer(COUNTER_BLOCK.address));
+}
+}  // namespace SyntheticGame
+
+// Forwards UDP datagrams between two local ENet hosts. Each host connects to its own socket of
+// the relay, and what arrives on one socket leaves from the other one after the configured
+// latency, unless it is dropped.
+class LossyRelay
+{
+public:
+  explicit LossyRelay(const LinkConfig& config) : m_config(config), m_random(0x51199)
+  {
+    for (int i = 0; i < 2; i++)
+    {
+      ENetAddress address;
+      enet_address_set_host(&address, "127.0.0.1");
+      address.port = 0;
+
+      m_sockets[i] = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+      enet_socket_bind(m_sockets[i], &address);
+      enet_socket_set_option(m_sockets[i], ENET_SOCKOPT_NONBLOCK, 1);
+      enet_socket_get_address(m_sockets[i], &address);
+      m_ports[i] = address.port;
+    }
+
+    m_thread = std::thread(&LossyRelay::ThreadFunc, this);
+  }
+
+  ~LossyRelay()
+  {
+    m_running = false;
+    m_thread.join();
+
+    for (ENetSocket socket : m_sockets)
+      enet_socket_destroy(socket);
+  }
+
+  // Port that the given client connects to
+  u16 GetPort(int client) const { return m_ports[client]; }
+  u64 GetForwarded() const { return m_forwarded; }
+  u64 GetDropped() const { return m_dropped; }
+
+private:
+  struct Datagram
+  {
+    int to;
+    std::vector<u8> data;
+  };
+
+  void ThreadFunc()
+  {
+    u8 buffer[4096];
+
+    while (m_running)
+    {
+      ENetSocketSet set;
+      ENET_SOCKETSET_EMPTY(set);
+      ENET_SOCKETSET_ADD(set, m_sockets[0]);
+      ENET_SOCKETSET_ADD(set, m_sockets[1]);
+      enet_socketset_select(std::max(m_sockets[0], m_sockets[1]), &set, nullptr, 1);
+
+      u64 now = Common::Timer::GetTimeUs();
+      for (int from = 0; from < 2; from++)
+      {
+        ENetAddress sender;
+        ENetBuffer buf;
+        buf.data = buffer;
+        buf.dataLength = sizeof(buffer);
+
+        int length;
+        while ((length = enet_socket_receive(m_sockets[from], &sender, &buf, 1)) > 0)
+        {
+          m_clients[from] = sender;
+          m_clientKnown[from] = true;
+
+          if (m_random() % 100 < m_config.lossPercent)
+          {
+            m_dropped++;
+            continue;
+          }
+
+          u64 latency = m_config.latencyUs;
+          if (m_config.jitterUs)
+            latency += m_random() % (m_config.jitterUs + 1);
+
+          Datagram datagram = {1 - from, std::vector<u8>(buffer, buffer + length)};
+          m_queue.emplace(now + latency, std::move(datagram));
+        }
+      }
+
+      // Jitter can reorder datagrams, like on a real link
+      while (!m_queue.empty() && m_queue.begin()->first <= now)
+      {
+        Datagram& datagram = m_queue.begin()->second;
+        if (m_clientKnown[datagram.to])
+        {
+          ENetBuffer buf;
+          buf.data = datagram.data.data();
+          buf.dataLength = datagram.data.size();
+          enet_socket_send(m_sockets[datagram.to], &m_clients[datagram.to], &buf, 1);
+          m_forwarded++;
+        }
+
+        m_queue.erase(m_queue.begin());
+      }
+    }
+  }
+
+  LinkConfig m_config;
+  std::mt19937 m_random;
+  ENetSocket m_sockets[2];
+  u16 m_ports[2];
+  ENetAddress m_clients[2];
+  bool m_clientKnown[2] = {false, false};
+  std::multimap<u64, Datagram> m_queue;
+  std::atomic<u64> m_forwarded{0};
+  std::atomic<u64> m_dropped{0};
+  std::atomic<bool> m_running{true};
+  std::thread m_thread;
+};
+
+class ScopeInit final
+{
+public:
+  explicit ScopeInit(bool trackWrites)
+  {
+    SConfig::Init();
+    SConfig::GetInstance().bFastmem = trackWrites;
+    SConfig::GetInstance().bQoSEnabled = false;
+    EMM::InstallExceptionHandler();
+    Memory::Init();
+    enet_initialize();
+  }
+  ~ScopeInit()
+  {
+    enet_deinitialize();
+    Memory::Shutdown();
+    EMM::UninstallExceptionHandler();
+    SConfig::Shutdown();
+  }
+};
+
+void PaceFrame(std::chrono::steady_clock::time_point start, u64 tick, u32 frameUs)
+{
+  std::this_thread::sleep_until(start + std::chrono::microseconds(tick * frameUs));
+}
+
+bool WaitFor(const std::function<bool()>& condition)
+{
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (!condition())
+  {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return true;
+}
+
+// What CMD_CAPTURE_SAVESTATE does
+void CaptureSavestate(SlippiSavestate& savestates, s32 frame, BenchmarkResult& result)
+{
+  u64 startTime = Common::Timer::GetTimeUs();
+  savestates.Capture(frame);
+  result.captureUs.Add(Common::Timer::GetTimeUs() - startTime);
+}
+
+// What CMD_LOAD_SAVESTATE does, with the payload the game sends
+bool LoadSavestate(SlippiSavestate& savestates, s32 frame, BenchmarkResult& result)
+{
+  u32 preserveArr[] = {Common::swap32(SyntheticGame::COUNTER_BLOCK.address),
+                       Common::swap32(SyntheticGame::COUNTER_BLOCK.length), 0, 0};
+
+  if (!savestates.HasFrame(frame))
+    return false;
+
+  u64 startTime = Common::Timer::GetTimeUs();
+  auto blocks = SlippiSavestate::ReadPreserveBlocks((const u8*)preserveArr);
+  bool loaded = savestates.Load(frame, blocks);
+  result.loadUs.Add(Common::Timer::GetTimeUs() - startTime);
+  return loaded;
+}
+
+void PrintResult(const BenchmarkConfig& config, const BenchmarkResult& result, size_t backupSize,
+                 u64 dropped, u64 sent)
+{
+  // Bytes per microsecond is MB/s
+  double captureRate = result.captureUs.Mean() ? (double)backupSize / result.captureUs.Mean() : 0;
+  double loadRate = result.loadUs.Mean() ? (double)backupSize / result.loadUs.Mean() : 0;
+
+  printf("[%s] %d frames at %u us, %u us +%u us latency, %u%% loss, %s\n", config.name,
+         config.frames, config.frameUs, config.link.latencyUs, config.link.jitterUs,
+         config.link.lossPercent, config.trackWrites ? "write tracking" : "comparing chunks");
+  printf("  capture us (n=%llu) p50: %llu, p99: %llu, max: %llu, %.0f MB/s of state\n",
+         (unsigned long long)result.captureUs.Count(),
+         (unsigned long long)result.captureUs.Percentile(50),
+         (unsigned long long)result.captureUs.Percentile(99),
+         (unsigned long long)result.captureUs.Max(), captureRate);
+  printf("  load us (n=%llu) p50: %llu, p99: %llu, max: %llu, %.0f MB/s of state\n",
+         (unsigned long long)result.loadUs.Count(), (unsigned long long)result.loadUs.Percentile(50),
+         (unsigned long long)result.loadUs.Percentile(99), (unsigned long long)result.loadUs.Max(),
+         loadRate);
+  printf("  %llu rollbacks (%.1f per 100 frames), %.2f frames deep on average, %d at most\n",
+         (unsigned long long)result.rollbacks, result.rollbacks * 100.0 / config.frames,
+         result.rollbacks ? (double)result.rollbackFrames / result.rollbacks : 0.0,
+         result.maxRollbackDepth);
+  printf("  %llu stalled frames, %llu of %llu datagrams dropped\n",
+         (unsigned long long)result.stallFrames, (unsigned long long)dropped,
+         (unsigned long long)sent);
+}
+
+// The local side of a match: simulates frames on the remote inputs received so far, predicting
+// the missing ones, and rolls back when a prediction turns out wrong
+class LocalGame
+{
+public:
+  LocalGame(s32 lastFrame, BenchmarkResult& result)
+      : m_lastFrame(lastFrame), m_result(result), m_remoteActual(lastFrame + 1, 0),
+        m_remoteUsed(lastFrame + 1, 0)
+  {
+    SyntheticGame::Reset();
+    m_savestates = std::make_unique<SlippiSavestate>(ROLLBACK_MAX_FRAMES);
+  }
+
+  static u64 LocalPad(s32 frame) { return frame > INPUT_DELAY ? GeneratePad(0, frame) : 0; }
+
+  s32 GetConfirmedFrame() const { return m_confirmedFrame; }
+  s32 GetRemoteKnownFrame() const { return m_remoteKnownFrame; }
+  size_t GetBackupSize() const { return m_savestates->GetBackupSize(); }
+
+  // Runs a frame once the remote pads up to latestFrame are known, newest first. Past the last
+  // frame it only takes in the pads. Returns false if the match can't go on
+  bool RunFrame(s32 frame, s32 latestFrame, const u8* remotePads)
+  {
+    // Not stalling keeps every new pad within the frames returned
+    if (latestFrame - m_remoteKnownFrame > ROLLBACK_MAX_FRAMES)
+    {
+      ADD_FAILURE() << "Missed remote inputs after frame " << m_remoteKnownFrame;
+      return false;
+    }
+
+    for (s32 f = m_remoteKnownFrame + 1; f <= std::min(latestFrame, m_lastFrame); f++)
+    {
+      memcpy(&m_remoteActual[f], &remotePads[(latestFrame - f) * SLIPPI_PAD_FULL_SIZE],
+             SLIPPI_PAD_DATA_SIZE);
+    }
+    m_remoteKnownFrame = std::max(m_remoteKnownFrame, std::min(latestFrame, m_lastFrame));
+
+    // Roll back to the first frame that was simulated with a wrong prediction
+    s32 checkFrame = std::min(m_remoteKnownFrame, m_simulatedFrame);
+    s32 rollbackFrame = 0;
+    for (s32 f = m_confirmedFrame + 1; f <= checkFrame; f++)
+    {
+      if (m_remoteUsed[f] != m_remoteActual[f])
+      {
+        rollbackFrame = f;
+        break;
+      }
+    }
+    m_confirmedFrame = checkFrame;
+
+    if (rollbackFrame)
+    {
+      if (!LoadSavestate(*m_savestates, rollbackFrame, m_result))
+      {
+        ADD_FAILURE() << "No savestate for frame " << rollbackFrame;
+        return false;
+      }
+
+      for (s32 f = rollbackFrame; f <= m_simulatedFrame; f++)
+      {
+        if (f != rollbackFrame)
+          CaptureSavestate(*m_savestates, f, m_result);
+        Simulate(f);
+      }
+
+      s32 depth = m_simulatedFrame - rollbackFrame + 1;
+      m_result.rollbacks++;
+      m_result.rollbackFrames += depth;
+      m_result.maxRollbackDepth = std::max(m_result.maxRollbackDepth, depth);
+    }
+
+    if (frame <= m_lastFrame)
+    {
+      CaptureSavestate(*m_savestates, frame, m_result);
+      Simulate(frame);
+      m_simulatedFrame = frame;
+    }
+
+    return true;
+  }
+
+  // Checks the finished match against playing the remote inputs straight through
+  void CheckResults()
+  {
+    m_savestates.reset();
+
+    // The counter is preserved through loads, so it saw every simulation
+    EXPECT_EQ(m_result.simulatedFrames, SyntheticGame::SimulatedFrames());
+
+    int padMismatches = 0;
+    for (s32 f = INPUT_DELAY + 1; f <= m_lastFrame; f++)
+    {
+      if (m_remoteActual[f] != GeneratePad(1, f))
+        padMismatches++;
+    }
+    EXPECT_EQ(0, padMismatches);
+
+    // Rolling back must end up where playing the confirmed inputs straight through does
+    u64 onlineHash = SyntheticGame::Hash();
+    SyntheticGame::Reset();
+    for (s32 f = 1; f <= m_lastFrame; f++)
+      SyntheticGame::SimulateFrame(f, LocalPad(f), m_remoteActual[f]);
+    EXPECT_EQ(SyntheticGame::Hash(), onlineHash);
+  }
+
+private:
+  // Remote inputs not received yet are predicted to stay the same as the latest ones
+  void Simulate(s32 frame)
+  {
+    m_remoteUsed[frame] = m_remoteActual[std::min(frame, m_remoteKnownFrame)];
+    SyntheticGame::SimulateFrame(frame, LocalPad(frame), m_remoteUsed[frame]);
+    m_result.simulatedFrames++;
+  }
+
+  s32 m_lastFrame;
+  BenchmarkResult& m_result;
+  std::unique_ptr<SlippiSavestate> m_savestates;
+  std::vector<u64> m_remoteActual;
+  std::vector<u64> m_remoteUsed;
+  s32 m_remoteKnownFrame = 0;
+  s32 m_confirmedFrame = 0;
+  s32 m_simulatedFrame = 0;
+};
+
+void RunBenchmark(const BenchmarkConfig& config)
+{
+  ScopeInit guard(config.trackWrites);
+  LossyRelay relay(config.link);
+
+  auto local = std::make_unique<SlippiNetplayClient>("127.0.0.1", relay.GetPort(0), 0, true);
+  auto remote = std::make_unique<SlippiNetplayClient>("127.0.0.1", relay.GetPort(1), 0, false);
+
+  const auto connected = SlippiNetplayClient::SlippiConnectStatus::NET_CONNECT_STATUS_CONNECTED;
+  ASSERT_TRUE(WaitFor([&] {
+    return local->GetSlippiConnectStatus() == connected &&
+           remote->GetSlippiConnectStatus() == connected;
+  }));
+
+  // Selections carry the pad encoding each side reads
+  SlippiPlayerSelections selections;
+  selections.rngOffset = 1;
+  local->SetMatchSelections(selections);
+  remote->SetMatchSelections(selections);
+  ASSERT_TRUE(WaitFor([&] {
+    return local->GetMatchInfo()->remotePlayerSelections.rngOffset == 1 &&
+           remote->GetMatchInfo()->remotePlayerSelections.rngOffset == 1;
+  }));
+
+  local->StartSlippiGame();
+  remote->StartSlippiGame();
+
+  const s32 lastFrame = config.frames;
+  BenchmarkResult result;
+  LocalGame game(lastFrame, result);
+  std::atomic<bool> done{false};
+
+  // The remote client only sends its inputs, halting like the game does when too far ahead
+  std::thread remoteThread([&] {
+    u8 remotePads[SLIPPI_PAD_FULL_SIZE * ROLLBACK_MAX_FRAMES];
+    auto start = std::chrono::steady_clock::now();
+    s32 frame = 1;
+
+    for (u64 tick = 1; !done; tick++)
+    {
+      PaceFrame(start, tick, config.frameUs);
+
+      bool stalled = frame - remote->GetSlippiLatestRemoteFrame() >= ROLLBACK_MAX_FRAMES;
+      if (stalled || frame + INPUT_DELAY > lastFrame)
+      {
+        remote->SendSlippiPad(nullptr);
+        continue;
+      }
+
+      u64 padValue = GeneratePad(1, frame + INPUT_DELAY);
+      SlippiPad pad(frame + INPUT_DELAY, (u8*)&padValue);
+      remote->SendSlippiPad(&pad);
+      remote->GetSlippiRemotePad(frame, remotePads, ROLLBACK_MAX_FRAMES);
+      frame++;
+    }
+  });
+
+  u8 remotePads[SLIPPI_PAD_FULL_SIZE * ROLLBACK_MAX_FRAMES];
+  auto start = std::chrono::steady_clock::now();
+  s32 frame = 1;
+
+  for (u64 tick = 1; game.GetConfirmedFrame() < lastFrame; tick++)
+  {
+    PaceFrame(start, tick, config.frameUs);
+    if (std::chrono::steady_clock::now() - start > std::chrono::seconds(60))
+    {
+      ADD_FAILURE() << "Remote inputs stopped arriving at frame " << game.GetRemoteKnownFrame();
+      break;
+    }
+
+    // CMD_ONLINE_INPUTS
+    if (frame - local->GetSlippiLatestRemoteFrame() >= ROLLBACK_MAX_FRAMES)
+    {
+      result.stallFrames++;
+      local->SendSlippiPad(nullptr);
+      continue;
+    }
+
+    if (frame <= lastFrame)
+    {
+      u64 padValue = LocalGame::LocalPad(frame + INPUT_DELAY);
+      SlippiPad pad(frame + INPUT_DELAY, (u8*)&padValue);
+      local->SendSlippiPad(&pad);
+    }
+    else
+    {
+      local->SendSlippiPad(nullptr);
+    }
+
+    // Pads come newest first
+    s32 latestFrame = local->GetSlippiRemotePad(frame, remotePads, ROLLBACK_MAX_FRAMES);
+    if (!game.RunFrame(frame, latestFrame, remotePads))
+      break;
+
+    frame++;
+  }
+
+  done = true;
+  remoteThread.join();
+  if (game.GetConfirmedFrame() < lastFrame)
+    return;
+
+  PrintResult(config, result, game.GetBackupSize(), relay.GetDropped(),
+              relay.GetDropped() + relay.GetForwarded());
+  game.CheckResults();
+}
+
+// One direction of a link in simulated time. Every tick the sender sends the latest frame it has
+// sent inputs for, which stands for a packet carrying all its unacked inputs, so a lost packet
+// only delays those inputs until a later one arrives
+class SimulatedLink
+{
+public:
+  SimulatedLink(const LinkConfig& config, u32 seed) : m_config(config), m_random(seed) {}
+
+  void Send(u64 nowUs, s32 latestFrame)
+  {
+    m_sent++;
+    if (m_random() % 100 < m_config.lossPercent)
+    {
+      m_dropped++;
+      return;
+    }
+
+    u64 latency = m_config.latencyUs;
+    if (m_config.jitterUs)
+      latency += m_random() % (m_config.jitterUs + 1);
+    m_inFlight.emplace(nowUs + latency, latestFrame);
+  }
+
+  // Latest frame the receiver has the inputs of
+  s32 Receive(u64 nowUs)
+  {
+    while (!m_inFlight.empty() && m_inFlight.begin()->first <= nowUs)
+    {
+      m_received = std::max(m_received, m_inFlight.begin()->second);
+      m_inFlight.erase(m_inFlight.begin());
+    }
+
+    return m_received;
+  }
+
+  u64 GetSent() const { return m_sent; }
+  u64 GetDropped() const { return m_dropped; }
+
+private:
+  LinkConfig m_config;
+  std::mt19937 m_random;
+  std::multimap<u64, s32> m_inFlight;
+  // StartSlippiGame fills in the pads of the first INPUT_DELAY frames
+  s32 m_received = INPUT_DELAY;
+  u64 m_sent = 0;
+  u64 m_dropped = 0;
+};
+
+// Same match as RunBenchmark, with both sides stepped on one thread and the link replaced by a
+// simulated one, so a run takes no longer than its captures and loads and always plays out the
+// same way
+BenchmarkResult RunSimulated(const BenchmarkConfig& config)
+{
+  ScopeInit guard(config.trackWrites);
+  SimulatedLink toLocal(config.link, 0x51199);
+  SimulatedLink toRemote(config.link, 0x99115);
+
+  const s32 lastFrame = config.frames;
+  BenchmarkResult result;
+  LocalGame game(lastFrame, result);
+
+  u8 remotePads[SLIPPI_PAD_FULL_SIZE * ROLLBACK_MAX_FRAMES] = {};
+  s32 frame = 1;
+  s32 localSent = INPUT_DELAY;
+  s32 remoteFrame = 1;
+  s32 remoteSent = INPUT_DELAY;
+
+  for (u64 tick = 1; game.GetConfirmedFrame() < lastFrame; tick++)
+  {
+    u64 nowUs = tick * config.frameUs;
+    if (tick > 10 * (u64)lastFrame)
+    {
+      ADD_FAILURE() << "Remote inputs stopped arriving at frame " << game.GetRemoteKnownFrame();
+      break;
+    }
+
+    // The remote side, halting like the game does when too far ahead
+    if (remoteFrame - toRemote.Receive(nowUs) < ROLLBACK_MAX_FRAMES &&
+        remoteFrame + INPUT_DELAY <= lastFrame)
+    {
+      remoteSent = remoteFrame + INPUT_DELAY;
+      remoteFrame++;
+    }
+    toLocal.Send(nowUs, remoteSent);
+
+    // CMD_ONLINE_INPUTS
+    s32 latestFrame = toLocal.Receive(nowUs);
+    if (frame - latestFrame >= ROLLBACK_MAX_FRAMES)
+    {
+      result.stallFrames++;
+      toRemote.Send(nowUs, localSent);
+      continue;
+    }
+
+    if (frame <= lastFrame)
+      localSent = frame + INPUT_DELAY;
+    toRemote.Send(nowUs, localSent);
+
+    // Pads come newest first, the first INPUT_DELAY frames being empty
+    for (s32 i = 0; i < ROLLBACK_MAX_FRAMES && latestFrame - i > 0; i++)
+    {
+      u64 padValue = latestFrame - i > INPUT_DELAY ? GeneratePad(1, latestFrame - i) : 0;
+      memcpy(&remotePads[i * SLIPPI_PAD_FULL_SIZE], &padValue, SLIPPI_PAD_DATA_SIZE);
+    }
+
+    if (!game.RunFrame(frame, latestFrame, remotePads))
+      break;
+
+    frame++;
+  }
+
+  if (game.GetConfirmedFrame() < lastFrame)
+    return result;
+
+  PrintResult(config, result, game.GetBackupSize(), toLocal.GetDropped() + toRemote.GetDropped(),
+              toLocal.GetSent() + toRemote.GetSent());
+  game.CheckResults();
+  return result;
+}
+}  // namespace
+
+// Frames run four times faster than the game's so that a run takes a couple of seconds. Latency
+// is scaled to match, so rollbacks are as many frames deep as they would be at 60 fps.
+TEST(SlippiRollbackBenchmark, DISABLED_Lan)
+{
+  RunBenchmark({"lan", {0, 0, 0}, 600, FRAME_US / 4, true});
+}
+
+TEST(SlippiRollbackBenchmark, DISABLED_TwoFrameLatency)
+{
+  RunBenchmark({"2 frames", {FRAME_US / 2, FRAME_US / 8, 0}, 600, FRAME_US / 4, true});
+}
+
+TEST(SlippiRollbackBenchmark, DISABLED_FourFrameLatencyWithLoss)
+{
+  RunBenchmark({"4 frames, lossy", {FRAME_US, FRAME_US / 4, 5}, 600, FRAME_US / 4, true});
+}
+
+TEST(SlippiRollbackBenchmark, DISABLED_ComparingChunks)
+{
+  RunBenchmark({"2 frames, no tracking", {FRAME_US / 2, FRAME_US / 8, 0}, 600, FRAME_US / 4, false});
+}
+
+TEST(SlippiRollbackBenchmark, SimulatedFourFrameLatencyWithLoss)
+{
+  const BenchmarkConfig config = {"simulated 4 frames, lossy", {4 * FRAME_US, FRAME_US, 5}, 300,
+                                  FRAME_US, true};
+  BenchmarkResult first = RunSimulated(config);
+  EXPECT_EQ(50u, first.rollbacks);
+  EXPECT_EQ(151u, first.rollbackFrames);
+  EXPECT_EQ(4, first.maxRollbackDepth);
+  EXPECT_EQ(0u, first.stallFrames);
+  EXPECT_EQ(config.frames + first.rollbackFrames, first.simulatedFrames);
+
+  BenchmarkResult second = RunSimulated(config);
+  EXPECT_EQ(first.rollbacks, second.rollbacks);
+  EXPECT_EQ(first.rollbackFrames, second.rollbackFrames);
+  EXPECT_EQ(first.stallFrames, second.stallFrames);
+}
+
+TEST(SlippiRollbackBenchmark, Custom)
+{
+  const char* env = getenv("SLIPPI_ROLLBACK_BENCH");
+  if (!env)
+    return;
+
+  u32 latencyMs = 0, jitterMs = 0, lossPercent = 0;
+  int frames = 3600;
+  ASSERT_GE(sscanf(env, "%u,%u,%u,%d", &latencyMs, &jitterMs, &lossPercent, &frames), 1);
+  RunBenchmark({"custom", {latencyMs * 1000, jitterMs * 1000, lossPercent}, frames, FRAME_US, true});
+}
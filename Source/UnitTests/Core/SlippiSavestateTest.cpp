@@ -0,0 +1,116 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <cstring>
+#include <gtest/gtest.h>
+#include <vector>
+#include <xxhash.h>
+
+#include "Common/CommonTypes.h"
+#include "Core/ConfigManager.h"
+#include "Core/HW/Memmap.h"
+#include "Core/MemTools.h"
+#include "Core/Slippi/SlippiSavestate.h"
+
+namespace
+{
+const int ROLLBACK_MAX_FRAMES = 7;
+
+// Part of the heap, which SlippiSavestate backs up in full
+const u32 HEAP_BASE = 0x80C00000;
+const u32 HEAP_PAGES = 256;
+
+class ScopeInit final
+{
+public:
+  ScopeInit()
+  {
+    SConfig::Init();
+    SConfig::GetInstance().bFastmem = false;
+    EMM::InstallExceptionHandler();
+    Memory::Init();
+  }
+  ~ScopeInit()
+  {
+    Memory::Shutdown();
+    EMM::UninstallExceptionHandler();
+    SConfig::Shutdown();
+  }
+};
+
+u64 HashHeap()
+{
+  return XXH64(Memory::GetPointer(HEAP_BASE), HEAP_PAGES * Memory::TRACKED_PAGE_SIZE, 0);
+}
+
+// Changes a word in pageCount pages, starting at a different page every frame
+void WriteFrame(s32 frame, u32 pageCount)
+{
+  for (u32 i = 0; i < pageCount; i++)
+  {
+    u32 page = (frame * 37 + i) % HEAP_PAGES;
+    u32 value = frame * 0x10001 + i;
+    memcpy(Memory::GetPointer(HEAP_BASE + page * Memory::TRACKED_PAGE_SIZE + 16), &value,
+           sizeof(value));
+  }
+}
+}  // namespace
+
+// Frames change far more memory than the deltas start out with. Every frame of the rollback
+// window has to stay loadable anyway
+TEST(SlippiSavestate, KeepsRollbackWindowWhenDeltasOverflow)
+{
+  ScopeInit guard;
+  memset(Memory::GetPointer(HEAP_BASE), 0, HEAP_PAGES * Memory::TRACKED_PAGE_SIZE);
+
+  SlippiSavestate savestates(ROLLBACK_MAX_FRAMES, 4 * Memory::TRACKED_PAGE_SIZE);
+  std::vector<u64> hashes(ROLLBACK_MAX_FRAMES + 1);
+
+  for (s32 frame = 1; frame <= ROLLBACK_MAX_FRAMES; frame++)
+  {
+    savestates.Capture(frame);
+    hashes[frame] = HashHeap();
+    WriteFrame(frame, 64);
+  }
+
+  for (s32 frame = 1; frame <= ROLLBACK_MAX_FRAMES; frame++)
+    EXPECT_TRUE(savestates.HasFrame(frame)) << "frame " << frame;
+
+  // Back to the middle of the window, then play on and grow the deltas from there
+  ASSERT_TRUE(savestates.Load(4, {}));
+  EXPECT_EQ(hashes[4], HashHeap());
+  for (s32 frame = 4; frame <= ROLLBACK_MAX_FRAMES; frame++)
+  {
+    if (frame != 4)
+      savestates.Capture(frame);
+    hashes[frame] = HashHeap();
+    WriteFrame(frame + 100, 128);
+  }
+
+  ASSERT_TRUE(savestates.Load(1, {}));
+  EXPECT_EQ(hashes[1], HashHeap());
+}
+
+// Frames beyond the window are dropped, the rest still load
+TEST(SlippiSavestate, DropsFramesOutsideRollbackWindow)
+{
+  ScopeInit guard;
+  memset(Memory::GetPointer(HEAP_BASE), 0, HEAP_PAGES * Memory::TRACKED_PAGE_SIZE);
+
+  SlippiSavestate savestates(ROLLBACK_MAX_FRAMES, 0);
+  std::vector<u64> hashes(3 * ROLLBACK_MAX_FRAMES + 1);
+
+  for (s32 frame = 1; frame <= 3 * ROLLBACK_MAX_FRAMES; frame++)
+  {
+    savestates.Capture(frame);
+    hashes[frame] = HashHeap();
+    WriteFrame(frame, 16);
+  }
+
+  const s32 oldest = 2 * ROLLBACK_MAX_FRAMES + 1;
+  EXPECT_FALSE(savestates.HasFrame(oldest - 1));
+  EXPECT_TRUE(savestates.HasFrame(oldest));
+  ASSERT_TRUE(savestates.Load(oldest, {}));
+  EXPECT_EQ(hashes[oldest], HashHeap());
+}
@@ -0,0 +1,225 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+#include <algorithm>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "Core/Slippi/SlippiTimeSync.h"
+
+namespace
+{
+// Deterministic stand-in for a network link between two clients running at the same frame rate.
+// Each client paces its frames like the frame limiter would: delays from the time sync are
+// absorbed at most a quarter frame at a time, and skipped frames halt the game for a frame.
+class SimulatedLink
+{
+public:
+  struct Config
+  {
+    u32 latencyUs[2];    // one way latency from each client to the other
+    u32 jitterUs;        // random extra latency, up to this
+    u32 spikeEvery;      // one packet in this many is delayed by spikeUs more
+    u32 spikeUs;
+    u32 startDelayUs[2]; // when each client reaches frame 1
+  };
+
+  struct Stats
+  {
+    int skippedFrames = 0;
+    int rollbackFrames = 0;
+    s64 maxSyncErrorUs = 0; // difference between when the clients reach the same frame
+  };
+
+  static const s32 INPUT_DELAY = 2;
+  static const s32 ROLLBACK_MAX_FRAMES = 7;
+  static const s32 TIME_SYNC_INTERVAL = 30;
+
+  explicit SimulatedLink(const Config& config) : m_config(config)
+  {
+    for (int i = 0; i < 2; i++)
+      m_clients[i].nextFrameUs = config.startDelayUs[i];
+  }
+
+  // Runs until both clients reach lastFrame. Stats only count frames from statsFrame on
+  Stats Run(s32 lastFrame, s32 statsFrame)
+  {
+    Stats stats;
+    while (m_clients[0].frame < lastFrame || m_clients[1].frame < lastFrame)
+    {
+      // Next event: a client's frame or a packet arrival
+      int client = m_clients[0].nextFrameUs <= m_clients[1].nextFrameUs ? 0 : 1;
+      auto packet = std::min_element(m_packets.begin(), m_packets.end(),
+                                     [](const Packet& a, const Packet& b) { return a.arrivalUs < b.arrivalUs; });
+      if (packet != m_packets.end() && packet->arrivalUs <= m_clients[client].nextFrameUs)
+      {
+        Receive(*packet, statsFrame, &stats);
+        m_packets.erase(packet);
+        continue;
+      }
+
+      RunFrame(client, statsFrame, &stats);
+    }
+
+    return stats;
+  }
+
+private:
+  struct Client
+  {
+    SlippiTimeSync sync;
+    s32 frame = 0;
+    s32 latestRemoteFrame = 0;
+    u64 nextFrameUs = 0;
+    u64 delayUs = 0;
+    int skipFrames = 0;
+    s32 lastSentFrame = 0;
+    u64 lastSentUs = 0;
+    std::vector<u64> frameTimesUs;
+  };
+
+  struct Packet
+  {
+    int to;
+    s32 frame; // frame the inputs are for
+    u64 sentUs;
+    u64 arrivalUs;
+  };
+
+  u32 Random()
+  {
+    m_seed = m_seed * 1103515245 + 12345;
+    return (m_seed >> 8) & 0xFFFFFF;
+  }
+
+  u32 Latency(int from)
+  {
+    u32 latency = m_config.latencyUs[from] + (m_config.jitterUs ? Random() % m_config.jitterUs : 0);
+    if (m_config.spikeEvery && Random() % m_config.spikeEvery == 0)
+      latency += m_config.spikeUs;
+    return latency;
+  }
+
+  void RunFrame(int i, s32 statsFrame, Stats* stats)
+  {
+    Client& c = m_clients[i];
+    u64 now = c.nextFrameUs;
+    c.nextFrameUs += SlippiTimeSync::FRAME_US;
+
+    bool counted = c.frame >= statsFrame;
+    bool rollbackLimit = c.frame + 1 - c.latestRemoteFrame >= ROLLBACK_MAX_FRAMES;
+    if (c.skipFrames > 0 || rollbackLimit)
+    {
+      if (c.skipFrames > 0)
+        c.skipFrames--;
+      if (counted)
+        stats->skippedFrames++;
+      return;
+    }
+
+    c.frame++;
+    c.frameTimesUs.push_back(now);
+    c.lastSentFrame = c.frame + INPUT_DELAY;
+    c.lastSentUs = now;
+    m_packets.push_back({1 - i, c.lastSentFrame, now, now + Latency(i)});
+
+    if (c.frame % TIME_SYNC_INTERVAL == 0)
+    {
+      SlippiTimeSync::ssCorrection correction = c.sync.Update(c.frame);
+      c.delayUs += correction.delayUs;
+      c.skipFrames += correction.skipFrames;
+    }
+
+    // The frame limiter stretches frames by at most a quarter
+    u64 stretch = std::min<u64>(c.delayUs, SlippiTimeSync::FRAME_US / 4);
+    c.delayUs -= stretch;
+    c.nextFrameUs += stretch;
+
+    const Client& other = m_clients[1 - i];
+    if (counted && c.frame <= other.frame)
+    {
+      s64 error = (s64)now - (s64)other.frameTimesUs[c.frame - 1];
+      stats->maxSyncErrorUs = std::max(stats->maxSyncErrorUs, std::abs(error));
+    }
+  }
+
+  void Receive(const Packet& packet, s32 statsFrame, Stats* stats)
+  {
+    Client& c = m_clients[packet.to];
+
+    c.sync.AddRttSample(packet.arrivalUs - packet.sentUs + Latency(packet.to));
+    c.sync.AddRemoteFrame(packet.frame, c.lastSentFrame, c.lastSentUs, packet.arrivalUs);
+
+    // Inputs for a frame that was already run with a prediction
+    if (c.frame >= statsFrame && c.frame >= packet.frame)
+      stats->rollbackFrames += c.frame - packet.frame + 1;
+
+    c.latestRemoteFrame = std::max(c.latestRemoteFrame, packet.frame);
+  }
+
+  Config m_config;
+  Client m_clients[2];
+  std::vector<Packet> m_packets;
+  u32 m_seed = 1;
+};
+}  // namespace
+
+TEST(SlippiTimeSync, SteadyLink)
+{
+  SlippiTimeSync sync;
+  EXPECT_EQ(0, sync.GetOffsetUs());
+
+  // 8ms ahead of the opponent with no jitter, and an RTT of 20ms
+  sync.AddRttSample(20000);
+  for (s32 frame = 1; frame <= 60; frame++)
+    sync.AddRemoteFrame(frame, frame, 100000 + frame * SlippiTimeSync::FRAME_US,
+                        100000 + frame * SlippiTimeSync::FRAME_US + 18000);
+  EXPECT_NEAR(8000, sync.GetOffsetUs(), 100);
+
+  // Corrected by stretching frames, not skipping them
+  SlippiTimeSync::ssCorrection correction = sync.Update(60);
+  EXPECT_EQ(0, correction.skipFrames);
+  EXPECT_GT(correction.delayUs, 0u);
+  EXPECT_EQ(8000 - (s32)correction.delayUs, sync.GetOffsetUs());
+}
+
+TEST(SlippiTimeSync, OutlierIsClamped)
+{
+  SlippiTimeSync sync;
+  for (s32 frame = 1; frame <= 120; frame++)
+    sync.AddRemoteFrame(frame, frame, frame * SlippiTimeSync::FRAME_US, frame * SlippiTimeSync::FRAME_US);
+
+  // A single packet stuck for 200ms barely moves the estimate
+  sync.AddRemoteFrame(121, 121, 121 * SlippiTimeSync::FRAME_US, 121 * SlippiTimeSync::FRAME_US + 200000);
+  EXPECT_LT(sync.GetOffsetUs(), 1000);
+  EXPECT_EQ(0u, sync.Update(150).delayUs);
+}
+
+TEST(SlippiTimeSync, LateStartIsSkipped)
+{
+  SimulatedLink::Config config = {{20000, 20000}, 2000, 0, 0, {0, 100000}};
+  SimulatedLink link(config);
+  SimulatedLink::Stats stats = link.Run(60 * 60, 600);
+
+  // Six frames apart at the start, skipped early on and then kept in sync by stretching. The
+  // latency is within the input delay, so a client that is kept in sync never rolls back
+  EXPECT_EQ(0, stats.skippedFrames);
+  EXPECT_EQ(0, stats.rollbackFrames);
+  EXPECT_LT(stats.maxSyncErrorUs, 8000);
+}
+
+TEST(SlippiTimeSync, AsymmetricJitteryLink)
+{
+  // 30ms one way and 10ms the other, with jitter and the odd 40ms spike
+  SimulatedLink::Config config = {{30000, 10000}, 6000, 40, 40000, {0, 30000}};
+  SimulatedLink link(config);
+  SimulatedLink::Stats stats = link.Run(60 * 120, 600);
+
+  // The clients settle half the asymmetry apart, which they can't see, and stay there. Only the
+  // spiked packets roll back, by a couple of frames each
+  EXPECT_EQ(0, stats.skippedFrames);
+  EXPECT_LT(stats.maxSyncErrorUs, 10000 + 4000);
+  EXPECT_LT(stats.rollbackFrames, 3 * 2 * (60 * 120 - 600) / 40);
+}
@@ -0,0 +1,158 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// The software rasterizer shades the EFB tiles of a draw call on several threads. Drawing the
+// same triangles with the tiles shaded one after another has to give exactly the same EFB and
+// counters. The triangles are placed across tile edges, where neighbouring pixels belong to
+// tiles that may be shaded at the same time.
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "VideoBackends/Software/EfbInterface.h"
+#include "VideoBackends/Software/NativeVertexFormat.h"
+#include "VideoBackends/Software/Rasterizer.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/BoundingBox.h"
+#include "VideoCommon/PerfQueryBase.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+constexpr int DRAW_CALLS = 20;
+constexpr int TRIANGLES_PER_CALL = 500;
+
+void SetupBPMem(PEControl::PixelFormat format, bool alphaUpdate)
+{
+  memset(&bpmem, 0, sizeof(bpmem));
+
+  // One stage blending the rasterized colour with a register
+  bpmem.genMode.numcolchans = 1;
+  bpmem.genMode.numtevstages = 0;
+  TevStageCombiner& combiner = bpmem.combiners[0];
+  combiner.colorC.a = TEVCOLORARG_RASC;
+  combiner.colorC.b = TEVCOLORARG_C0;
+  combiner.colorC.c = TEVCOLORARG_RASA;
+  combiner.colorC.d = TEVCOLORARG_ZERO;
+  combiner.colorC.clamp = 1;
+  combiner.alphaC.a = TEVALPHAARG_RASA;
+  combiner.alphaC.d = TEVALPHAARG_ZERO;
+  combiner.alphaC.clamp = 1;
+  bpmem.tevorders[0].colorchan0 = 0;
+  bpmem.tevksel[0].swap1 = 0;
+  bpmem.tevksel[0].swap2 = 1;
+  bpmem.tevksel[1].swap1 = 2;
+  bpmem.tevksel[1].swap2 = 3;
+  bpmem.alpha_test.comp0 = AlphaTest::ALWAYS;
+  bpmem.alpha_test.comp1 = AlphaTest::ALWAYS;
+
+  // Depth tested and blended, so every pixel reads what was drawn before it
+  bpmem.zmode.testenable = 1;
+  bpmem.zmode.func = ZMode::LEQUAL;
+  bpmem.zmode.updateenable = 1;
+  bpmem.blendmode.blendenable = 1;
+  bpmem.blendmode.srcfactor = BlendMode::SRCALPHA;
+  bpmem.blendmode.dstfactor = BlendMode::INVSRCALPHA;
+  bpmem.blendmode.colorupdate = 1;
+  bpmem.blendmode.alphaupdate = alphaUpdate;
+  bpmem.zcontrol.pixel_format = format;
+
+  // Scissor covering the whole EFB
+  bpmem.scissorOffset.x = 171;
+  bpmem.scissorOffset.y = 171;
+  bpmem.scissorTL.x = 342;
+  bpmem.scissorTL.y = 342;
+  bpmem.scissorBR.x = 342 + EFB_WIDTH - 1;
+  bpmem.scissorBR.y = 342 + EFB_HEIGHT - 1;
+}
+
+// Small triangles around the tile edges, including the right and bottom edges of the EFB
+float NearEdge(std::mt19937& rng, int size)
+{
+  const int edges = (size + EfbInterface::TILE_SIZE - 1) / EfbInterface::TILE_SIZE;
+  const int edge = (rng() % (edges + 1)) * EfbInterface::TILE_SIZE;
+  return static_cast<float>(std::min(edge, size)) + static_cast<int>(rng() % 13) - 6.0f;
+}
+
+struct Results
+{
+  std::vector<u8> color;
+  std::vector<u8> depth;
+  std::vector<u32> perfValues;
+};
+
+Results Draw(PEControl::PixelFormat format, bool alphaUpdate, bool parallel)
+{
+  SetupBPMem(format, alphaUpdate);
+  Rasterizer::Init();
+  Rasterizer::SetScissor();
+  for (int comp = 0; comp < 4; ++comp)
+    Rasterizer::SetTevReg(1, comp, false, 60 + comp * 40);
+  memset(EfbInterface::perf_values, 0, sizeof(EfbInterface::perf_values));
+  memset(EfbInterface::perf_quad_pixels, 0, sizeof(EfbInterface::perf_quad_pixels));
+
+  const size_t planeSize = EFB_WIDTH * EFB_HEIGHT * 3;
+  u8* color = EfbInterface::GetPixelPointer(0, 0, false);
+  u8* depth = EfbInterface::GetPixelPointer(0, 0, true);
+  memset(color, 0x55, planeSize);
+  memset(depth, 0xff, planeSize);
+
+  std::mt19937 rng(7);
+  for (int call = 0; call < DRAW_CALLS; ++call)
+  {
+    for (int i = 0; i < TRIANGLES_PER_CALL; ++i)
+    {
+      const float centerX = NearEdge(rng, EFB_WIDTH);
+      const float centerY = NearEdge(rng, EFB_HEIGHT);
+      OutputVertexData vertices[3];
+      for (OutputVertexData& vertex : vertices)
+      {
+        vertex.screenPosition.x = centerX + static_cast<int>(rng() % 25) - 12.0f;
+        vertex.screenPosition.y = centerY + static_cast<int>(rng() % 25) - 12.0f;
+        vertex.screenPosition.z = static_cast<float>(rng() & 0xffffff);
+        vertex.projectedPosition.w = 1.0f;
+        for (u8& comp : vertex.color[0])
+          comp = rng() & 0xff;
+      }
+      // Both windings, as culling is done before the rasterizer
+      Rasterizer::DrawTriangleFrontFace(&vertices[0], &vertices[1], &vertices[2]);
+      Rasterizer::DrawTriangleFrontFace(&vertices[2], &vertices[1], &vertices[0]);
+    }
+    Rasterizer::Flush(parallel);
+  }
+
+  Results results;
+  results.color.assign(color, color + planeSize);
+  results.depth.assign(depth, depth + planeSize);
+  results.perfValues.assign(EfbInterface::perf_values, EfbInterface::perf_values + PQ_NUM_MEMBERS);
+  return results;
+}
+}
+
+TEST(SoftwareRasterizer, ParallelTilesMatchSerial)
+{
+  BoundingBox::active = false;
+  g_ActiveConfig.bDumpTevStages = false;
+  g_ActiveConfig.bDumpTevTextureFetches = false;
+
+  const PEControl::PixelFormat formats[] = {PEControl::RGB8_Z24, PEControl::RGBA6_Z24};
+  for (PEControl::PixelFormat format : formats)
+  {
+    for (bool alphaUpdate : {false, true})
+    {
+      SCOPED_TRACE(testing::Message() << "format " << static_cast<int>(format) << ", alpha update "
+                                      << alphaUpdate);
+      const Results serial = Draw(format, alphaUpdate, false);
+      const Results parallel = Draw(format, alphaUpdate, true);
+      EXPECT_EQ(serial.color, parallel.color);
+      EXPECT_EQ(serial.depth, parallel.depth);
+      EXPECT_EQ(serial.perfValues, parallel.perfValues);
+    }
+  }
+}
@@ -0,0 +1,275 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// The software renderer shades the pixels of a raster block together with Tev::DrawSpan, which
+// has to give exactly what Tev::Draw gives for each of the pixels. Both are run on random TEV
+// setups, textures and pixels, and the EFB contents and counters they leave are compared.
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "VideoBackends/Software/EfbInterface.h"
+#include "VideoBackends/Software/Tev.h"
+#include "VideoCommon/BPMemory.h"
+#include "VideoCommon/BoundingBox.h"
+#include "VideoCommon/PerfQueryBase.h"
+#include "VideoCommon/TextureDecoder.h"
+#include "VideoCommon/VideoConfig.h"
+
+namespace
+{
+// The pixels are drawn into this corner of the EFB
+constexpr int AREA_SIZE = 8;
+
+const TextureFormat TEXTURE_FORMATS[] = {GX_TF_I4,     GX_TF_I8,    GX_TF_IA4, GX_TF_IA8,
+                                         GX_TF_RGB565, GX_TF_RGB5A3, GX_TF_RGBA8, GX_TF_C4,
+                                         GX_TF_C8,     GX_TF_C14X2, GX_TF_CMPR};
+
+u32 Bits(std::mt19937& rng, int bits)
+{
+  return rng() & ((1u << bits) - 1);
+}
+
+s16 RegisterValue(std::mt19937& rng)
+{
+  return static_cast<s16>(static_cast<int>(Bits(rng, 11)) - 1024);
+}
+
+void RandomizeTextures(std::mt19937& rng)
+{
+  for (FourTexUnits& texUnit : bpmem.tex)
+  {
+    for (int i = 0; i < 4; ++i)
+    {
+      texUnit.texMode0[i].hex = Bits(rng, 21);
+      texUnit.texMode0[i].wrap_s = Bits(rng, 2) % 3;
+      texUnit.texMode0[i].wrap_t = Bits(rng, 2) % 3;
+
+      texUnit.texImage0[i].width = Bits(rng, 5);
+      texUnit.texImage0[i].height = Bits(rng, 5);
+      texUnit.texImage0[i].format = TEXTURE_FORMATS[rng() % (sizeof(TEXTURE_FORMATS) / sizeof(TEXTURE_FORMATS[0]))];
+
+      // Textures are preloaded into TMEM, the palettes are placed after them
+      texUnit.texImage1[i].tmem_even = Bits(rng, 8);
+      texUnit.texImage1[i].image_type = 1;
+      texUnit.texImage2[i].tmem_odd = 256 + Bits(rng, 8);
+      texUnit.texTlut[i].tmem_offset = 512 + Bits(rng, 4);
+      texUnit.texTlut[i].tlut_format = Bits(rng, 2) % 3;
+    }
+  }
+}
+
+void RandomizeBPMem(std::mt19937& rng)
+{
+  memset(&bpmem, 0, sizeof(bpmem));
+
+  bpmem.genMode.numtexgens = Bits(rng, 4) % 9;
+  bpmem.genMode.numcolchans = Bits(rng, 2) % 3;
+  bpmem.genMode.numtevstages = Bits(rng, 4);
+  bpmem.genMode.numindstages = Bits(rng, 3) % 5;
+
+  for (IND_MTX& indmtx : bpmem.indmtx)
+  {
+    indmtx.col0.hex = rng();
+    indmtx.col1.hex = rng();
+    indmtx.col2.hex = rng();
+  }
+  for (TevStageIndirect& indirect : bpmem.tevind)
+    indirect.hex = Bits(rng, 21);
+  for (TEXSCALE& texscale : bpmem.texscale)
+    texscale.hex = Bits(rng, 16);
+  bpmem.tevindref.hex = Bits(rng, 24);
+
+  for (TwoTevStageOrders& order : bpmem.tevorders)
+    order.hex = Bits(rng, 24);
+  for (TevStageCombiner& combiner : bpmem.combiners)
+  {
+    combiner.colorC.hex = Bits(rng, 24);
+    combiner.alphaC.hex = Bits(rng, 24);
+  }
+  for (TevKSel& ksel : bpmem.tevksel)
+    ksel.hex = Bits(rng, 24);
+
+  bpmem.alpha_test.hex = Bits(rng, 24);
+  bpmem.ztex1.hex = Bits(rng, 24);
+  bpmem.ztex2.hex = Bits(rng, 4);
+
+  // Fog without the range adjustment, which needs the viewport
+  bpmem.fog.a.mantissa = Bits(rng, 11);
+  bpmem.fog.a.exponent = 124 + Bits(rng, 3);
+  bpmem.fog.b_magnitude = Bits(rng, 24);
+  bpmem.fog.b_shift = Bits(rng, 5) % 24;
+  bpmem.fog.c_proj_fsel.hex = Bits(rng, 24);
+  bpmem.fog.c_proj_fsel.c_exp = 120 + Bits(rng, 3);
+  bpmem.fog.color.hex = Bits(rng, 24);
+
+  bpmem.zmode.hex = Bits(rng, 5);
+  bpmem.blendmode.hex = Bits(rng, 16);
+  bpmem.dstalpha.hex = Bits(rng, 9);
+  bpmem.zcontrol.hex = Bits(rng, 7);
+  bpmem.zcontrol.pixel_format = static_cast<PEControl::PixelFormat>(Bits(rng, 2) % 3);
+
+  RandomizeTextures(rng);
+}
+
+struct PixelInputs
+{
+  s32 position[3];
+  u8 color[2][4];
+  Tev::TextureCoordinateType uv[8];
+};
+
+// Some of the pixels of a 2x2 block
+std::vector<PixelInputs> RandomPixels(std::mt19937& rng)
+{
+  const s32 blockX = Bits(rng, 2) * 2;
+  const s32 blockY = Bits(rng, 2) * 2;
+  const u32 coverage = 1 + rng() % 15;
+
+  std::vector<PixelInputs> pixels;
+  for (int i = 0; i < 4; ++i)
+  {
+    if (!(coverage & (1 << i)))
+      continue;
+
+    PixelInputs pixel;
+    pixel.position[0] = blockX + (i & 1);
+    pixel.position[1] = blockY + (i >> 1);
+    pixel.position[2] = Bits(rng, 24);
+    for (auto& color : pixel.color)
+    {
+      for (u8& comp : color)
+        comp = Bits(rng, 8);
+    }
+    for (Tev::TextureCoordinateType& uv : pixel.uv)
+    {
+      uv.s = static_cast<int>(Bits(rng, 17)) - 0x10000;
+      uv.t = static_cast<int>(Bits(rng, 17)) - 0x10000;
+    }
+    pixels.push_back(pixel);
+  }
+  return pixels;
+}
+
+void SetEfb(const std::vector<u8>& contents)
+{
+  const size_t row = AREA_SIZE * 3;
+  for (int y = 0; y < AREA_SIZE; ++y)
+  {
+    memcpy(EfbInterface::GetPixelPointer(0, y, false), &contents[y * row], row);
+    memcpy(EfbInterface::GetPixelPointer(0, y, true), &contents[(AREA_SIZE + y) * row], row);
+  }
+}
+
+std::vector<u8> GetEfb()
+{
+  const size_t row = AREA_SIZE * 3;
+  std::vector<u8> contents(row * AREA_SIZE * 2);
+  for (int y = 0; y < AREA_SIZE; ++y)
+  {
+    memcpy(&contents[y * row], EfbInterface::GetPixelPointer(0, y, false), row);
+    memcpy(&contents[(AREA_SIZE + y) * row], EfbInterface::GetPixelPointer(0, y, true), row);
+  }
+  return contents;
+}
+
+struct Results
+{
+  std::vector<u8> efb;
+  u32 pixelsIn;
+  u32 pixelsOut;
+  std::vector<u32> perfPixels;
+  std::vector<u16> boundingBox;
+};
+
+Results GetResults(const Tev& tev)
+{
+  Results results;
+  results.efb = GetEfb();
+  results.pixelsIn = tev.PixelsIn;
+  results.pixelsOut = tev.PixelsOut;
+  results.perfPixels.assign(tev.PerfPixels, tev.PerfPixels + PQ_NUM_MEMBERS);
+  results.boundingBox.assign(tev.BoundingBoxCoords, tev.BoundingBoxCoords + 4);
+  return results;
+}
+}
+
+TEST(SoftwareTev, DrawSpanMatchesDraw)
+{
+  std::mt19937 rng(1);
+
+  for (u8& byte : texMem)
+    byte = Bits(rng, 8);
+
+  BoundingBox::active = false;
+  g_ActiveConfig.bDumpTevStages = false;
+  g_ActiveConfig.bDumpTevTextureFetches = false;
+
+  Tev tev;
+  std::vector<u8> efb(AREA_SIZE * AREA_SIZE * 6);
+
+  for (int run = 0; run < 20000; ++run)
+  {
+    SCOPED_TRACE(testing::Message() << "run " << run);
+
+    RandomizeBPMem(rng);
+    g_ActiveConfig.bZComploc = (rng() & 1) != 0;
+
+    tev.Init();
+    for (int reg = 0; reg < 4; ++reg)
+    {
+      for (int comp = 0; comp < 4; ++comp)
+      {
+        tev.SetRegColor(reg, comp, false, RegisterValue(rng));
+        tev.SetRegColor(reg, comp, true, RegisterValue(rng));
+      }
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+      tev.IndirectLod[i] = static_cast<int>(Bits(rng, 8)) - 64;
+      tev.IndirectLinear[i] = (rng() & 1) != 0;
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+      tev.TextureLod[i] = static_cast<int>(Bits(rng, 8)) - 64;
+      tev.TextureLinear[i] = (rng() & 1) != 0;
+    }
+
+    std::vector<PixelInputs> pixels = RandomPixels(rng);
+    for (u8& byte : efb)
+      byte = Bits(rng, 8);
+
+    SetEfb(efb);
+    tev.ResetCounters();
+    for (const PixelInputs& pixel : pixels)
+    {
+      memcpy(tev.Position, pixel.position, sizeof(tev.Position));
+      memcpy(tev.Color, pixel.color, sizeof(tev.Color));
+      memcpy(tev.Uv, pixel.uv, sizeof(tev.Uv));
+      tev.Draw();
+    }
+    Results scalar = GetResults(tev);
+
+    SetEfb(efb);
+    tev.ResetCounters();
+    for (size_t i = 0; i < pixels.size(); ++i)
+    {
+      memcpy(tev.SpanPosition[i], pixels[i].position, sizeof(tev.SpanPosition[i]));
+      memcpy(tev.SpanColor[i], pixels[i].color, sizeof(tev.SpanColor[i]));
+      memcpy(tev.SpanUv[i], pixels[i].uv, sizeof(tev.SpanUv[i]));
+    }
+    tev.DrawSpan(static_cast<int>(pixels.size()));
+    Results span = GetResults(tev);
+
+    ASSERT_EQ(scalar.efb, span.efb);
+    ASSERT_EQ(scalar.pixelsIn, span.pixelsIn);
+    ASSERT_EQ(scalar.pixelsOut, span.pixelsOut);
+    ASSERT_EQ(scalar.perfPixels, span.perfPixels);
+    ASSERT_EQ(scalar.boundingBox, span.boundingBox);
+  }
+}
@@ -0,0 +1,198 @@
+// Copyright 2020 Dolphin Emulator Project
+// Licensed under GPLv2+
+// Refer to the license.txt file included.
+
+// Compares the scalar, SSE4.1 and AVX2 versions of the texture scaling filters, on the instruction
+// sets this CPU supports. The SIMD versions have to give the same output. Timings are printed for
+// every filter on a few texture sizes, with the filters running on the thread pool as in the game.
+// The timings take a while, so they only run with --gtest_also_run_disabled_tests.
+//
+// TEXTURE_SCALER_BENCH=<width>,<height>,<factor> times one more texture size.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>  // NOLINT
+
+#include "Common/CommonTypes.h"
+#include "VideoCommon/TextureScalerCommon.h"
+
+namespace
+{
+struct ScalingType
+{
+  int type;
+  const char* name;
+};
+
+const ScalingType SCALING_TYPES[] = {
+    {TextureScaler::XBRZ, "xBRZ"},
+    {TextureScaler::HYBRID, "Hybrid"},
+    {TextureScaler::BICUBIC, "Bicubic"},
+    {TextureScaler::HYBRID_BICUBIC, "Hybrid bicubic"},
+    {TextureScaler::JINC, "Jinc"},
+    {TextureScaler::JINC_SHARPER, "Jinc sharper"},
+    {TextureScaler::SMOOTHSTEP, "Smoothstep"},
+    {TextureScaler::THREE_POINT, "3-point"},
+    {TextureScaler::DDT, "DDT"},
+    {TextureScaler::DDT_SHARP, "DDT sharp"},
+};
+
+const char* SIMDName(TextureScaler::SIMD simd)
+{
+  switch (simd)
+  {
+  case TextureScaler::SIMD::AVX2:
+    return "AVX2";
+  case TextureScaler::SIMD::SSE41:
+    return "SSE4.1";
+  default:
+    return "scalar";
+  }
+}
+
+std::vector<TextureScaler::SIMD> SupportedSIMD()
+{
+  std::vector<TextureScaler::SIMD> levels = {TextureScaler::SIMD::Scalar};
+  TextureScaler::SIMD best = TextureScaler::GetBestSIMD();
+  if (best >= TextureScaler::SIMD::SSE41)
+    levels.push_back(TextureScaler::SIMD::SSE41);
+  if (best >= TextureScaler::SIMD::AVX2)
+    levels.push_back(TextureScaler::SIMD::AVX2);
+  return levels;
+}
+
+// Something like a game texture: gradients posterized to 16 levels, hard edged shapes,
+// some noise and transparent holes
+std::vector<u32> MakeTexture(int width, int height, u32 seed)
+{
+  std::mt19937 rng(seed);
+  std::vector<u32> texture(width * height);
+  for (int y = 0; y < height; ++y)
+  {
+    for (int x = 0; x < width; ++x)
+    {
+      u32 r = (x * 255 / std::max(width - 1, 1)) & 0xF0;
+      u32 g = (y * 255 / std::max(height - 1, 1)) & 0xF0;
+      u32 b = ((x + y) * 4) & 0xFF;
+      u32 a = 0xFF;
+      if (((x / 8) + (y / 8)) % 5 == 0)
+      {
+        r = 255 - r;
+        b = 0;
+      }
+      if ((rng() & 15) == 0)
+        g = rng() & 0xFF;
+      if ((x / 4) % 7 == 3 && (y / 4) % 5 == 2)
+        a = 0;
+      texture[y * width + x] = (a << 24) | (b << 16) | (g << 8) | r;
+    }
+  }
+  return texture;
+}
+
+std::vector<u32> Scale(TextureScaler& scaler, TextureScaler::SIMD simd, std::vector<u32> texture,
+                       int width, int height, int type, int factor, bool deposterize)
+{
+  scaler.SetSIMD(simd);
+  u32* out = scaler.Scale(texture.data(), width, height, type, factor, deposterize);
+  return std::vector<u32>(out, out + width * height * factor * factor);
+}
+
+void PrintTimings(int width, int height, int factor)
+{
+  TextureScaler scaler;
+  std::vector<TextureScaler::SIMD> levels = SupportedSIMD();
+  std::vector<u32> texture = MakeTexture(width, height, 1);
+
+  printf("[%dx%d at %dx] ms per texture:", width, height, factor);
+  for (TextureScaler::SIMD simd : levels)
+    printf(" %12s", SIMDName(simd));
+  printf("\n");
+
+  for (const ScalingType& type : SCALING_TYPES)
+  {
+    printf("  %-16s", type.name);
+    double scalar_ms = 0;
+    for (TextureScaler::SIMD simd : levels)
+    {
+      scaler.SetSIMD(simd);
+      // Runs for at least 200 ms, the first run only warms up the buffers
+      scaler.Scale(texture.data(), width, height, type.type, factor, false);
+      int runs = 0;
+      auto start = std::chrono::steady_clock::now();
+      std::chrono::duration<double, std::milli> elapsed(0);
+      while (elapsed.count() < 200)
+      {
+        scaler.Scale(texture.data(), width, height, type.type, factor, false);
+        ++runs;
+        elapsed = std::chrono::steady_clock::now() - start;
+      }
+      double ms = elapsed.count() / runs;
+      if (simd == TextureScaler::SIMD::Scalar)
+        scalar_ms = ms;
+      printf(" %6.2f %4.1fx", ms, scalar_ms / ms);
+    }
+    printf("\n");
+  }
+}
+}
+
+TEST(TextureScalerBenchmark, SIMDVersionsMatch)
+{
+  std::vector<TextureScaler::SIMD> levels = SupportedSIMD();
+  if (levels.size() < 2)
+    return;
+
+  TextureScaler scaler;
+  // Odd sizes leave partial vectors at the end of rows
+  const int sizes[][2] = {{1, 1}, {3, 7}, {37, 23}, {64, 64}};
+  for (const auto& size : sizes)
+  {
+    int width = size[0], height = size[1];
+    std::vector<u32> texture = MakeTexture(width, height, width * height);
+    for (const ScalingType& type : SCALING_TYPES)
+    {
+      for (int factor = 2; factor <= 5; ++factor)
+      {
+        for (bool deposterize : {false, true})
+        {
+          SCOPED_TRACE(testing::Message() << type.name << " " << width << "x" << height << " at "
+                                          << factor << "x, deposterize " << deposterize);
+          std::vector<u32> scalar = Scale(scaler, TextureScaler::SIMD::Scalar, texture, width,
+                                          height, type.type, factor, deposterize);
+          // Every filter, and deposterize, has to match the scalar version bit for bit
+          for (size_t i = 1; i < levels.size(); ++i)
+          {
+            SCOPED_TRACE(SIMDName(levels[i]));
+            EXPECT_EQ(scalar, Scale(scaler, levels[i], texture, width, height, type.type, factor,
+                                    deposterize));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(TextureScalerBenchmark, DISABLED_Timings)
+{
+  PrintTimings(64, 64, 4);
+  PrintTimings(256, 256, 2);
+  PrintTimings(256, 256, 4);
+  PrintTimings(512, 512, 4);
+}
+
+TEST(TextureScalerBenchmark, Custom)
+{
+  const char* env = getenv("TEXTURE_SCALER_BENCH");
+  if (!env)
+    return;
+  int width, height, factor;
+  ASSERT_EQ(3, sscanf(env, "%d,%d,%d", &width, &height, &factor));
+  ASSERT_TRUE(width > 0 && height > 0 && factor >= 2 && factor <= 5);
+  PrintTimings(width, height, factor);
+}